@@ -0,0 +1,295 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * mdb_go_bench: time the Go dmod's lookups and walks against a target
+ * loaded as for mdb_go_host, usually an image from mdb_go_gen.  For each
+ * benchmark we report the time per operation and the target reads and bytes
+ * per operation.  Each benchmark is run with more operations until it has
+ * run for at least the minimum time; with -C, the module's caches are
+ * cleared before every operation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mdb_host.h"
+#include "mdb_go.h"
+
+#define	BENCH_NPCS	4096
+#define	BENCH_MINTIME	200000000LL	/* 200ms */
+
+static uintptr_t bench_pcs[BENCH_NPCS];
+static boolean_t bench_cold;
+
+typedef struct bench {
+	const char *b_name;
+	int (*b_func)(size_t);
+} bench_t;
+
+static void
+bench_flush(void)
+{
+	static const mdb_arg_t arg = { MDB_TYPE_STRING, { "-c" } };
+
+	(void) mdb_call_dcmd("go_cache", 0, 0, 1, &arg);
+}
+
+static int
+bench_findfunc(size_t i)
+{
+	return (findfunc(bench_pcs[i % BENCH_NPCS]) == 0 ? -1 : 0);
+}
+
+static int
+bench_pcvalue(size_t i)
+{
+	return (go_host_pcln(bench_pcs[i % BENCH_NPCS]) < 0 ? -1 : 0);
+}
+
+/*ARGSUSED*/
+static int
+bench_gostack(size_t i)
+{
+	return (mdb_call_dcmd("gostack", 0, 0, 0, NULL) == DCMD_OK ? 0 : -1);
+}
+
+/*ARGSUSED*/
+static int
+bench_gostacks(size_t i)
+{
+	return (mdb_call_dcmd("gostacks", 0, 0, 0, NULL) == DCMD_OK ? 0 : -1);
+}
+
+/*
+ * One operation symbolizes the whole batch of PCs.
+ */
+/*ARGSUSED*/
+static int
+bench_gosym(size_t i)
+{
+	static mdb_arg_t args[BENCH_NPCS];
+	size_t j;
+
+	for (j = 0; j < BENCH_NPCS; j++) {
+		args[j].a_type = MDB_TYPE_IMMEDIATE;
+		args[j].a_un.a_val = bench_pcs[j];
+	}
+
+	return (mdb_call_dcmd("gosym", 0, 0, BENCH_NPCS, args) == DCMD_OK ?
+	    0 : -1);
+}
+
+/*ARGSUSED*/
+static int
+bench_count(uintptr_t addr, const void *data, void *arg)
+{
+	(*(size_t *)arg)++;
+	return (WALK_NEXT);
+}
+
+/*ARGSUSED*/
+static int
+bench_walk_g(size_t i)
+{
+	size_t n = 0;
+
+	return (mdb_walk("go_g", bench_count, &n) == 0 && n != 0 ? 0 : -1);
+}
+
+/*ARGSUSED*/
+static int
+bench_walk_g_rec(size_t i)
+{
+	size_t n = 0;
+
+	return (mdb_walk("go_g_rec", bench_count, &n) == 0 && n != 0 ? 0 : -1);
+}
+
+/*ARGSUSED*/
+static int
+bench_walk_m(size_t i)
+{
+	size_t n = 0;
+
+	return (mdb_walk("go_m", bench_count, &n) == 0 && n != 0 ? 0 : -1);
+}
+
+static const bench_t benches[] = {
+	{ "findfunc", bench_findfunc },
+	{ "pcvalue", bench_pcvalue },
+	{ "::gostack", bench_gostack },
+	{ "::gostacks", bench_gostacks },
+	{ "::gosym", bench_gosym },
+	{ "::walk go_g", bench_walk_g },
+	{ "::walk go_g_rec", bench_walk_g_rec },
+	{ "::walk go_m", bench_walk_m },
+	{ NULL }
+};
+
+static void
+bench_run(const bench_t *b)
+{
+	mdb_host_stats_t before, after;
+	hrtime_t start, elapsed;
+	size_t nops, i;
+
+	/* warm up, and make sure the operation works at all */
+	if (b->b_func(0) != 0) {
+		(void) printf("%-16s %10s\n", b->b_name, "failed");
+		return;
+	}
+
+	for (nops = 1; ; nops *= 4) {
+		mdb_host_stats(&before);
+		if (bench_cold) {
+			/* time only the operations, not the flushes */
+			for (elapsed = 0, i = 0; i < nops; i++) {
+				bench_flush();
+				start = mdb_gethrtime();
+				(void) b->b_func(i);
+				elapsed += mdb_gethrtime() - start;
+			}
+		} else {
+			start = mdb_gethrtime();
+			for (i = 0; i < nops; i++)
+				(void) b->b_func(i);
+			elapsed = mdb_gethrtime() - start;
+		}
+		mdb_host_stats(&after);
+
+		if (elapsed >= BENCH_MINTIME || nops >= (1UL << 30))
+			break;
+	}
+
+	(void) printf("%-16s %10lu %12.1f %12.1f %14.1f\n", b->b_name,
+	    (ulong_t)nops, (double)elapsed / nops,
+	    (double)(after.mhs_reads - before.mhs_reads) / nops,
+	    (double)(after.mhs_bytes - before.mhs_bytes) / nops);
+}
+
+static void
+usage(const char *arg0)
+{
+	(void) fprintf(stderr, "usage: %s [-C] [-e exec] [-c core] "
+	    "[-r image@addr]... [-s symmap]... [-R reg=value]... "
+	    "[benchmark ...]\n", arg0);
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *exec = NULL, *core = NULL;
+	GElf_Sym text, etext;
+	uint64_t seed = 0x2545f4914f6cdd1dULL;
+	char *at, *eq;
+	const bench_t *b;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "Ce:c:r:s:R:")) != -1) {
+		switch (c) {
+		case 'C':
+			bench_cold = B_TRUE;
+			break;
+		case 'e':
+			exec = optarg;
+			break;
+		case 'c':
+			core = optarg;
+			break;
+		case 'r':
+			if ((at = strrchr(optarg, '@')) == NULL)
+				usage(argv[0]);
+			*at++ = '\0';
+			if (mdb_host_load_image(optarg,
+			    (uintptr_t)strtoull(at, NULL, 16)) != 0)
+				return (1);
+			break;
+		case 's':
+			if (mdb_host_load_symbols(optarg) != 0)
+				return (1);
+			break;
+		case 'R':
+			if ((eq = strchr(optarg, '=')) == NULL)
+				usage(argv[0]);
+			*eq++ = '\0';
+			if (mdb_host_set_reg(optarg,
+			    strtoull(eq, NULL, 16)) != 0)
+				return (1);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (core != NULL && mdb_host_load_core(core) != 0)
+		return (1);
+
+	if (exec != NULL && mdb_host_load_exec(exec) != 0)
+		return (1);
+
+	if (mdb_host_init() != 0)
+		return (1);
+
+	if (mdb_lookup_by_name("runtime.text", &text) != 0 ||
+	    mdb_lookup_by_name("runtime.etext", &etext) != 0 ||
+	    etext.st_value <= text.st_value) {
+		(void) fprintf(stderr, "mdb_go_bench: can't find the text\n");
+		return (1);
+	}
+
+	for (i = 0; i < BENCH_NPCS; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		bench_pcs[i] = text.st_value +
+		    seed % (etext.st_value - text.st_value);
+	}
+
+	mdb_host_quiet(B_TRUE);
+
+	(void) printf("%-16s %10s %12s %12s %14s\n", "BENCHMARK", "OPS",
+	    "NS/OP", "READS/OP", "BYTES/OP");
+
+	for (b = benches; b->b_name != NULL; b++) {
+		if (optind < argc) {
+			for (i = optind; i < argc; i++) {
+				if (strcmp(argv[i], b->b_name) == 0)
+					break;
+			}
+			if (i == argc)
+				continue;
+		}
+
+		bench_run(b);
+		(void) fflush(stdout);
+	}
+
+	mdb_host_fini();
+
+	return (0);
+}
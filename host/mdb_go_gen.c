@@ -0,0 +1,685 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * mdb_go_gen: write a synthetic Go process image for mdb_go_host and
+ * mdb_go_bench.  The image holds a pclntab (in the Go 1.2 format, or with
+ * -v that of a later release) describing nfunc functions of fictitious
+ * text, and a scheduler population of G's, M's and
+ * P's linked from runtime.allg, runtime.allm and runtime.allp, each G with
+ * a stack of frames from those functions.  With -S, the G's and P's are
+ * instead held in runtime.allgs and runtime.allp slices, as in later
+ * runtimes, and aren't linked together.  Three files are written:
+ *
+ *	prefix.img	the raw image, loaded at GEN_BASE
+ *	prefix.syms	a symbol map for it
+ *	prefix.args	mdb_go_host/mdb_go_bench arguments to load both, with
+ *			the registers of the first goroutine
+ *
+ * Everything is derived from the seed, so the same arguments always produce
+ * the same image.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/mdb_modapi.h>
+#include "mdb_go_types.h"
+
+#define	GEN_BASE	0x10000000UL	/* where the image is loaded */
+#define	GEN_TEXT	0x400000UL	/* start of fictitious text */
+
+#define	GEN_FUNCS_PER_FILE	16
+#define	GEN_FUNCS_PER_PKG	64
+#define	GEN_LINES		8	/* pcln rows per function */
+
+static const char *gen_waitreasons[] = {
+	"chan receive", "select", "sleep", "IO wait", "semacquire"
+};
+
+#define	GEN_NWAIT	(sizeof (gen_waitreasons) / sizeof (char *))
+
+/*
+ * Layouts from mdb_go.c.
+ */
+typedef struct gen_pctabhdr {
+	uint32_t magic;
+	uint16_t zeros;
+	uint8_t quantum;
+	uint8_t ptrsize;
+	uintptr_t tabsize;
+} gen_pctabhdr_t;
+
+typedef struct gen_functbl {
+	uintptr_t entry;
+	uintptr_t offset;
+} gen_functbl_t;
+
+typedef struct gen_func {
+	uintptr_t entry;
+	uint32_t nameoff;
+	uint32_t args;
+	uint32_t frame;
+	uint32_t pcsp;
+	uint32_t pcfile;
+	uint32_t pcln;
+	uint32_t npcdata;
+	uint32_t nfuncdata;
+} gen_func_t;
+
+typedef struct gen_img {
+	uchar_t *gi_buf;
+	size_t gi_len;
+	size_t gi_alloc;
+} gen_img_t;
+
+static gen_img_t img;
+static uint64_t gen_seed = 0x9e3779b97f4a7c15ULL;
+
+/*
+ * The text: function i starts at gen_entries[i] and is gen_fsize[i] bytes
+ * long, with a frame of gen_frame[i] bytes including the return PC.
+ */
+static size_t gen_nfunc;
+static uintptr_t *gen_entries;
+static uint32_t *gen_fsize;
+static uint32_t *gen_frame;
+
+static uint64_t
+gen_rand(void)
+{
+	gen_seed ^= gen_seed << 13;
+	gen_seed ^= gen_seed >> 7;
+	gen_seed ^= gen_seed << 17;
+	return (gen_seed);
+}
+
+/*
+ * Reserve len bytes of the image at the given alignment; returns the offset.
+ */
+static size_t
+gen_reserve(size_t len, size_t align)
+{
+	size_t off = (img.gi_len + align - 1) & ~(align - 1);
+	uchar_t *nbuf;
+
+	if (off + len > img.gi_alloc) {
+		size_t nalloc = img.gi_alloc == 0 ? 1024 * 1024 : img.gi_alloc;
+
+		while (off + len > nalloc)
+			nalloc *= 2;
+		if ((nbuf = realloc(img.gi_buf, nalloc)) == NULL) {
+			(void) fprintf(stderr, "mdb_go_gen: out of memory\n");
+			exit(1);
+		}
+		bzero(nbuf + img.gi_alloc, nalloc - img.gi_alloc);
+		img.gi_buf = nbuf;
+		img.gi_alloc = nalloc;
+	}
+
+	img.gi_len = off + len;
+	return (off);
+}
+
+#define	GEN_PTR(off)	((void *)(img.gi_buf + (off)))
+#define	GEN_ADDR(off)	(GEN_BASE + (off))
+
+static size_t
+gen_string(const char *s)
+{
+	size_t off = gen_reserve(strlen(s) + 1, 1);
+
+	(void) strcpy(GEN_PTR(off), s);
+	return (off);
+}
+
+static void
+gen_varint(uint32_t v)
+{
+	size_t off;
+	uchar_t c;
+
+	do {
+		c = v & 0x7f;
+		v >>= 7;
+		if (v != 0)
+			c |= 0x80;
+		off = gen_reserve(1, 1);
+		*(uchar_t *)GEN_PTR(off) = c;
+	} while (v != 0);
+}
+
+/*
+ * Append one (value delta, pc delta) pair of a pc-value table.
+ */
+static void
+gen_pcpair(int32_t *last, int32_t value, uint32_t pcdelta)
+{
+	int32_t delta = value - *last;
+
+	gen_varint(delta < 0 ? ((uint32_t)~delta << 1) | 1 :
+	    (uint32_t)delta << 1);
+	gen_varint(pcdelta);
+	*last = value;
+}
+
+/*
+ * Append function i's pcsp, pcfile and pcln tables, storing their offsets
+ * from base in offs.
+ */
+static void
+gen_pctabs(size_t i, size_t base, int32_t file, uint32_t *offs)
+{
+	uint32_t fsize = gen_fsize[i], rows, line, j;
+	int32_t last;
+
+	/* pcsp: 0 in the 4-byte prologue, the frame size after it */
+	offs[0] = img.gi_len - base;
+	last = -1;
+	gen_pcpair(&last, 0, 4);
+	gen_pcpair(&last, gen_frame[i] - sizeof (uintptr_t), fsize - 4);
+	gen_varint(0);
+
+	/* pcfile: one file for the whole function */
+	offs[1] = img.gi_len - base;
+	last = -1;
+	gen_pcpair(&last, file, fsize);
+	gen_varint(0);
+
+	/* pcln: GEN_LINES rows of wandering line numbers */
+	offs[2] = img.gi_len - base;
+	last = -1;
+	line = 10 + (i % GEN_FUNCS_PER_FILE) * 40;
+	rows = fsize / 16 < GEN_LINES ? fsize / 16 : GEN_LINES;
+	for (j = 0; j < rows; j++) {
+		gen_pcpair(&last, line, j == rows - 1 ?
+		    fsize - (rows - 1) * (fsize / rows) : fsize / rows);
+		line += 1 + gen_rand() % 4;
+	}
+	gen_varint(0);
+}
+
+static void
+gen_funcname(char *buf, size_t len, size_t i)
+{
+	(void) snprintf(buf, len, "pkg%lu.fn%lu",
+	    (ulong_t)(i / GEN_FUNCS_PER_PKG), (ulong_t)i);
+}
+
+static void
+gen_filename(char *buf, size_t len, size_t i)
+{
+	(void) snprintf(buf, len, "/src/pkg%lu/file%lu.go",
+	    (ulong_t)(i * GEN_FUNCS_PER_FILE / GEN_FUNCS_PER_PKG), (ulong_t)i);
+}
+
+/*
+ * A Go 1.2 pclntab: the header and function table, the functions with
+ * their tables and names, and the file table, all addressed from the
+ * header.  File numbers start at 1.
+ */
+static size_t
+gen_pclntab12(size_t nfiles)
+{
+	size_t hdroff, ftaboff, filetaboff, foff, nameoff, i;
+	gen_pctabhdr_t *hdr;
+	gen_functbl_t *ftab;
+	gen_func_t *f;
+	uint32_t offs[3];
+	char buf[256];
+
+	hdroff = gen_reserve(sizeof (gen_pctabhdr_t), 4096);
+	ftaboff = gen_reserve((gen_nfunc + 1) * sizeof (gen_functbl_t), 8);
+
+	for (i = 0; i < gen_nfunc; i++) {
+		gen_funcname(buf, sizeof (buf), i);
+		nameoff = gen_string(buf) - hdroff;
+
+		foff = gen_reserve(sizeof (gen_func_t), 8);
+		f = GEN_PTR(foff);
+		f->entry = gen_entries[i];
+		f->nameoff = nameoff;
+		f->args = 8 * (gen_rand() % 4);
+		f->frame = gen_frame[i];
+
+		ftab = GEN_PTR(ftaboff);
+		ftab[i].entry = gen_entries[i];
+		ftab[i].offset = foff - hdroff;
+
+		gen_pctabs(i, hdroff, 1 + i / GEN_FUNCS_PER_FILE, offs);
+		f = GEN_PTR(foff);
+		f->pcsp = offs[0];
+		f->pcfile = offs[1];
+		f->pcln = offs[2];
+	}
+
+	filetaboff = gen_reserve((nfiles + 1) * sizeof (uint32_t), 4);
+	((uint32_t *)GEN_PTR(filetaboff))[0] = nfiles + 1;
+	for (i = 0; i < nfiles; i++) {
+		gen_filename(buf, sizeof (buf), i);
+		nameoff = gen_string(buf) - hdroff;
+		((uint32_t *)GEN_PTR(filetaboff))[i + 1] = nameoff;
+	}
+
+	ftab = GEN_PTR(ftaboff);
+	ftab[gen_nfunc].entry = gen_entries[gen_nfunc];
+	ftab[gen_nfunc].offset = filetaboff - hdroff;
+
+	hdr = GEN_PTR(hdroff);
+	hdr->magic = 0xfffffffb;
+	hdr->quantum = 1;
+	hdr->ptrsize = sizeof (uintptr_t);
+	hdr->tabsize = gen_nfunc;
+
+	return (hdroff);
+}
+
+/*
+ * A Go 1.16, 1.18 or 1.20 pclntab: the header, then the function name,
+ * compilation unit, file name and pc-value tables, then the function table
+ * and the functions.  Each package is a compilation unit, whose files are
+ * numbered from 0.
+ */
+static size_t
+gen_pclntab116(int version, size_t nfiles)
+{
+	size_t hdroff, nametab, cutab, filetab, pctab, functab, foff, i;
+	size_t fpp = GEN_FUNCS_PER_PKG / GEN_FUNCS_PER_FILE;
+	size_t entsz = version == 116 ? 2 * sizeof (uintptr_t) :
+	    2 * sizeof (uint32_t);
+	size_t recsz = version == 116 ? 48 : version == 118 ? 40 : 44;
+	uint32_t *nameoffs, *args, (*tabs)[3], *w;
+	uintptr_t *hw;
+	uchar_t *ftab;
+	char buf[256];
+
+	nameoffs = calloc(gen_nfunc, sizeof (uint32_t));
+	args = calloc(gen_nfunc, sizeof (uint32_t));
+	tabs = calloc(gen_nfunc, sizeof (*tabs));
+	if (nameoffs == NULL || args == NULL || tabs == NULL) {
+		(void) fprintf(stderr, "mdb_go_gen: out of memory\n");
+		exit(1);
+	}
+
+	hdroff = gen_reserve(version == 116 ? 64 : 72, 4096);
+
+	nametab = img.gi_len;
+	for (i = 0; i < gen_nfunc; i++) {
+		gen_funcname(buf, sizeof (buf), i);
+		nameoffs[i] = gen_string(buf) - nametab;
+	}
+
+	cutab = gen_reserve(nfiles * sizeof (uint32_t), 4);
+	filetab = img.gi_len;
+	for (i = 0; i < nfiles; i++) {
+		gen_filename(buf, sizeof (buf), i);
+		((uint32_t *)GEN_PTR(cutab))[i] = gen_string(buf) - filetab;
+	}
+
+	/* a table at offset 0 would mean no table */
+	pctab = gen_reserve(1, 1);
+	for (i = 0; i < gen_nfunc; i++) {
+		args[i] = 8 * (gen_rand() % 4);
+		gen_pctabs(i, pctab, (i / GEN_FUNCS_PER_FILE) % fpp, tabs[i]);
+	}
+
+	functab = gen_reserve((gen_nfunc + 1) * entsz, 8);
+	for (i = 0; i <= gen_nfunc; i++) {
+		foff = i < gen_nfunc ? gen_reserve(recsz, 8) : functab;
+		ftab = GEN_PTR(functab + i * entsz);
+		if (version == 116) {
+			((uintptr_t *)ftab)[0] = gen_entries[i];
+			((uintptr_t *)ftab)[1] = foff - functab;
+		} else {
+			((uint32_t *)ftab)[0] = gen_entries[i] - GEN_TEXT;
+			((uint32_t *)ftab)[1] = foff - functab;
+		}
+
+		if (i == gen_nfunc)
+			break;
+
+		if (version == 116) {
+			*(uintptr_t *)GEN_PTR(foff) = gen_entries[i];
+			w = GEN_PTR(foff + sizeof (uintptr_t));
+		} else {
+			w = GEN_PTR(foff);
+			*w++ = gen_entries[i] - GEN_TEXT;
+		}
+		w[0] = nameoffs[i];
+		w[1] = args[i];
+		w[3] = tabs[i][0];
+		w[4] = tabs[i][1];
+		w[5] = tabs[i][2];
+		w[7] = (i / GEN_FUNCS_PER_PKG) * fpp;
+		if (version == 120)
+			w[8] = 10 + (i % GEN_FUNCS_PER_FILE) * 40;
+	}
+
+	*(uint32_t *)GEN_PTR(hdroff) = version == 116 ? 0xfffffffa :
+	    version == 118 ? 0xfffffff0 : 0xfffffff1;
+	*(uchar_t *)GEN_PTR(hdroff + 6) = 1;
+	*(uchar_t *)GEN_PTR(hdroff + 7) = sizeof (uintptr_t);
+	hw = GEN_PTR(hdroff + 8);
+	*hw++ = gen_nfunc;
+	*hw++ = nfiles;
+	if (version != 116)
+		*hw++ = GEN_TEXT;
+	*hw++ = nametab - hdroff;
+	*hw++ = cutab - hdroff;
+	*hw++ = filetab - hdroff;
+	*hw++ = pctab - hdroff;
+	*hw++ = functab - hdroff;
+
+	free(nameoffs);
+	free(args);
+	free(tabs);
+
+	return (hdroff);
+}
+
+static void
+gen_write(const char *path, const void *buf, size_t len)
+{
+	FILE *fp;
+
+	if ((fp = fopen(path, "w")) == NULL ||
+	    fwrite(buf, 1, len, fp) != len || fclose(fp) != 0) {
+		(void) fprintf(stderr, "mdb_go_gen: failed to write %s\n",
+		    path);
+		exit(1);
+	}
+}
+
+static void
+usage(const char *arg0)
+{
+	(void) fprintf(stderr, "usage: %s [-f nfunc] [-g ngoroutine] "
+	    "[-m nm] [-p np] [-d depth] [-u nstacks] [-s seed] "
+	    "[-v 1.2|1.16|1.18|1.20] [-S] prefix\n", arg0);
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t nfunc = 1000, ng = 100, nm = 8, np = 8, depth = 8, nstacks = 32;
+	size_t nfiles, i, j, k, hdroff, varsoff, goff;
+	size_t moff, poff, agoff = 0, apoff = 0, waitoff[GEN_NWAIT];
+	uintptr_t *entries, pc, etext;
+	uint32_t *fsize, *frame;
+	uint32_t **stacks;
+	uintptr_t **stackpcs;
+	char buf[256], path[1024];
+	const char *prefix;
+	FILE *fp;
+	int version = 12, c;
+	boolean_t slices = B_FALSE;
+
+	while ((c = getopt(argc, argv, "f:g:m:p:d:u:s:v:S")) != -1) {
+		switch (c) {
+		case 'f':
+			nfunc = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			ng = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			nm = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			np = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			nstacks = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			gen_seed = strtoull(optarg, NULL, 0) | 1;
+			break;
+		case 'v':
+			if (strcmp(optarg, "1.2") == 0)
+				version = 12;
+			else if (strcmp(optarg, "1.16") == 0)
+				version = 116;
+			else if (strcmp(optarg, "1.18") == 0)
+				version = 118;
+			else if (strcmp(optarg, "1.20") == 0)
+				version = 120;
+			else
+				usage(argv[0]);
+			break;
+		case 'S':
+			slices = B_TRUE;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind != argc - 1 || nfunc < 2 || ng == 0 || nm == 0 ||
+	    np == 0 || depth == 0 || nstacks == 0)
+		usage(argv[0]);
+
+	prefix = argv[optind];
+	nfiles = (nfunc + GEN_FUNCS_PER_FILE - 1) / GEN_FUNCS_PER_FILE;
+
+	/*
+	 * Lay out the text: each function is 32 to 272 bytes long with a
+	 * 16 to 64 byte frame.
+	 */
+	entries = calloc(nfunc + 1, sizeof (uintptr_t));
+	fsize = calloc(nfunc, sizeof (uint32_t));
+	frame = calloc(nfunc, sizeof (uint32_t));
+	if (entries == NULL || fsize == NULL || frame == NULL) {
+		(void) fprintf(stderr, "mdb_go_gen: out of memory\n");
+		return (1);
+	}
+
+	for (pc = GEN_TEXT, i = 0; i < nfunc; i++) {
+		entries[i] = pc;
+		fsize[i] = 32 + 16 * (gen_rand() % 16);
+		frame[i] = 16 + 8 * (gen_rand() % 7);
+		pc += fsize[i];
+	}
+	etext = entries[nfunc] = pc;
+
+	gen_nfunc = nfunc;
+	gen_entries = entries;
+	gen_fsize = fsize;
+	gen_frame = frame;
+
+	/*
+	 * Variables first, then the pclntab.  The slices, when there are
+	 * any, follow allg, allm and allp.
+	 */
+	varsoff = gen_reserve((slices ? 9 : 3) * sizeof (uintptr_t), 4096);
+	hdroff = version == 12 ? gen_pclntab12(nfiles) :
+	    gen_pclntab116(version, nfiles);
+
+	/*
+	 * Call chains: nstacks distinct ones, shared round-robin among the
+	 * goroutines.  Each is depth functions, innermost first, and the PC
+	 * in each, so that goroutines sharing a chain have the same stack.
+	 */
+	stacks = calloc(nstacks, sizeof (uint32_t *));
+	stackpcs = calloc(nstacks, sizeof (uintptr_t *));
+	for (i = 0; i < nstacks; i++) {
+		stacks[i] = calloc(depth, sizeof (uint32_t));
+		stackpcs[i] = calloc(depth, sizeof (uintptr_t));
+		for (j = 0; j < depth; j++) {
+			k = stacks[i][j] = gen_rand() % nfunc;
+			stackpcs[i][j] = entries[k] + 4 +
+			    gen_rand() % (fsize[k] - 4);
+		}
+	}
+
+	/*
+	 * The scheduler.  Each goroutine's saved SP is in the innermost
+	 * function after its prologue, so that function's return address is
+	 * its frame size less the return address itself above the SP.  Each
+	 * return address is a PC in the next function out, with that
+	 * function's frame above it.  A zero PC ends the stack.
+	 */
+	goff = gen_reserve(ng * sizeof (G), 64);
+	moff = gen_reserve(nm * sizeof (M), 64);
+	poff = gen_reserve(np * sizeof (P), 64);
+	if (slices) {
+		agoff = gen_reserve(ng * sizeof (uintptr_t), 8);
+		apoff = gen_reserve(np * sizeof (uintptr_t), 8);
+	}
+	for (i = 0; i < GEN_NWAIT; i++)
+		waitoff[i] = gen_string(gen_waitreasons[i]);
+
+	for (i = 0; i < ng; i++) {
+		uint32_t *chain = stacks[i % nstacks];
+		uintptr_t *pcs = stackpcs[i % nstacks];
+		size_t stksz = 8, sp, stkoff;
+		G *g;
+
+		stksz += frame[chain[0]] - sizeof (uintptr_t);
+		for (j = 1; j < depth; j++)
+			stksz += frame[chain[j]];
+		stkoff = gen_reserve(stksz, 16);
+
+		sp = stkoff + frame[chain[0]] - sizeof (uintptr_t);
+		for (j = 1; j < depth; j++) {
+			*(uintptr_t *)GEN_PTR(sp) = pcs[j];
+			sp += frame[chain[j]];
+		}
+
+		g = GEN_PTR(goff + i * sizeof (G));
+		g->stack0 = GEN_ADDR(stkoff);
+		g->stacksize = stksz;
+		g->stackbase = GEN_ADDR(stkoff + stksz);
+		g->stackguard = g->stackguard0 = g->stack0 + 256;
+		g->sched.sp = GEN_ADDR(stkoff);
+		g->sched.pc = pcs[0];
+		g->sched.g = (G *)GEN_ADDR(goff + i * sizeof (G));
+		g->goid = i + 1;
+		g->status = i == 0 ? GS_Grunning : (i % 7 == 0) ? GS_Gsyscall :
+		    (i % 3 == 0) ? GS_Grunnable : GS_Gwaiting;
+		if (g->status == GS_Gsyscall) {
+			g->syscallstack = g->stackbase;
+			g->syscallsp = g->sched.sp;
+			g->syscallpc = g->sched.pc;
+			g->syscallguard = g->stackguard;
+		}
+		if (g->status == GS_Gwaiting) {
+			g->waitreason = (int8_t *)GEN_ADDR(waitoff[i %
+			    GEN_NWAIT]);
+		}
+		/* goroutines with the same stack came from the same place */
+		g->gopc = entries[chain[depth - 1]] + 4;
+		g->m = i < nm ? (M *)GEN_ADDR(moff + i * sizeof (M)) : NULL;
+		if (slices)
+			((uintptr_t *)GEN_PTR(agoff))[i] =
+			    GEN_ADDR(goff + i * sizeof (G));
+		else if (i + 1 < ng)
+			g->alllink = (G *)GEN_ADDR(goff + (i + 1) * sizeof (G));
+	}
+
+	for (i = 0; i < nm; i++) {
+		M *m = GEN_PTR(moff + i * sizeof (M));
+
+		m->id = i;
+		m->g0 = (G *)GEN_ADDR(goff);
+		m->curg = i < ng ? (G *)GEN_ADDR(goff + i * sizeof (G)) : NULL;
+		m->p = i < np ? (P *)GEN_ADDR(poff + i * sizeof (P)) : NULL;
+		if (i + 1 < nm)
+			m->alllink = (M *)GEN_ADDR(moff + (i + 1) * sizeof (M));
+	}
+
+	for (i = 0; i < np; i++) {
+		P *p = GEN_PTR(poff + i * sizeof (P));
+
+		p->id = i;
+		p->status = i < nm ? PS_Prunning : PS_Pidle;
+		p->m = i < nm ? (M *)GEN_ADDR(moff + i * sizeof (M)) : NULL;
+		if (slices)
+			((uintptr_t *)GEN_PTR(apoff))[i] =
+			    GEN_ADDR(poff + i * sizeof (P));
+		else if (i + 1 < np)
+			p->link = (P *)GEN_ADDR(poff + (i + 1) * sizeof (P));
+	}
+
+	((uintptr_t *)GEN_PTR(varsoff))[0] = GEN_ADDR(goff);
+	((uintptr_t *)GEN_PTR(varsoff))[1] = GEN_ADDR(moff);
+	((uintptr_t *)GEN_PTR(varsoff))[2] = GEN_ADDR(poff);
+	if (slices) {
+		((uintptr_t *)GEN_PTR(varsoff))[3] = GEN_ADDR(agoff);
+		((uintptr_t *)GEN_PTR(varsoff))[4] = ng;
+		((uintptr_t *)GEN_PTR(varsoff))[5] = ng;
+		((uintptr_t *)GEN_PTR(varsoff))[6] = GEN_ADDR(apoff);
+		((uintptr_t *)GEN_PTR(varsoff))[7] = np;
+		((uintptr_t *)GEN_PTR(varsoff))[8] = np;
+	}
+
+	(void) snprintf(path, sizeof (path), "%s.img", prefix);
+	gen_write(path, img.gi_buf, img.gi_len);
+
+	(void) snprintf(path, sizeof (path), "%s.syms", prefix);
+	if ((fp = fopen(path, "w")) == NULL) {
+		(void) fprintf(stderr, "mdb_go_gen: failed to write %s\n",
+		    path);
+		return (1);
+	}
+	(void) fprintf(fp, "# %lu functions, %lu goroutines, %lu Ms, %lu Ps\n",
+	    (ulong_t)nfunc, (ulong_t)ng, (ulong_t)nm, (ulong_t)np);
+	(void) fprintf(fp, "%lx %lx runtime.allm\n", GEN_ADDR(varsoff + 8), 8UL);
+	if (slices) {
+		(void) fprintf(fp, "%lx %lx runtime.allgs\n",
+		    GEN_ADDR(varsoff + 24), 24UL);
+		(void) fprintf(fp, "%lx %lx runtime.allp\n",
+		    GEN_ADDR(varsoff + 48), 24UL);
+	} else {
+		(void) fprintf(fp, "%lx %lx runtime.allg\n",
+		    GEN_ADDR(varsoff), 8UL);
+		(void) fprintf(fp, "%lx %lx runtime.allp\n",
+		    GEN_ADDR(varsoff + 16), 8UL);
+	}
+	(void) fprintf(fp, "%lx %lx runtime.pclntab\n", GEN_ADDR(hdroff),
+	    (ulong_t)(goff - hdroff));
+	(void) fprintf(fp, "%lx %lx runtime.text\n", GEN_TEXT, 0UL);
+	(void) fprintf(fp, "%lx %lx runtime.etext\n", etext, 0UL);
+	if (fclose(fp) != 0) {
+		(void) fprintf(stderr, "mdb_go_gen: failed to write %s\n",
+		    path);
+		return (1);
+	}
+
+	(void) snprintf(path, sizeof (path), "%s.args", prefix);
+	(void) snprintf(buf, sizeof (buf), "-r %s.img@%lx -s %s.syms "
+	    "-R rip=%lx -R rsp=%lx -R rbp=0\n", prefix, GEN_BASE, prefix,
+	    (ulong_t)((G *)GEN_PTR(goff))->sched.pc,
+	    (ulong_t)((G *)GEN_PTR(goff))->sched.sp);
+	gen_write(path, buf, strlen(buf));
+
+	return (0);
+}
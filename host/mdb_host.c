@@ -0,0 +1,2223 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * Host-side harness for the Go dmod.  This implements the part of the
+ * debugger module API that the dmod uses on top of a static target built
+ * from any combination of:
+ *
+ *	- an ELF core file, which supplies memory (PT_LOAD) and the
+ *	  registers of the first thread (NT_PRSTATUS);
+ *
+ *	- the ELF executable, which supplies symbols and any memory the core
+ *	  does not (typically text and read-only data);
+ *
+ *	- raw memory images loaded at a given address, together with a
+ *	  symbol map of "address size name" lines, all in hex.
+ *
+ * Commands are a small subset of mdb's language: an optional address
+ * expression (hex numbers and symbol names joined by + and -), a dcmd, its
+ * arguments, and optionally a pipe into further dcmds.  As in mdb, numbers
+ * are hex by default; 0t, 0o and 0i prefixes select other radixes.  The
+ * built-in ::walk, ::dcmds, ::walkers and ::help behave as they do in mdb.
+ *
+ * None of this is thread-safe; neither is mdb.  The one exception is
+ * mdb_vread(), which the heap scan calls from several threads at once.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mdb_host.h"
+
+int mdb_prop_postmortem;
+int mdb_prop_kernel;
+
+/*
+ * Target memory: a sorted list of non-overlapping segments.
+ */
+typedef struct host_seg {
+	uintptr_t hs_addr;
+	size_t hs_size;
+	const uchar_t *hs_data;
+} host_seg_t;
+
+static host_seg_t *host_segs;
+static size_t host_nsegs;
+static size_t host_segs_alloc;
+
+typedef struct host_sym {
+	const char *hy_name;
+	uintptr_t hy_addr;
+	size_t hy_size;
+	uchar_t hy_info;
+} host_sym_t;
+
+static host_sym_t *host_syms;
+static size_t host_nsyms;
+static size_t host_syms_alloc;
+static host_sym_t **host_symhash;
+static size_t host_symhashsz;
+static boolean_t host_syms_sorted;
+
+static const char *host_regnames[] = {
+	"r15", "r14", "r13", "r12", "rbp", "rbx", "r11", "r10",
+	"r9", "r8", "rax", "rcx", "rdx", "rsi", "rdi", "orig_rax",
+	"rip", "cs", "eflags", "rsp", "ss", "fs_base", "gs_base", "ds",
+	"es", "fs", "gs"
+};
+#define	HOST_NREGS	(sizeof (host_regnames) / sizeof (host_regnames[0]))
+
+static uint64_t host_regs[HOST_NREGS];
+static boolean_t host_regs_valid[HOST_NREGS];
+
+typedef struct host_obj {
+	char *ho_name;
+	char *ho_fullname;
+	uintptr_t ho_base;
+	size_t ho_size;
+} host_obj_t;
+
+#define	HOST_MAXOBJS	16
+static host_obj_t host_objs[HOST_MAXOBJS];
+static int host_nobjs;
+
+/*
+ * Load bias for a position-independent executable, from the core's
+ * auxiliary vector.
+ */
+static uintptr_t host_at_entry;
+static boolean_t host_have_core;
+
+static const mdb_modinfo_t *host_modinfo;
+
+typedef struct host_cb {
+	int hc_class;
+	mdb_callback_f hc_func;
+	void *hc_arg;
+	struct host_cb *hc_next;
+} host_cb_t;
+
+static host_cb_t *host_cbs;
+
+static mdb_host_stats_t host_stats;
+static const char *host_errmsg;
+
+/*
+ * Output state.  While a dcmd's output is feeding a pipe it is captured
+ * in host_capture rather than written out.
+ */
+typedef struct host_buf {
+	char *hb_buf;
+	size_t hb_len;
+	size_t hb_alloc;
+} host_buf_t;
+
+static host_buf_t *host_capture;
+static boolean_t host_quiet_output;
+static ulong_t host_indent;
+static boolean_t host_bol = B_TRUE;
+
+/*
+ * Pipe state for the dcmd currently running.
+ */
+static uintptr_t *host_pipe_in;
+static size_t host_pipe_nin;
+static size_t host_pipe_ndx;
+static uintptr_t *host_pipe_out;
+static size_t host_pipe_nout;
+static boolean_t host_pipe_set;
+
+typedef struct host_gc {
+	void *hg_buf;
+	struct host_gc *hg_next;
+} host_gc_t;
+
+static host_gc_t *host_gc;
+
+/*
+ * Walks layered with mdb_layered_walk().
+ */
+typedef struct host_layer {
+	mdb_walk_state_t *hl_wsp;
+	const char *hl_name;
+	struct host_layer *hl_next;
+} host_layer_t;
+
+static host_layer_t *host_layers;
+
+static void *
+host_zalloc(size_t size)
+{
+	void *buf;
+
+	if ((buf = calloc(1, size == 0 ? 1 : size)) == NULL) {
+		(void) fprintf(stderr, "mdb_go_host: out of memory\n");
+		abort();
+	}
+
+	return (buf);
+}
+
+static char *
+host_strdup(const char *s)
+{
+	char *d = host_zalloc(strlen(s) + 1);
+
+	(void) strcpy(d, s);
+	return (d);
+}
+
+static void
+host_buf_append(host_buf_t *hb, const char *s, size_t len)
+{
+	char *nbuf;
+
+	if (hb->hb_len + len + 1 > hb->hb_alloc) {
+		size_t nalloc = hb->hb_alloc == 0 ? 256 : hb->hb_alloc;
+
+		while (hb->hb_len + len + 1 > nalloc)
+			nalloc *= 2;
+		nbuf = host_zalloc(nalloc);
+		if (hb->hb_buf != NULL) {
+			bcopy(hb->hb_buf, nbuf, hb->hb_len);
+			free(hb->hb_buf);
+		}
+		hb->hb_buf = nbuf;
+		hb->hb_alloc = nalloc;
+	}
+
+	bcopy(s, hb->hb_buf + hb->hb_len, len);
+	hb->hb_len += len;
+	hb->hb_buf[hb->hb_len] = '\0';
+}
+
+static void
+host_buf_fini(host_buf_t *hb)
+{
+	free(hb->hb_buf);
+	bzero(hb, sizeof (*hb));
+}
+
+/*
+ * Memory.
+ */
+static void
+host_seg_insert(uintptr_t addr, size_t size, const uchar_t *data)
+{
+	host_seg_t *nsegs;
+	size_t i;
+
+	if (size == 0)
+		return;
+
+	if (host_nsegs == host_segs_alloc) {
+		host_segs_alloc = host_segs_alloc == 0 ? 64 : host_segs_alloc * 2;
+		nsegs = host_zalloc(host_segs_alloc * sizeof (host_seg_t));
+		if (host_segs != NULL) {
+			bcopy(host_segs, nsegs, host_nsegs * sizeof (host_seg_t));
+			free(host_segs);
+		}
+		host_segs = nsegs;
+	}
+
+	for (i = host_nsegs; i > 0 && host_segs[i - 1].hs_addr > addr; i--)
+		host_segs[i] = host_segs[i - 1];
+
+	host_segs[i].hs_addr = addr;
+	host_segs[i].hs_size = size;
+	host_segs[i].hs_data = data;
+	host_nsegs++;
+}
+
+/*
+ * Add memory to the target.  Memory that is already present takes
+ * precedence; only the parts of [addr, addr + size) not yet covered are
+ * added.
+ */
+static void
+host_seg_add(uintptr_t addr, size_t size, const uchar_t *data)
+{
+	uintptr_t end = addr + size;
+	size_t i;
+
+	while (addr < end) {
+		uintptr_t next = end;
+
+		for (i = 0; i < host_nsegs; i++) {
+			host_seg_t *hs = &host_segs[i];
+
+			if (hs->hs_addr <= addr &&
+			    addr < hs->hs_addr + hs->hs_size) {
+				next = hs->hs_addr + hs->hs_size;
+				break;
+			}
+
+			if (hs->hs_addr > addr) {
+				if (hs->hs_addr < next)
+					next = hs->hs_addr;
+				break;
+			}
+		}
+
+		if (i < host_nsegs && host_segs[i].hs_addr <= addr) {
+			/* covered already; skip past it */
+			data += next - addr;
+			addr = next;
+			continue;
+		}
+
+		host_seg_insert(addr, next - addr, data);
+		data += next - addr;
+		addr = next;
+	}
+}
+
+static const host_seg_t *
+host_seg_lookup(uintptr_t addr)
+{
+	size_t lo = 0, hi = host_nsegs, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (addr < host_segs[mid].hs_addr)
+			hi = mid;
+		else if (addr >= host_segs[mid].hs_addr + host_segs[mid].hs_size)
+			lo = mid + 1;
+		else
+			return (&host_segs[mid]);
+	}
+
+	return (NULL);
+}
+
+ssize_t
+mdb_vread(void *buf, size_t size, uintptr_t addr)
+{
+	const host_seg_t *hs;
+	size_t done, len;
+
+	(void) __sync_fetch_and_add(&host_stats.mhs_reads, 1);
+
+	for (done = 0; done < size; done += len) {
+		if ((hs = host_seg_lookup(addr + done)) == NULL) {
+			host_errmsg = "no mapping for address";
+			errno = EFAULT;
+			return (-1);
+		}
+
+		len = hs->hs_addr + hs->hs_size - (addr + done);
+		if (len > size - done)
+			len = size - done;
+
+		bcopy(hs->hs_data + (addr + done - hs->hs_addr),
+		    (char *)buf + done, len);
+	}
+
+	(void) __sync_fetch_and_add(&host_stats.mhs_bytes, size);
+	return (size);
+}
+
+ssize_t
+mdb_readstr(char *buf, size_t size, uintptr_t addr)
+{
+	const host_seg_t *hs;
+	size_t i;
+
+	if (size == 0)
+		return (0);
+
+	host_stats.mhs_reads++;
+
+	for (i = 0; i < size - 1; i++) {
+		if ((hs = host_seg_lookup(addr + i)) == NULL) {
+			if (i == 0) {
+				host_errmsg = "no mapping for address";
+				errno = EFAULT;
+				return (-1);
+			}
+			break;
+		}
+
+		if ((buf[i] = hs->hs_data[addr + i - hs->hs_addr]) == '\0')
+			break;
+	}
+
+	buf[i] = '\0';
+	host_stats.mhs_bytes += i;
+
+	return (i);
+}
+
+/*
+ * Symbols.
+ */
+static size_t
+host_symhash_fn(const char *name)
+{
+	size_t h = 2166136261U;
+
+	for (; *name != '\0'; name++)
+		h = (h ^ (uchar_t)*name) * 16777619U;
+
+	return (h);
+}
+
+static void
+host_sym_add(const char *name, uintptr_t addr, size_t size, uchar_t info)
+{
+	host_sym_t *nsyms;
+
+	if (host_nsyms == host_syms_alloc) {
+		host_syms_alloc = host_syms_alloc == 0 ? 1024 :
+		    host_syms_alloc * 2;
+		nsyms = host_zalloc(host_syms_alloc * sizeof (host_sym_t));
+		if (host_syms != NULL) {
+			bcopy(host_syms, nsyms, host_nsyms * sizeof (host_sym_t));
+			free(host_syms);
+		}
+		host_syms = nsyms;
+	}
+
+	host_syms[host_nsyms].hy_name = name;
+	host_syms[host_nsyms].hy_addr = addr;
+	host_syms[host_nsyms].hy_size = size;
+	host_syms[host_nsyms].hy_info = info;
+	host_nsyms++;
+	host_syms_sorted = B_FALSE;
+}
+
+static int
+host_sym_cmp(const void *l, const void *r)
+{
+	const host_sym_t *ls = l, *rs = r;
+
+	if (ls->hy_addr != rs->hy_addr)
+		return (ls->hy_addr < rs->hy_addr ? -1 : 1);
+
+	/* prefer sized symbols */
+	if (ls->hy_size != rs->hy_size)
+		return (ls->hy_size > rs->hy_size ? -1 : 1);
+
+	return (strcmp(ls->hy_name, rs->hy_name));
+}
+
+static void
+host_syms_prepare(void)
+{
+	size_t i, h;
+
+	if (host_syms_sorted)
+		return;
+
+	qsort(host_syms, host_nsyms, sizeof (host_sym_t), host_sym_cmp);
+
+	free(host_symhash);
+	for (host_symhashsz = 1024; host_symhashsz < host_nsyms * 2;
+	    host_symhashsz *= 2)
+		continue;
+	host_symhash = host_zalloc(host_symhashsz * sizeof (host_sym_t *));
+
+	for (i = 0; i < host_nsyms; i++) {
+		h = host_symhash_fn(host_syms[i].hy_name) & (host_symhashsz - 1);
+		while (host_symhash[h] != NULL) {
+			if (strcmp(host_symhash[h]->hy_name,
+			    host_syms[i].hy_name) == 0)
+				break;
+			h = (h + 1) & (host_symhashsz - 1);
+		}
+		if (host_symhash[h] == NULL)
+			host_symhash[h] = &host_syms[i];
+	}
+
+	host_syms_sorted = B_TRUE;
+}
+
+static void
+host_sym_fill(const host_sym_t *hy, GElf_Sym *symp)
+{
+	bzero(symp, sizeof (*symp));
+	symp->st_value = hy->hy_addr;
+	symp->st_size = hy->hy_size;
+	symp->st_info = hy->hy_info;
+	symp->st_shndx = SHN_ABS;
+}
+
+int
+mdb_lookup_by_name(const char *name, GElf_Sym *symp)
+{
+	const char *tick;
+	size_t h;
+
+	/*
+	 * There's only one object; ignore any scoping.
+	 */
+	if ((tick = strrchr(name, '`')) != NULL)
+		name = tick + 1;
+
+	host_syms_prepare();
+
+	if (host_nsyms != 0) {
+		h = host_symhash_fn(name) & (host_symhashsz - 1);
+		for (; host_symhash[h] != NULL; h = (h + 1) & (host_symhashsz - 1)) {
+			if (strcmp(host_symhash[h]->hy_name, name) == 0) {
+				if (symp != NULL)
+					host_sym_fill(host_symhash[h], symp);
+				return (0);
+			}
+		}
+	}
+
+	host_errmsg = "unknown symbol name";
+	errno = ENOENT;
+	return (-1);
+}
+
+/*ARGSUSED*/
+int
+mdb_lookup_by_obj(const char *obj, const char *name, GElf_Sym *symp)
+{
+	return (mdb_lookup_by_name(name, symp));
+}
+
+int
+mdb_lookup_by_addr(uintptr_t addr, uint_t flags, char *buf, size_t len,
+    GElf_Sym *symp)
+{
+	const host_sym_t *hy = NULL;
+	size_t lo = 0, hi, mid;
+	ssize_t i;
+
+	host_syms_prepare();
+
+	/*
+	 * Find the last symbol at or below addr, then look back for one that
+	 * contains it.
+	 */
+	hi = host_nsyms;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (host_syms[mid].hy_addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = (ssize_t)lo - 1; i >= 0 && i >= (ssize_t)lo - 64; i--) {
+		const host_sym_t *c = &host_syms[i];
+
+		if (flags == MDB_SYM_EXACT) {
+			if (c->hy_addr == addr) {
+				hy = c;
+				break;
+			}
+			continue;
+		}
+
+		if (addr < c->hy_addr + c->hy_size) {
+			hy = c;
+			break;
+		}
+	}
+
+	if (hy == NULL) {
+		host_errmsg = "no symbol corresponds to address";
+		errno = ENOENT;
+		return (-1);
+	}
+
+	if (buf != NULL && len > 0)
+		(void) snprintf(buf, len, "%s", hy->hy_name);
+	if (symp != NULL)
+		host_sym_fill(hy, symp);
+
+	return (0);
+}
+
+ssize_t
+mdb_readsym(void *buf, size_t size, const char *name)
+{
+	GElf_Sym sym;
+
+	if (mdb_lookup_by_name(name, &sym) != 0)
+		return (-1);
+
+	return (mdb_vread(buf, size, sym.st_value));
+}
+
+ssize_t
+mdb_readvar(void *buf, const char *name)
+{
+	GElf_Sym sym;
+
+	if (mdb_lookup_by_name(name, &sym) != 0)
+		return (-1);
+
+	return (mdb_vread(buf, sym.st_size, sym.st_value));
+}
+
+int
+mdb_object_iter(mdb_object_cb_t cb, void *data)
+{
+	mdb_object_t obj;
+	int i;
+
+	for (i = 0; i < host_nobjs; i++) {
+		obj.obj_name = host_objs[i].ho_name;
+		obj.obj_fullname = host_objs[i].ho_fullname;
+		obj.obj_base = host_objs[i].ho_base;
+		obj.obj_size = host_objs[i].ho_size;
+
+		if (cb(&obj, data) != 0)
+			break;
+	}
+
+	return (0);
+}
+
+/*
+ * Loading the target.
+ */
+static const uchar_t *
+host_map(const char *path, size_t *sizep)
+{
+	struct stat st;
+	void *addr;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		(void) fprintf(stderr, "mdb_go_host: failed to open %s: %s\n",
+		    path, strerror(errno));
+		return (NULL);
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		(void) fprintf(stderr, "mdb_go_host: %s is empty\n", path);
+		(void) close(fd);
+		return (NULL);
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+
+	if (addr == MAP_FAILED) {
+		(void) fprintf(stderr, "mdb_go_host: failed to map %s: %s\n",
+		    path, strerror(errno));
+		return (NULL);
+	}
+
+	*sizep = st.st_size;
+	return (addr);
+}
+
+static const Elf64_Ehdr *
+host_elf(const char *path, const uchar_t *base, size_t size)
+{
+	const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)base;
+
+	if (size < sizeof (Elf64_Ehdr) ||
+	    memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+	    ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+		(void) fprintf(stderr, "mdb_go_host: %s is not a 64-bit "
+		    "little-endian ELF file\n", path);
+		return (NULL);
+	}
+
+	if (ehdr->e_phoff + (size_t)ehdr->e_phnum * sizeof (Elf64_Phdr) >
+	    size || ehdr->e_shoff + (size_t)ehdr->e_shnum *
+	    sizeof (Elf64_Shdr) > size) {
+		(void) fprintf(stderr, "mdb_go_host: %s is truncated\n", path);
+		return (NULL);
+	}
+
+	return (ehdr);
+}
+
+int
+mdb_host_load_image(const char *path, uintptr_t addr)
+{
+	const uchar_t *base;
+	size_t size;
+
+	if ((base = host_map(path, &size)) == NULL)
+		return (-1);
+
+	host_seg_add(addr, size, base);
+	mdb_prop_postmortem = 1;
+
+	return (0);
+}
+
+/*
+ * Symbol maps have one symbol per line: address, size and name, with the
+ * numbers in hex.  Blank lines and lines starting with '#' are ignored.
+ */
+int
+mdb_host_load_symbols(const char *path)
+{
+	char line[1024], name[1024];
+	unsigned long long addr, size;
+	FILE *fp;
+	int lineno = 0;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		(void) fprintf(stderr, "mdb_go_host: failed to open %s: %s\n",
+		    path, strerror(errno));
+		return (-1);
+	}
+
+	while (fgets(line, sizeof (line), fp) != NULL) {
+		lineno++;
+
+		if (line[0] == '#' || line[strspn(line, " \t\n")] == '\0')
+			continue;
+
+		if (sscanf(line, "%llx %llx %1023s", &addr, &size, name) != 3) {
+			(void) fprintf(stderr, "mdb_go_host: %s:%d: expected "
+			    "\"address size name\"\n", path, lineno);
+			continue;
+		}
+
+		host_sym_add(host_strdup(name), (uintptr_t)addr, (size_t)size,
+		    ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT));
+	}
+
+	(void) fclose(fp);
+	return (0);
+}
+
+static void
+host_core_notes(const uchar_t *base, size_t size, const Elf64_Phdr *phdr)
+{
+	const uchar_t *p, *end;
+	boolean_t have_prstatus = B_FALSE;
+	size_t i;
+
+	if (phdr->p_offset + phdr->p_filesz > size)
+		return;
+
+	p = base + phdr->p_offset;
+	end = p + phdr->p_filesz;
+
+	while (p + sizeof (Elf64_Nhdr) <= end) {
+		const Elf64_Nhdr *nhdr = (const Elf64_Nhdr *)p;
+		const uchar_t *desc;
+
+		desc = p + sizeof (Elf64_Nhdr) + ((nhdr->n_namesz + 3) & ~3);
+		p = desc + ((nhdr->n_descsz + 3) & ~3);
+
+		if (p > end)
+			break;
+
+		/*
+		 * The first NT_PRSTATUS is the thread that took the signal.
+		 * Its registers follow 112 bytes of signal and process
+		 * information, in struct user_regs_struct order.
+		 */
+		if (nhdr->n_type == NT_PRSTATUS && !have_prstatus &&
+		    nhdr->n_descsz >= 112 + HOST_NREGS * sizeof (uint64_t)) {
+			for (i = 0; i < HOST_NREGS; i++) {
+				if (host_regs_valid[i])
+					continue;
+				bcopy(desc + 112 + i * sizeof (uint64_t),
+				    &host_regs[i], sizeof (uint64_t));
+				host_regs_valid[i] = B_TRUE;
+			}
+			have_prstatus = B_TRUE;
+		}
+
+		if (nhdr->n_type == NT_AUXV) {
+			const Elf64_auxv_t *av = (const Elf64_auxv_t *)desc;
+
+			for (i = 0; i < nhdr->n_descsz / sizeof (*av); i++) {
+				if (av[i].a_type == AT_ENTRY)
+					host_at_entry = av[i].a_un.a_val;
+			}
+		}
+	}
+}
+
+int
+mdb_host_load_core(const char *path)
+{
+	const Elf64_Ehdr *ehdr;
+	const Elf64_Phdr *phdr;
+	const uchar_t *base;
+	size_t size;
+	int i;
+
+	if ((base = host_map(path, &size)) == NULL ||
+	    (ehdr = host_elf(path, base, size)) == NULL)
+		return (-1);
+
+	if (ehdr->e_type != ET_CORE) {
+		(void) fprintf(stderr, "mdb_go_host: %s is not a core file\n",
+		    path);
+		return (-1);
+	}
+
+	phdr = (const Elf64_Phdr *)(base + ehdr->e_phoff);
+
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr[i].p_type == PT_NOTE)
+			host_core_notes(base, size, &phdr[i]);
+
+		if (phdr[i].p_type != PT_LOAD || phdr[i].p_filesz == 0 ||
+		    phdr[i].p_offset + phdr[i].p_filesz > size)
+			continue;
+
+		host_seg_add(phdr[i].p_vaddr, phdr[i].p_filesz,
+		    base + phdr[i].p_offset);
+	}
+
+	host_have_core = B_TRUE;
+	mdb_prop_postmortem = 1;
+
+	return (0);
+}
+
+int
+mdb_host_load_exec(const char *path)
+{
+	const Elf64_Ehdr *ehdr;
+	const Elf64_Phdr *phdr;
+	const Elf64_Shdr *shdr;
+	const uchar_t *base;
+	uintptr_t bias = 0, lo = UINTPTR_MAX, hi = 0;
+	size_t size, i, j;
+	host_obj_t *ho;
+	const char *slash;
+
+	if ((base = host_map(path, &size)) == NULL ||
+	    (ehdr = host_elf(path, base, size)) == NULL)
+		return (-1);
+
+	if (ehdr->e_type != ET_EXEC && ehdr->e_type != ET_DYN) {
+		(void) fprintf(stderr, "mdb_go_host: %s is not an executable\n",
+		    path);
+		return (-1);
+	}
+
+	if (ehdr->e_type == ET_DYN && host_at_entry != 0)
+		bias = host_at_entry - ehdr->e_entry;
+
+	phdr = (const Elf64_Phdr *)(base + ehdr->e_phoff);
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr[i].p_type != PT_LOAD)
+			continue;
+
+		if (phdr[i].p_vaddr + bias < lo)
+			lo = phdr[i].p_vaddr + bias;
+		if (phdr[i].p_vaddr + bias + phdr[i].p_memsz > hi)
+			hi = phdr[i].p_vaddr + bias + phdr[i].p_memsz;
+
+		if (phdr[i].p_offset + phdr[i].p_filesz > size)
+			continue;
+
+		host_seg_add(phdr[i].p_vaddr + bias, phdr[i].p_filesz,
+		    base + phdr[i].p_offset);
+	}
+
+	shdr = (const Elf64_Shdr *)(base + ehdr->e_shoff);
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		const Elf64_Sym *syms;
+		const char *strtab;
+		size_t nsyms, strsz;
+
+		if (shdr[i].sh_type != SHT_SYMTAB)
+			continue;
+
+		if (shdr[i].sh_link >= ehdr->e_shnum ||
+		    shdr[i].sh_offset + shdr[i].sh_size > size ||
+		    shdr[shdr[i].sh_link].sh_offset +
+		    shdr[shdr[i].sh_link].sh_size > size)
+			continue;
+
+		syms = (const Elf64_Sym *)(base + shdr[i].sh_offset);
+		nsyms = shdr[i].sh_size / sizeof (Elf64_Sym);
+		strtab = (const char *)(base + shdr[shdr[i].sh_link].sh_offset);
+		strsz = shdr[shdr[i].sh_link].sh_size;
+
+		for (j = 1; j < nsyms; j++) {
+			uchar_t type = ELF64_ST_TYPE(syms[j].st_info);
+
+			if (syms[j].st_shndx == SHN_UNDEF ||
+			    syms[j].st_name >= strsz ||
+			    type == STT_SECTION || type == STT_FILE)
+				continue;
+
+			host_sym_add(strtab + syms[j].st_name,
+			    syms[j].st_value + (syms[j].st_shndx == SHN_ABS ?
+			    0 : bias), syms[j].st_size, syms[j].st_info);
+		}
+	}
+
+	if (host_nobjs < HOST_MAXOBJS) {
+		ho = &host_objs[host_nobjs++];
+		slash = strrchr(path, '/');
+		ho->ho_name = host_strdup(slash != NULL ? slash + 1 : path);
+		ho->ho_fullname = host_strdup(path);
+		ho->ho_base = lo;
+		ho->ho_size = hi > lo ? hi - lo : 0;
+	}
+
+	return (0);
+}
+
+/*
+ * Registers.
+ */
+int
+mdb_host_set_reg(const char *name, uint64_t value)
+{
+	size_t i;
+
+	for (i = 0; i < HOST_NREGS; i++) {
+		if (strcmp(host_regnames[i], name) == 0) {
+			host_regs[i] = value;
+			host_regs_valid[i] = B_TRUE;
+			return (0);
+		}
+	}
+
+	(void) fprintf(stderr, "mdb_go_host: unknown register %s\n", name);
+	return (-1);
+}
+
+/*ARGSUSED*/
+int
+mdb_getareg(mdb_tid_t tid, const char *name, mdb_reg_t *rp)
+{
+	size_t i;
+
+	for (i = 0; i < HOST_NREGS; i++) {
+		if (strcmp(host_regnames[i], name) == 0 && host_regs_valid[i]) {
+			*rp = host_regs[i];
+			return (0);
+		}
+	}
+
+	host_errmsg = "register not available";
+	return (-1);
+}
+
+int
+mdb_get_state(void)
+{
+	return (mdb_prop_postmortem ? MDB_STATE_DEAD : MDB_STATE_IDLE);
+}
+
+void *
+mdb_callback_add(int class, mdb_callback_f func, void *arg)
+{
+	host_cb_t *hc = host_zalloc(sizeof (host_cb_t));
+
+	hc->hc_class = class;
+	hc->hc_func = func;
+	hc->hc_arg = arg;
+	hc->hc_next = host_cbs;
+	host_cbs = hc;
+
+	return (hc);
+}
+
+void
+mdb_callback_remove(void *hdl)
+{
+	host_cb_t **hcp;
+
+	for (hcp = &host_cbs; *hcp != NULL; hcp = &(*hcp)->hc_next) {
+		if (*hcp == hdl) {
+			*hcp = ((host_cb_t *)hdl)->hc_next;
+			free(hdl);
+			return;
+		}
+	}
+}
+
+/*
+ * Memory allocation.
+ */
+void *
+mdb_alloc(size_t size, uint_t flags)
+{
+	void *buf = host_zalloc(size);
+	host_gc_t *hg;
+
+	if (flags & UM_GC) {
+		hg = host_zalloc(sizeof (host_gc_t));
+		hg->hg_buf = buf;
+		hg->hg_next = host_gc;
+		host_gc = hg;
+	}
+
+	return (buf);
+}
+
+void *
+mdb_zalloc(size_t size, uint_t flags)
+{
+	return (mdb_alloc(size, flags));
+}
+
+/*ARGSUSED*/
+void
+mdb_free(void *buf, size_t size)
+{
+	free(buf);
+}
+
+static void
+host_gc_run(void)
+{
+	host_gc_t *hg;
+
+	while ((hg = host_gc) != NULL) {
+		host_gc = hg->hg_next;
+		free(hg->hg_buf);
+		free(hg);
+	}
+}
+
+hrtime_t
+mdb_gethrtime(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((hrtime_t)ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+/*
+ * Numbers.  As in mdb, the default radix is 16.
+ */
+static int
+host_strtoull(const char *s, u_longlong_t *vp)
+{
+	u_longlong_t v = 0;
+	int base = 16, d;
+
+	if (s[0] == '0' && s[1] != '\0') {
+		switch (s[1]) {
+		case 'x':
+		case 'X':
+			base = 16;
+			s += 2;
+			break;
+		case 't':
+		case 'T':
+			base = 10;
+			s += 2;
+			break;
+		case 'o':
+		case 'O':
+			base = 8;
+			s += 2;
+			break;
+		case 'i':
+		case 'I':
+			base = 2;
+			s += 2;
+			break;
+		}
+	}
+
+	if (*s == '\0')
+		return (-1);
+
+	for (; *s != '\0'; s++) {
+		if (isdigit((uchar_t)*s))
+			d = *s - '0';
+		else if (isxdigit((uchar_t)*s))
+			d = tolower((uchar_t)*s) - 'a' + 10;
+		else
+			return (-1);
+
+		if (d >= base)
+			return (-1);
+		v = v * base + d;
+	}
+
+	*vp = v;
+	return (0);
+}
+
+u_longlong_t
+mdb_strtoull(const char *s)
+{
+	u_longlong_t v;
+
+	if (host_strtoull(s, &v) != 0) {
+		mdb_warn("failed to parse \"%s\" as a number\n", s);
+		return (0);
+	}
+
+	return (v);
+}
+
+/*
+ * Formatted output.  mdb_printf() accepts printf(3C) conversions and adds
+ * a few of its own: %p prints a uintptr_t in hex, %a prints an address
+ * symbolically, a width of ? is the width of a pointer in hex, and %<...>
+ * sets text attributes, which we ignore.  The target radix is always 16, so
+ * %r is %x.
+ */
+static void
+host_vformat(host_buf_t *hb, const char *fmt, va_list ap)
+{
+	char spec[64], out[1024];
+	const char *p;
+	size_t n;
+	int lmod;
+
+	for (p = fmt; *p != '\0'; p++) {
+		if (*p != '%') {
+			host_buf_append(hb, p, 1);
+			continue;
+		}
+
+		p++;
+
+		if (*p == '%') {
+			host_buf_append(hb, "%", 1);
+			continue;
+		}
+
+		if (*p == '<') {
+			while (*p != '\0' && *p != '>')
+				p++;
+			if (*p == '\0')
+				break;
+			continue;
+		}
+
+		n = 0;
+		spec[n++] = '%';
+
+		while (*p != '\0' && strchr("-+ #0", *p) != NULL &&
+		    n < sizeof (spec) - 32)
+			spec[n++] = *p++;
+
+		if (*p == '*') {
+			n += snprintf(spec + n, sizeof (spec) - n, "%d",
+			    va_arg(ap, int));
+			p++;
+		} else if (*p == '?') {
+			n += snprintf(spec + n, sizeof (spec) - n, "%d",
+			    (int)sizeof (uintptr_t) * 2);
+			p++;
+		} else {
+			while (isdigit((uchar_t)*p) && n < sizeof (spec) - 32)
+				spec[n++] = *p++;
+		}
+
+		if (*p == '.') {
+			spec[n++] = *p++;
+			if (*p == '*') {
+				n += snprintf(spec + n, sizeof (spec) - n, "%d",
+				    va_arg(ap, int));
+				p++;
+			} else {
+				while (isdigit((uchar_t)*p) &&
+				    n < sizeof (spec) - 32)
+					spec[n++] = *p++;
+			}
+		}
+
+		lmod = 0;
+		while (*p == 'l' || *p == 'h' || *p == 'z' || *p == 'j') {
+			if (*p == 'l' || *p == 'z' || *p == 'j')
+				lmod++;
+			p++;
+		}
+
+		switch (*p) {
+		case 'p':
+			(void) strcpy(spec + n, "lx");
+			(void) snprintf(out, sizeof (out), spec,
+			    (unsigned long)va_arg(ap, uintptr_t));
+			break;
+
+		case 'a':
+		case 'A': {
+			uintptr_t addr = va_arg(ap, uintptr_t);
+			char name[512], sym[600];
+			GElf_Sym s;
+
+			if (mdb_lookup_by_addr(addr, MDB_SYM_FUZZY, name,
+			    sizeof (name), &s) == 0) {
+				if (addr == s.st_value) {
+					(void) snprintf(sym, sizeof (sym), "%s",
+					    name);
+				} else {
+					(void) snprintf(sym, sizeof (sym),
+					    "%s+0x%lx", name,
+					    (unsigned long)(addr - s.st_value));
+				}
+			} else {
+				(void) snprintf(sym, sizeof (sym), "0x%lx",
+				    (unsigned long)addr);
+			}
+
+			(void) strcpy(spec + n, "s");
+			(void) snprintf(out, sizeof (out), spec, sym);
+			break;
+		}
+
+		case 'd':
+		case 'i':
+			spec[n] = '\0';
+			if (lmod >= 2) {
+				(void) strcat(spec, "lld");
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, long long));
+			} else if (lmod == 1) {
+				(void) strcat(spec, "ld");
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, long));
+			} else {
+				(void) strcat(spec, "d");
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, int));
+			}
+			break;
+
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		case 'r':
+			spec[n] = '\0';
+			(void) strcat(spec, lmod >= 2 ? "ll" : lmod == 1 ?
+			    "l" : "");
+			n = strlen(spec);
+			spec[n++] = *p == 'r' ? 'x' : *p;
+			spec[n] = '\0';
+			if (lmod >= 2) {
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, unsigned long long));
+			} else if (lmod == 1) {
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, unsigned long));
+			} else {
+				(void) snprintf(out, sizeof (out), spec,
+				    va_arg(ap, unsigned int));
+			}
+			break;
+
+		case 'c':
+			(void) strcpy(spec + n, "c");
+			(void) snprintf(out, sizeof (out), spec, va_arg(ap, int));
+			break;
+
+		case 's': {
+			const char *s = va_arg(ap, const char *);
+
+			(void) strcpy(spec + n, "s");
+			(void) snprintf(out, sizeof (out), spec,
+			    s != NULL ? s : "<NULL>");
+			break;
+		}
+
+		case 'Y': {
+			time_t t = va_arg(ap, time_t);
+			struct tm tm;
+
+			(void) strftime(out, sizeof (out), "%Y %b %e %T",
+			    gmtime_r(&t, &tm));
+			break;
+		}
+
+		case '\0':
+			p--;
+			out[0] = '\0';
+			break;
+
+		default:
+			(void) snprintf(out, sizeof (out), "%%%c", *p);
+			break;
+		}
+
+		host_buf_append(hb, out, strlen(out));
+	}
+}
+
+static void
+host_emit(const char *s, size_t len)
+{
+	size_t i, j;
+
+	if (host_quiet_output && host_capture == NULL)
+		return;
+
+	for (i = 0; i < len; i = j) {
+		if (host_bol && s[i] != '\n') {
+			for (j = 0; j < host_indent; j++) {
+				if (host_capture != NULL)
+					host_buf_append(host_capture, " ", 1);
+				else
+					(void) fputc(' ', stdout);
+			}
+		}
+
+		for (j = i; j < len && s[j] != '\n'; j++)
+			continue;
+		if (j < len)
+			j++;
+
+		if (host_capture != NULL)
+			host_buf_append(host_capture, s + i, j - i);
+		else
+			(void) fwrite(s + i, 1, j - i, stdout);
+
+		host_bol = s[j - 1] == '\n';
+	}
+}
+
+void
+mdb_printf(const char *fmt, ...)
+{
+	host_buf_t hb;
+	va_list ap;
+
+	bzero(&hb, sizeof (hb));
+	va_start(ap, fmt);
+	host_vformat(&hb, fmt, ap);
+	va_end(ap);
+
+	if (hb.hb_len != 0)
+		host_emit(hb.hb_buf, hb.hb_len);
+
+	host_buf_fini(&hb);
+}
+
+/*
+ * As in mdb, a warning that does not end in a newline is followed by a
+ * description of the most recent error.
+ */
+void
+mdb_warn(const char *fmt, ...)
+{
+	host_buf_t hb;
+	va_list ap;
+
+	bzero(&hb, sizeof (hb));
+	va_start(ap, fmt);
+	host_vformat(&hb, fmt, ap);
+	va_end(ap);
+
+	if (host_quiet_output) {
+		host_buf_fini(&hb);
+		return;
+	}
+
+	(void) fflush(stdout);
+	(void) fprintf(stderr, "mdb: %s", hb.hb_buf != NULL ? hb.hb_buf : "");
+	if (hb.hb_len == 0 || hb.hb_buf[hb.hb_len - 1] != '\n') {
+		(void) fprintf(stderr, ": %s\n", host_errmsg != NULL ?
+		    host_errmsg : "unknown error");
+	}
+
+	host_buf_fini(&hb);
+}
+
+size_t
+mdb_snprintf(char *buf, size_t size, const char *fmt, ...)
+{
+	host_buf_t hb;
+	va_list ap;
+	size_t len;
+
+	bzero(&hb, sizeof (hb));
+	va_start(ap, fmt);
+	host_vformat(&hb, fmt, ap);
+	va_end(ap);
+
+	len = hb.hb_len;
+	if (size > 0) {
+		size_t n = len < size - 1 ? len : size - 1;
+
+		if (n > 0)
+			bcopy(hb.hb_buf, buf, n);
+		buf[n] = '\0';
+	}
+
+	host_buf_fini(&hb);
+	return (len);
+}
+
+void
+mdb_inc_indent(ulong_t n)
+{
+	host_indent += n;
+}
+
+void
+mdb_dec_indent(ulong_t n)
+{
+	host_indent = n > host_indent ? 0 : host_indent - n;
+}
+
+/*
+ * Options.
+ */
+typedef struct host_opt {
+	char ho_c;
+	uint_t ho_type;
+	uint_t ho_bits;
+	void *ho_p;
+	void *ho_p2;
+} host_opt_t;
+
+int
+mdb_getopts(int argc, const mdb_arg_t *argv, ...)
+{
+	host_opt_t opts[64];
+	int nopts = 0, i, j;
+	va_list ap;
+	int c;
+
+	va_start(ap, argv);
+	while (nopts < 64 && (c = va_arg(ap, int)) != 0) {
+		host_opt_t *o = &opts[nopts++];
+
+		o->ho_c = (char)c;
+		o->ho_type = va_arg(ap, uint_t);
+
+		switch (o->ho_type) {
+		case MDB_OPT_SETBITS:
+		case MDB_OPT_CLRBITS:
+			o->ho_bits = va_arg(ap, uint_t);
+			o->ho_p = va_arg(ap, void *);
+			break;
+		case MDB_OPT_UINTPTR_SET:
+			o->ho_p2 = va_arg(ap, void *);
+			o->ho_p = va_arg(ap, void *);
+			break;
+		default:
+			o->ho_p = va_arg(ap, void *);
+			break;
+		}
+	}
+	va_end(ap);
+
+	for (i = 0; i < argc; i++) {
+		const char *s;
+
+		if (argv[i].a_type != MDB_TYPE_STRING ||
+		    argv[i].a_un.a_str[0] != '-' ||
+		    argv[i].a_un.a_str[1] == '\0')
+			break;
+
+		if (strcmp(argv[i].a_un.a_str, "--") == 0)
+			return (i + 1);
+
+		for (s = argv[i].a_un.a_str + 1; *s != '\0'; s++) {
+			host_opt_t *o = NULL;
+			const char *val = NULL;
+			u_longlong_t v = 0;
+
+			for (j = 0; j < nopts; j++) {
+				if (opts[j].ho_c == *s) {
+					o = &opts[j];
+					break;
+				}
+			}
+
+			if (o == NULL) {
+				mdb_warn("illegal option -- %c\n", *s);
+				return (i);
+			}
+
+			if (o->ho_type == MDB_OPT_SETBITS) {
+				*(uint_t *)o->ho_p |= o->ho_bits;
+				continue;
+			}
+
+			if (o->ho_type == MDB_OPT_CLRBITS) {
+				*(uint_t *)o->ho_p &= ~o->ho_bits;
+				continue;
+			}
+
+			/*
+			 * The rest take a value: the rest of this argument,
+			 * or the next one.
+			 */
+			if (s[1] != '\0') {
+				val = s + 1;
+			} else if (i + 1 < argc) {
+				i++;
+				if (argv[i].a_type == MDB_TYPE_IMMEDIATE)
+					v = argv[i].a_un.a_val;
+				else
+					val = argv[i].a_un.a_str;
+			} else {
+				mdb_warn("option requires an argument -- %c\n",
+				    *s);
+				return (i);
+			}
+
+			if (o->ho_type == MDB_OPT_STR) {
+				if (val == NULL) {
+					mdb_warn("option -%c requires a "
+					    "string\n", o->ho_c);
+					return (i);
+				}
+				*(const char **)o->ho_p = val;
+				break;
+			}
+
+			if (val != NULL && host_strtoull(val, &v) != 0) {
+				mdb_warn("failed to parse \"%s\" as a "
+				    "number\n", val);
+				return (i);
+			}
+
+			switch (o->ho_type) {
+			case MDB_OPT_UINTPTR:
+				*(uintptr_t *)o->ho_p = (uintptr_t)v;
+				break;
+			case MDB_OPT_UINT64:
+				*(uint64_t *)o->ho_p = (uint64_t)v;
+				break;
+			case MDB_OPT_UINTPTR_SET:
+				*(uintptr_t *)o->ho_p = (uintptr_t)v;
+				*(boolean_t *)o->ho_p2 = B_TRUE;
+				break;
+			}
+			break;
+		}
+	}
+
+	return (i);
+}
+
+/*
+ * Pipes.
+ */
+void
+mdb_get_pipe(mdb_pipe_t *p)
+{
+	/* as in mdb, this includes the address the dcmd was called with */
+	if (host_pipe_ndx > 0 && host_pipe_ndx <= host_pipe_nin) {
+		p->pipe_data = &host_pipe_in[host_pipe_ndx - 1];
+		p->pipe_len = host_pipe_nin - host_pipe_ndx + 1;
+		host_pipe_ndx = host_pipe_nin;
+	} else {
+		p->pipe_data = NULL;
+		p->pipe_len = 0;
+	}
+}
+
+void
+mdb_set_pipe(const mdb_pipe_t *p)
+{
+	uintptr_t *nout;
+
+	nout = host_zalloc((host_pipe_nout + p->pipe_len) * sizeof (uintptr_t));
+	if (host_pipe_out != NULL) {
+		bcopy(host_pipe_out, nout, host_pipe_nout * sizeof (uintptr_t));
+		free(host_pipe_out);
+	}
+	bcopy(p->pipe_data, nout + host_pipe_nout,
+	    p->pipe_len * sizeof (uintptr_t));
+	host_pipe_out = nout;
+	host_pipe_nout += p->pipe_len;
+	host_pipe_set = B_TRUE;
+}
+
+/*
+ * Dcmds and walkers.
+ */
+static const char *
+host_unscope(const char *name)
+{
+	const char *tick = strrchr(name, '`');
+
+	return (tick != NULL ? tick + 1 : name);
+}
+
+static const mdb_dcmd_t *
+host_dcmd(const char *name)
+{
+	const mdb_dcmd_t *dc;
+
+	if (host_modinfo == NULL)
+		return (NULL);
+
+	name = host_unscope(name);
+	for (dc = host_modinfo->mi_dcmds; dc->dc_name != NULL; dc++) {
+		if (strcmp(dc->dc_name, name) == 0)
+			return (dc);
+	}
+
+	return (NULL);
+}
+
+static const mdb_walker_t *
+host_walker(const char *name)
+{
+	const mdb_walker_t *w;
+
+	if (host_modinfo == NULL)
+		return (NULL);
+
+	name = host_unscope(name);
+	for (w = host_modinfo->mi_walkers; w->walk_name != NULL; w++) {
+		if (strcmp(w->walk_name, name) == 0)
+			return (w);
+	}
+
+	return (NULL);
+}
+
+typedef struct host_layer_arg {
+	const mdb_walker_t *hla_walker;
+	mdb_walk_state_t *hla_wsp;
+	int hla_status;
+} host_layer_arg_t;
+
+static int
+host_layer_cb(uintptr_t addr, const void *data, void *arg)
+{
+	host_layer_arg_t *hla = arg;
+
+	hla->hla_wsp->walk_addr = addr;
+	hla->hla_wsp->walk_layer = data;
+	hla->hla_status = hla->hla_walker->walk_step(hla->hla_wsp);
+
+	return (hla->hla_status == WALK_NEXT ? WALK_NEXT : WALK_DONE);
+}
+
+int
+mdb_pwalk(const char *name, mdb_walk_cb_t cb, void *data, uintptr_t addr)
+{
+	const mdb_walker_t *w;
+	mdb_walk_state_t ws;
+	host_layer_t **hlp, *hl;
+	int rv;
+
+	if ((w = host_walker(name)) == NULL) {
+		host_errmsg = "walker name does not exist";
+		mdb_warn("couldn't walk %s", name);
+		return (-1);
+	}
+
+	bzero(&ws, sizeof (ws));
+	ws.walk_callback = cb;
+	ws.walk_cbdata = data;
+	ws.walk_addr = addr;
+	ws.walk_arg = w->walk_init_arg;
+
+	if (w->walk_init != NULL && (rv = w->walk_init(&ws)) != WALK_NEXT) {
+		if (w->walk_fini != NULL)
+			w->walk_fini(&ws);
+		return (rv == WALK_DONE ? 0 : -1);
+	}
+
+	/*
+	 * If the walker layered itself over another, drive the lower walk
+	 * and step this one for each of its elements.
+	 */
+	for (hlp = &host_layers; (hl = *hlp) != NULL; hlp = &hl->hl_next) {
+		if (hl->hl_wsp == &ws)
+			break;
+	}
+
+	if (hl != NULL) {
+		host_layer_arg_t hla;
+
+		*hlp = hl->hl_next;
+		hla.hla_walker = w;
+		hla.hla_wsp = &ws;
+		hla.hla_status = WALK_DONE;
+		rv = mdb_pwalk(hl->hl_name, host_layer_cb, &hla, 0);
+		free(hl);
+		if (rv == 0)
+			rv = hla.hla_status == WALK_ERR ? WALK_ERR : WALK_DONE;
+		else
+			rv = WALK_ERR;
+	} else {
+		while ((rv = w->walk_step(&ws)) == WALK_NEXT)
+			continue;
+	}
+
+	if (w->walk_fini != NULL)
+		w->walk_fini(&ws);
+
+	return (rv == WALK_ERR ? -1 : 0);
+}
+
+int
+mdb_walk(const char *name, mdb_walk_cb_t cb, void *data)
+{
+	return (mdb_pwalk(name, cb, data, 0));
+}
+
+int
+mdb_layered_walk(const char *name, mdb_walk_state_t *wsp)
+{
+	host_layer_t *hl;
+
+	if (host_walker(name) == NULL) {
+		host_errmsg = "walker name does not exist";
+		return (-1);
+	}
+
+	hl = host_zalloc(sizeof (host_layer_t));
+	hl->hl_wsp = wsp;
+	hl->hl_name = name;
+	hl->hl_next = host_layers;
+	host_layers = hl;
+
+	return (0);
+}
+
+static void
+host_usage(const mdb_dcmd_t *dc)
+{
+	mdb_printf("Usage: ::%s %s\n", dc->dc_name,
+	    dc->dc_usage != NULL ? dc->dc_usage : "");
+}
+
+int
+mdb_call_dcmd(const char *name, uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	const mdb_dcmd_t *dc;
+	int rv;
+
+	if ((dc = host_dcmd(name)) == NULL) {
+		host_errmsg = "unknown dcmd name";
+		mdb_warn("failed to call %s", name);
+		return (DCMD_ERR);
+	}
+
+	if ((rv = dc->dc_funcp(addr, flags, argc, argv)) == DCMD_USAGE)
+		host_usage(dc);
+
+	return (rv);
+}
+
+typedef struct host_walk_dcmd {
+	const mdb_dcmd_t *hwd_dcmd;
+	int hwd_argc;
+	const mdb_arg_t *hwd_argv;
+	uint_t hwd_flags;
+} host_walk_dcmd_t;
+
+/*ARGSUSED*/
+static int
+host_walk_dcmd_cb(uintptr_t addr, const void *data, void *arg)
+{
+	host_walk_dcmd_t *hwd = arg;
+	int rv;
+
+	rv = hwd->hwd_dcmd->dc_funcp(addr, hwd->hwd_flags, hwd->hwd_argc,
+	    hwd->hwd_argv);
+	hwd->hwd_flags &= ~DCMD_LOOPFIRST;
+
+	if (rv == DCMD_USAGE) {
+		host_usage(hwd->hwd_dcmd);
+		return (WALK_ERR);
+	}
+
+	return (rv == DCMD_ABORT ? WALK_ERR : WALK_NEXT);
+}
+
+int
+mdb_pwalk_dcmd(const char *wname, const char *dcname, int argc,
+    const mdb_arg_t *argv, uintptr_t addr)
+{
+	host_walk_dcmd_t hwd;
+
+	if ((hwd.hwd_dcmd = host_dcmd(dcname)) == NULL) {
+		host_errmsg = "unknown dcmd name";
+		mdb_warn("failed to call %s", dcname);
+		return (-1);
+	}
+
+	hwd.hwd_argc = argc;
+	hwd.hwd_argv = argv;
+	hwd.hwd_flags = DCMD_ADDRSPEC | DCMD_LOOP | DCMD_LOOPFIRST;
+
+	return (mdb_pwalk(wname, host_walk_dcmd_cb, &hwd, addr));
+}
+
+int
+mdb_walk_dcmd(const char *wname, const char *dcname, int argc,
+    const mdb_arg_t *argv)
+{
+	return (mdb_pwalk_dcmd(wname, dcname, argc, argv, 0));
+}
+
+/*
+ * Built-in dcmds.
+ */
+/*ARGSUSED*/
+static int
+host_walk_print(uintptr_t addr, const void *data, void *arg)
+{
+	mdb_printf("%#lr\n", addr);
+	return (WALK_NEXT);
+}
+
+static int
+host_builtin_walk(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	if (argc != 1 || argv[0].a_type != MDB_TYPE_STRING) {
+		mdb_printf("Usage: [addr]::walk walker-name\n");
+		return (DCMD_USAGE);
+	}
+
+	if (mdb_pwalk(argv[0].a_un.a_str, host_walk_print, NULL,
+	    (flags & DCMD_ADDRSPEC) ? addr : 0) != 0)
+		return (DCMD_ERR);
+
+	return (DCMD_OK);
+}
+
+/*ARGSUSED*/
+static int
+host_builtin_dcmds(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	const mdb_dcmd_t *dc;
+
+	for (dc = host_modinfo->mi_dcmds; dc->dc_name != NULL; dc++)
+		mdb_printf("%-16s - %s\n", dc->dc_name, dc->dc_descr);
+
+	return (DCMD_OK);
+}
+
+/*ARGSUSED*/
+static int
+host_builtin_walkers(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	const mdb_walker_t *w;
+
+	for (w = host_modinfo->mi_walkers; w->walk_name != NULL; w++)
+		mdb_printf("%-16s - %s\n", w->walk_name, w->walk_descr);
+
+	return (DCMD_OK);
+}
+
+/*ARGSUSED*/
+static int
+host_builtin_help(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	const mdb_dcmd_t *dc;
+
+	if (argc != 1 || argv[0].a_type != MDB_TYPE_STRING)
+		return (host_builtin_dcmds(addr, flags, 0, NULL));
+
+	if ((dc = host_dcmd(argv[0].a_un.a_str)) == NULL) {
+		mdb_warn("unknown dcmd %s\n", argv[0].a_un.a_str);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("NAME\n  %s - %s\n\nSYNOPSIS\n  [ addr ] ::%s %s\n",
+	    dc->dc_name, dc->dc_descr, dc->dc_name,
+	    dc->dc_usage != NULL ? dc->dc_usage : "");
+
+	if (dc->dc_help != NULL) {
+		mdb_printf("\nDESCRIPTION\n");
+		mdb_inc_indent(2);
+		dc->dc_help();
+		mdb_dec_indent(2);
+	}
+
+	return (DCMD_OK);
+}
+
+static const mdb_dcmd_t host_builtins[] = {
+	{ "walk", "walker-name", "walk data structure",
+	    host_builtin_walk },
+	{ "dcmds", NULL, "list available debugger commands",
+	    host_builtin_dcmds },
+	{ "walkers", NULL, "list available walkers", host_builtin_walkers },
+	{ "help", "[cmd]", "list commands/command help", host_builtin_help },
+	{ NULL }
+};
+
+/*
+ * Command lines.
+ */
+typedef struct host_stage {
+	char *hs_addr;			/* address expression, or NULL */
+	const mdb_dcmd_t *hs_dcmd;
+	int hs_argc;
+	mdb_arg_t hs_argv[64];
+} host_stage_t;
+
+static int
+host_eval(const char *expr, uintptr_t *vp)
+{
+	char term[512];
+	const char *p = expr;
+	uintptr_t v = 0;
+	int sign = 1;
+	size_t n;
+
+	while (*p != '\0') {
+		u_longlong_t t;
+		GElf_Sym sym;
+
+		while (isspace((uchar_t)*p))
+			p++;
+
+		for (n = 0; *p != '\0' && *p != '+' && *p != '-' &&
+		    !isspace((uchar_t)*p) && n < sizeof (term) - 1; p++)
+			term[n++] = *p;
+		term[n] = '\0';
+
+		if (n == 0)
+			return (-1);
+
+		if (host_strtoull(term, &t) == 0) {
+			v += sign * (uintptr_t)t;
+		} else if (mdb_lookup_by_name(term, &sym) == 0) {
+			v += sign * (uintptr_t)sym.st_value;
+		} else {
+			mdb_warn("failed to evaluate %s: unknown symbol name\n",
+			    term);
+			return (-1);
+		}
+
+		while (isspace((uchar_t)*p))
+			p++;
+
+		if (*p == '+') {
+			sign = 1;
+			p++;
+		} else if (*p == '-') {
+			sign = -1;
+			p++;
+		}
+	}
+
+	*vp = v;
+	return (0);
+}
+
+/*
+ * Split a stage into its address expression, dcmd and arguments.  Arguments
+ * are separated by whitespace and may be quoted with double quotes.
+ */
+static int
+host_parse_stage(char *s, host_stage_t *hs)
+{
+	char *colons, *name, *p;
+
+	bzero(hs, sizeof (*hs));
+
+	if ((colons = strstr(s, "::")) == NULL) {
+		mdb_warn("expected ::dcmd in \"%s\"\n", s);
+		return (-1);
+	}
+
+	*colons = '\0';
+	for (p = s; isspace((uchar_t)*p); p++)
+		continue;
+	if (*p != '\0')
+		hs->hs_addr = p;
+
+	name = colons + 2;
+	for (p = name; *p != '\0' && !isspace((uchar_t)*p); p++)
+		continue;
+	if (*p != '\0')
+		*p++ = '\0';
+
+	if ((hs->hs_dcmd = host_dcmd(name)) == NULL) {
+		const mdb_dcmd_t *dc;
+
+		for (dc = host_builtins; dc->dc_name != NULL; dc++) {
+			if (strcmp(dc->dc_name, name) == 0)
+				break;
+		}
+
+		if (dc->dc_name == NULL) {
+			mdb_warn("'%s' is not a dcmd\n", name);
+			return (-1);
+		}
+
+		hs->hs_dcmd = dc;
+	}
+
+	for (;;) {
+		char *arg;
+
+		while (isspace((uchar_t)*p))
+			p++;
+		if (*p == '\0')
+			break;
+
+		if (hs->hs_argc == sizeof (hs->hs_argv) /
+		    sizeof (hs->hs_argv[0])) {
+			mdb_warn("too many arguments\n");
+			return (-1);
+		}
+
+		if (*p == '"') {
+			arg = ++p;
+			while (*p != '\0' && *p != '"')
+				p++;
+		} else {
+			arg = p;
+			while (*p != '\0' && !isspace((uchar_t)*p))
+				p++;
+		}
+
+		if (*p != '\0')
+			*p++ = '\0';
+
+		hs->hs_argv[hs->hs_argc].a_type = MDB_TYPE_STRING;
+		hs->hs_argv[hs->hs_argc].a_un.a_str = arg;
+		hs->hs_argc++;
+	}
+
+	return (0);
+}
+
+/*
+ * Turn a stage's captured output into addresses for the next stage: as in
+ * mdb, each line is evaluated and lines that don't evaluate are skipped.
+ */
+static void
+host_parse_output(const char *out, uintptr_t **vp, size_t *np)
+{
+	const char *p = out, *eol;
+	uintptr_t *v = NULL;
+	size_t n = 0, nalloc = 0;
+
+	while (p != NULL && *p != '\0') {
+		char tok[64];
+		u_longlong_t val;
+		size_t len;
+
+		if ((eol = strchr(p, '\n')) == NULL)
+			eol = p + strlen(p);
+
+		while (p < eol && isspace((uchar_t)*p))
+			p++;
+		for (len = 0; p + len < eol && !isspace((uchar_t)p[len]) &&
+		    len < sizeof (tok) - 1; len++)
+			tok[len] = p[len];
+		tok[len] = '\0';
+
+		if (len != 0 && host_strtoull(tok, &val) == 0) {
+			if (n == nalloc) {
+				uintptr_t *nv;
+
+				nalloc = nalloc == 0 ? 64 : nalloc * 2;
+				nv = host_zalloc(nalloc * sizeof (uintptr_t));
+				if (v != NULL) {
+					bcopy(v, nv, n * sizeof (uintptr_t));
+					free(v);
+				}
+				v = nv;
+			}
+			v[n++] = (uintptr_t)val;
+		}
+
+		p = *eol == '\0' ? NULL : eol + 1;
+	}
+
+	*vp = v;
+	*np = n;
+}
+
+static int
+host_run_stage(host_stage_t *hs, uintptr_t addr, uint_t flags)
+{
+	int rv = hs->hs_dcmd->dc_funcp(addr, flags, hs->hs_argc, hs->hs_argv);
+
+	if (rv == DCMD_USAGE)
+		host_usage(hs->hs_dcmd);
+
+	return (rv);
+}
+
+int
+mdb_host_run(const char *cmdline)
+{
+	host_stage_t stages[16];
+	char *line, *s, *bar;
+	uintptr_t *in = NULL, addr;
+	size_t nin = 0, j;
+	int nstages = 0, i, rv = DCMD_OK;
+
+	line = host_strdup(cmdline);
+
+	for (s = line; s != NULL; s = bar) {
+		if ((bar = strchr(s, '|')) != NULL)
+			*bar++ = '\0';
+
+		if (s[strspn(s, " \t\n")] == '\0') {
+			if (nstages == 0 && bar == NULL)
+				goto out;
+			mdb_warn("syntax error near '|'\n");
+			rv = DCMD_ERR;
+			goto out;
+		}
+
+		if (nstages == sizeof (stages) / sizeof (stages[0])) {
+			mdb_warn("pipeline too long\n");
+			rv = DCMD_ERR;
+			goto out;
+		}
+
+		if (host_parse_stage(s, &stages[nstages]) != 0) {
+			rv = DCMD_ERR;
+			goto out;
+		}
+		nstages++;
+	}
+
+	for (i = 0; i < nstages; i++) {
+		host_stage_t *hs = &stages[i];
+		boolean_t last = (i == nstages - 1);
+		uint_t pflags = last ? 0 : DCMD_PIPE_OUT;
+		host_buf_t out;
+
+		bzero(&out, sizeof (out));
+		host_capture = last ? NULL : &out;
+		host_pipe_out = NULL;
+		host_pipe_nout = 0;
+		host_pipe_set = B_FALSE;
+
+		if (i == 0) {
+			if (hs->hs_addr != NULL) {
+				if (host_eval(hs->hs_addr, &addr) != 0) {
+					rv = DCMD_ERR;
+				} else {
+					rv = host_run_stage(hs, addr,
+					    DCMD_ADDRSPEC | pflags);
+				}
+			} else {
+				rv = host_run_stage(hs, 0, pflags);
+			}
+		} else {
+			host_pipe_in = in;
+			host_pipe_nin = nin;
+
+			for (j = 0; j < nin; j++) {
+				host_pipe_ndx = j + 1;
+				rv = host_run_stage(hs, in[j], DCMD_ADDRSPEC |
+				    DCMD_LOOP | DCMD_PIPE | pflags |
+				    (j == 0 ? DCMD_LOOPFIRST : 0));
+				if (rv == DCMD_ABORT || rv == DCMD_USAGE)
+					break;
+				if (host_pipe_ndx > j + 1)
+					j = host_pipe_ndx - 1;
+			}
+
+			host_pipe_in = NULL;
+			host_pipe_nin = 0;
+			host_pipe_ndx = 0;
+		}
+
+		host_capture = NULL;
+		free(in);
+		in = NULL;
+		nin = 0;
+
+		if (!last) {
+			if (host_pipe_set) {
+				in = host_pipe_out;
+				nin = host_pipe_nout;
+				host_pipe_out = NULL;
+			} else {
+				host_parse_output(out.hb_buf, &in, &nin);
+			}
+		}
+
+		free(host_pipe_out);
+		host_pipe_out = NULL;
+		host_buf_fini(&out);
+
+		if (rv == DCMD_USAGE || rv == DCMD_ABORT)
+			break;
+	}
+
+out:
+	free(in);
+	free(line);
+	host_gc_run();
+	(void) fflush(stdout);
+
+	return (rv);
+}
+
+int
+mdb_host_init(void)
+{
+	if ((host_modinfo = _mdb_init()) == NULL) {
+		(void) fprintf(stderr, "mdb_go_host: module failed to load\n");
+		return (-1);
+	}
+
+	if (host_modinfo->mi_dvers != MDB_API_VERSION) {
+		(void) fprintf(stderr, "mdb_go_host: module API version %d "
+		    "is not %d\n", host_modinfo->mi_dvers, MDB_API_VERSION);
+		return (-1);
+	}
+
+	return (0);
+}
+
+void
+mdb_host_fini(void)
+{
+	_mdb_fini();
+	host_modinfo = NULL;
+	host_gc_run();
+}
+
+void
+mdb_host_quiet(boolean_t quiet)
+{
+	host_quiet_output = quiet;
+}
+
+void
+mdb_host_stats(mdb_host_stats_t *stats)
+{
+	*stats = host_stats;
+}
@@ -0,0 +1,73 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+#ifndef	_MDB_HOST_H
+#define	_MDB_HOST_H
+
+/*
+ * Host-side harness for the Go dmod: loads a target and runs dcmds against it
+ * without mdb(1).  See mdb_host.c.
+ */
+
+#include <sys/mdb_modapi.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct mdb_host_stats {
+	uint64_t mhs_reads;		/* mdb_vread() and friends */
+	uint64_t mhs_bytes;		/* bytes returned by those reads */
+} mdb_host_stats_t;
+
+/*
+ * Target construction.  Memory sources loaded first take precedence where
+ * they overlap: load raw images, then the core, then the executable.
+ */
+extern int mdb_host_load_image(const char *, uintptr_t);
+extern int mdb_host_load_core(const char *);
+extern int mdb_host_load_exec(const char *);
+extern int mdb_host_load_symbols(const char *);
+extern int mdb_host_set_reg(const char *, uint64_t);
+
+/*
+ * Load the module (calling its _mdb_init()), run command lines against it,
+ * and unload it.
+ */
+extern int mdb_host_init(void);
+extern int mdb_host_run(const char *);
+extern void mdb_host_fini(void);
+
+/*
+ * Discard output and warnings (for benchmarks), and report reads of the
+ * target.
+ */
+extern void mdb_host_quiet(boolean_t);
+extern void mdb_host_stats(mdb_host_stats_t *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _MDB_HOST_H */
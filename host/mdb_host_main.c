@@ -0,0 +1,140 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * mdb_go_host: run the Go dmod's dcmds against a core, an executable and/or
+ * raw memory images.  Commands come from the command line or, if there are
+ * none, one per line from standard input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mdb_host.h"
+
+#define	MAXIMAGES	64
+
+static void
+usage(const char *arg0)
+{
+	(void) fprintf(stderr, "usage: %s [-e exec] [-c core] "
+	    "[-r image@addr]... [-s symmap]... [-R reg=value]... "
+	    "[command ...]\n", arg0);
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *exec = NULL, *core = NULL;
+	char *images[MAXIMAGES], *regs[MAXIMAGES], *symmaps[MAXIMAGES];
+	int nimages = 0, nregs = 0, nsymmaps = 0;
+	char line[4096], *at, *eq;
+	int c, i, err = 0;
+
+	while ((c = getopt(argc, argv, "e:c:r:s:R:")) != -1) {
+		switch (c) {
+		case 'e':
+			exec = optarg;
+			break;
+		case 'c':
+			core = optarg;
+			break;
+		case 'r':
+			if (nimages == MAXIMAGES)
+				usage(argv[0]);
+			images[nimages++] = optarg;
+			break;
+		case 's':
+			if (nsymmaps == MAXIMAGES)
+				usage(argv[0]);
+			symmaps[nsymmaps++] = optarg;
+			break;
+		case 'R':
+			if (nregs == MAXIMAGES)
+				usage(argv[0]);
+			regs[nregs++] = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/*
+	 * Raw images first, then the core, then the executable: see
+	 * mdb_host.h.
+	 */
+	for (i = 0; i < nimages; i++) {
+		if ((at = strrchr(images[i], '@')) == NULL)
+			usage(argv[0]);
+		*at++ = '\0';
+		if (mdb_host_load_image(images[i],
+		    (uintptr_t)strtoull(at, NULL, 16)) != 0)
+			return (1);
+	}
+
+	if (core != NULL && mdb_host_load_core(core) != 0)
+		return (1);
+
+	if (exec != NULL && mdb_host_load_exec(exec) != 0)
+		return (1);
+
+	for (i = 0; i < nsymmaps; i++) {
+		if (mdb_host_load_symbols(symmaps[i]) != 0)
+			return (1);
+	}
+
+	for (i = 0; i < nregs; i++) {
+		if ((eq = strchr(regs[i], '=')) == NULL)
+			usage(argv[0]);
+		*eq++ = '\0';
+		if (mdb_host_set_reg(regs[i], strtoull(eq, NULL, 16)) != 0)
+			return (1);
+	}
+
+	if (mdb_host_init() != 0)
+		return (1);
+
+	if (optind < argc) {
+		for (i = optind; i < argc; i++) {
+			if (mdb_host_run(argv[i]) != DCMD_OK)
+				err = 1;
+		}
+	} else {
+		while (fgets(line, sizeof (line), stdin) != NULL) {
+			line[strcspn(line, "\n")] = '\0';
+			if (strcmp(line, "::quit") == 0 ||
+			    strcmp(line, "$q") == 0)
+				break;
+			if (mdb_host_run(line) != DCMD_OK)
+				err = 1;
+		}
+	}
+
+	mdb_host_fini();
+
+	return (err);
+}
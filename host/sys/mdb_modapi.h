@@ -0,0 +1,223 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+#ifndef	_SYS_MDB_MODAPI_H
+#define	_SYS_MDB_MODAPI_H
+
+/*
+ * Stand-in for the illumos debugger module API, covering the subset of it
+ * that the Go dmod uses.  Together with mdb_host.c this lets the module's
+ * dcmds and walkers be built and run on hosts without mdb(1).  Types and
+ * constants match their illumos definitions so that source built against
+ * this header builds unchanged against the real one.
+ */
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <elf.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef unsigned char uchar_t;
+typedef unsigned short ushort_t;
+typedef unsigned int uint_t;
+typedef unsigned long ulong_t;
+typedef long long longlong_t;
+typedef unsigned long long u_longlong_t;
+typedef long long hrtime_t;
+typedef enum { B_FALSE, B_TRUE } boolean_t;
+
+typedef Elf64_Sym GElf_Sym;
+
+typedef uint64_t mdb_reg_t;
+typedef uintptr_t mdb_tid_t;
+
+#define	MDB_API_VERSION	5
+
+#define	DCMD_OK		0		/* Dcmd completed successfully */
+#define	DCMD_ERR	1		/* Dcmd failed due to an error */
+#define	DCMD_USAGE	2		/* Dcmd usage error; abort and print */
+#define	DCMD_NEXT	3		/* Invoke next dcmd in precedence list */
+#define	DCMD_ABORT	4		/* Dcmd failed; abort current loop */
+
+#define	DCMD_ADDRSPEC	0x01		/* Dcmd invoked with explicit address */
+#define	DCMD_LOOP	0x02		/* Dcmd invoked in loop with ,cnt */
+#define	DCMD_LOOPFIRST	0x04		/* Dcmd invoked as first iteration */
+#define	DCMD_PIPE	0x08		/* Dcmd invoked with input from pipe */
+#define	DCMD_PIPE_OUT	0x10		/* Dcmd invoked with output set to pipe */
+
+#define	DCMD_HDRSPEC(fl)	(((fl) & DCMD_LOOPFIRST) || !((fl) & DCMD_LOOP))
+
+#define	WALK_ERR	-1		/* Walk fatal error (terminate walk) */
+#define	WALK_NEXT	0		/* Walk should continue to next step */
+#define	WALK_DONE	1		/* Walk is complete (no errors) */
+
+#define	UM_NOSLEEP	0x0		/* Allocation may fail */
+#define	UM_SLEEP	0x1		/* Allocation must succeed */
+#define	UM_GC		0x2		/* Free at end of current command */
+
+#define	MDB_TYPE_STRING		0	/* a_un.a_str is valid */
+#define	MDB_TYPE_IMMEDIATE	1	/* a_un.a_val is valid */
+#define	MDB_TYPE_CHAR		2	/* a_un.a_char is valid */
+
+#define	MDB_OPT_SETBITS		1	/* Set specified flag bits */
+#define	MDB_OPT_CLRBITS		2	/* Clear specified flag bits */
+#define	MDB_OPT_STR		3	/* const char * argument */
+#define	MDB_OPT_UINTPTR		4	/* uintptr_t argument */
+#define	MDB_OPT_UINT64		5	/* uint64_t argument */
+#define	MDB_OPT_UINTPTR_SET	6	/* boolean_t+uintptr_t argument */
+
+#define	MDB_SYM_FUZZY		0	/* Match closest address */
+#define	MDB_SYM_EXACT		1	/* Match exact address only */
+
+#define	MDB_CALLBACK_STCHG	1
+#define	MDB_CALLBACK_PROMPT	2
+
+#define	MDB_STATE_IDLE		0	/* Target is idle (not running yet) */
+#define	MDB_STATE_RUNNING	1	/* Target is currently executing */
+#define	MDB_STATE_STOPPED	2	/* Target is stopped */
+#define	MDB_STATE_UNDEAD	3	/* Target is undead (zombie) */
+#define	MDB_STATE_DEAD		4	/* Target is dead (core dump) */
+#define	MDB_STATE_LOST		5	/* Target lost by debugger */
+
+typedef struct mdb_arg {
+	int a_type;
+	union {
+		const char *a_str;
+		uint64_t a_val;
+		char a_char;
+	} a_un;
+} mdb_arg_t;
+
+typedef int (*mdb_walk_cb_t)(uintptr_t, const void *, void *);
+
+typedef struct mdb_walk_state {
+	mdb_walk_cb_t walk_callback;	/* Callback to issue */
+	void *walk_cbdata;		/* Callback private data */
+	uintptr_t walk_addr;		/* Current address */
+	void *walk_data;		/* Walk private data */
+	void *walk_arg;			/* Walk private argument */
+	const void *walk_layer;		/* Data from underlying layer */
+} mdb_walk_state_t;
+
+typedef int mdb_dcmd_f(uintptr_t, uint_t, int, const mdb_arg_t *);
+
+typedef struct mdb_tab_cookie mdb_tab_cookie_t;
+typedef int mdb_dcmd_tab_f(mdb_tab_cookie_t *, uint_t, int,
+    const mdb_arg_t *);
+
+typedef struct mdb_dcmd {
+	const char *dc_name;		/* Command name */
+	const char *dc_usage;		/* Usage message (optional) */
+	const char *dc_descr;		/* Description */
+	mdb_dcmd_f *dc_funcp;		/* Command function */
+	void (*dc_help)(void);		/* Command help function (or NULL) */
+	mdb_dcmd_tab_f *dc_tabp;	/* Tab completion function */
+} mdb_dcmd_t;
+
+typedef struct mdb_walker {
+	const char *walk_name;		/* Walk type name */
+	const char *walk_descr;		/* Walk description */
+	int (*walk_init)(mdb_walk_state_t *);	/* Walk constructor */
+	int (*walk_step)(mdb_walk_state_t *);	/* Walk iterator */
+	void (*walk_fini)(mdb_walk_state_t *);	/* Walk destructor */
+	void *walk_init_arg;		/* Walk constructor argument */
+} mdb_walker_t;
+
+typedef struct mdb_modinfo {
+	ushort_t mi_dvers;		/* Debugger version number */
+	const mdb_dcmd_t *mi_dcmds;	/* NULL-terminated list of dcmds */
+	const mdb_walker_t *mi_walkers;	/* NULL-terminated list of walks */
+} mdb_modinfo_t;
+
+typedef struct mdb_pipe {
+	uintptr_t *pipe_data;		/* Array of pipe values */
+	size_t pipe_len;		/* Array length */
+} mdb_pipe_t;
+
+typedef struct mdb_object {
+	const char *obj_name;		/* name of object */
+	const char *obj_fullname;	/* full name of object */
+	uintptr_t obj_base;		/* base address of object */
+	uintptr_t obj_size;		/* in memory size of object in bytes */
+} mdb_object_t;
+
+typedef int (*mdb_object_cb_t)(mdb_object_t *, void *);
+typedef void (*mdb_callback_f)(void *);
+
+extern int mdb_prop_postmortem;		/* Are we looking at a static dump? */
+extern int mdb_prop_kernel;		/* Are we looking at a kernel? */
+
+extern int mdb_pwalk(const char *, mdb_walk_cb_t, void *, uintptr_t);
+extern int mdb_walk(const char *, mdb_walk_cb_t, void *);
+extern int mdb_pwalk_dcmd(const char *, const char *, int,
+    const mdb_arg_t *, uintptr_t);
+extern int mdb_walk_dcmd(const char *, const char *, int, const mdb_arg_t *);
+extern int mdb_layered_walk(const char *, mdb_walk_state_t *);
+extern int mdb_call_dcmd(const char *, uintptr_t, uint_t, int,
+    const mdb_arg_t *);
+
+extern ssize_t mdb_vread(void *, size_t, uintptr_t);
+extern ssize_t mdb_readstr(char *, size_t, uintptr_t);
+extern ssize_t mdb_readsym(void *, size_t, const char *);
+extern ssize_t mdb_readvar(void *, const char *);
+
+extern int mdb_lookup_by_name(const char *, GElf_Sym *);
+extern int mdb_lookup_by_obj(const char *, const char *, GElf_Sym *);
+extern int mdb_lookup_by_addr(uintptr_t, uint_t, char *, size_t, GElf_Sym *);
+extern int mdb_object_iter(mdb_object_cb_t, void *);
+
+extern int mdb_getareg(mdb_tid_t, const char *, mdb_reg_t *);
+extern int mdb_get_state(void);
+extern void *mdb_callback_add(int, mdb_callback_f, void *);
+extern void mdb_callback_remove(void *);
+
+extern int mdb_getopts(int, const mdb_arg_t *, ...);
+extern u_longlong_t mdb_strtoull(const char *);
+
+extern void *mdb_alloc(size_t, uint_t);
+extern void *mdb_zalloc(size_t, uint_t);
+extern void mdb_free(void *, size_t);
+
+extern void mdb_printf(const char *, ...);
+extern void mdb_warn(const char *, ...);
+extern size_t mdb_snprintf(char *, size_t, const char *, ...);
+extern void mdb_inc_indent(ulong_t);
+extern void mdb_dec_indent(ulong_t);
+
+extern void mdb_get_pipe(mdb_pipe_t *);
+extern void mdb_set_pipe(const mdb_pipe_t *);
+
+extern hrtime_t mdb_gethrtime(void);
+
+extern const mdb_modinfo_t *_mdb_init(void);
+extern void _mdb_fini(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _SYS_MDB_MODAPI_H */
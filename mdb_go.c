@@ -26,10 +26,15 @@
  * mdb(1M) module for debugging Go.
  */
 
+#include <regex.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <sys/mdb_modapi.h>
 
+#include "mdb_go.h"
 #include "mdb_go_types.h"
 
 static int
@@ -78,26 +83,144 @@ load_current_context(uintptr_t *frameptr, uintptr_t *insptr,
 
 /*
  * Go stores a 'pclntab' entry in the binary which contains function
- * information.  At the start is a header containing the following.
+ * information.  At the start is a header containing the following.  The
+ * magic number identifies the format, which has changed several times:
+ *
+ *	0xfffffffb	Go 1.2 to 1.15: the function table follows the header,
+ *			and everything else is addressed by its offset from
+ *			the start of the pclntab.
+ *
+ *	0xfffffffa	Go 1.16 and 1.17: the header gives the offsets of
+ *			separate tables of function names, compilation units,
+ *			file names and pc-value tables, and of the function
+ *			table, and each is addressed from its own start.
+ *
+ *	0xfffffff0	Go 1.18 and 1.19: as for 1.16, but entry PCs are 32-bit
+ *			offsets from the start of the text.
+ *
+ *	0xfffffff1	Go 1.20 on: as for 1.18, with a larger function record.
  */
+#define	GO_PCLN_MAGIC_12	0xfffffffb
+#define	GO_PCLN_MAGIC_116	0xfffffffa
+#define	GO_PCLN_MAGIC_118	0xfffffff0
+#define	GO_PCLN_MAGIC_120	0xfffffff1
+
 struct pctabhdr {
-	uint32_t magic;		/* 0xfffffffb */
+	uint32_t magic;		/* one of the above */
 	uint16_t zeros;		/* 0x0000 */
 	uint8_t quantum;	/* 1 on x86, 4 on ARM */
 	uint8_t ptrsize;	/* sizeof(uintptr_t) */
 	uintptr_t tabsize;	/* size of function symbol table */
 };
+
+/*
+ * Go 1.16 and later follow that with the number of files and the offsets
+ * of the other tables; Go 1.18 and later add the start of the text.
+ */
+typedef struct go_pctabhdr116 {
+	struct pctabhdr ph_hdr;
+	uintptr_t ph_nfiles;
+	uintptr_t ph_funcnametab;
+	uintptr_t ph_cutab;
+	uintptr_t ph_filetab;
+	uintptr_t ph_pctab;
+	uintptr_t ph_functab;
+} go_pctabhdr116_t;
+
+typedef struct go_pctabhdr118 {
+	struct pctabhdr ph_hdr;
+	uintptr_t ph_nfiles;
+	uintptr_t ph_textstart;
+	uintptr_t ph_funcnametab;
+	uintptr_t ph_cutab;
+	uintptr_t ph_filetab;
+	uintptr_t ph_pctab;
+	uintptr_t ph_functab;
+} go_pctabhdr118_t;
+
 /*
  * After the header is a function symbol table, containing entries of the
- * following type.
+ * following type.  Go 1.18 and later use 32-bit entries, which we widen to
+ * this on reading; the offsets are always made relative to the pclntab.
  */
 typedef struct go_func_table {
 	uintptr_t entry;
 	uintptr_t offset;
 } go_functbl_t;
 
+typedef struct go_functbl118 {
+	uint32_t entryoff;
+	uint32_t funcoff;
+} go_functbl118_t;
+
+/*
+ * Function records, as each format stores them.
+ */
+typedef struct go_func12 {
+	uintptr_t entry;
+	uint32_t nameoff;
+	uint32_t args;
+	uint32_t frame;
+	uint32_t pcsp;
+	uint32_t pcfile;
+	uint32_t pcln;
+	uint32_t npcdata;
+	uint32_t nfuncdata;
+} go_func12_t;
+
+typedef struct go_func116 {
+	uintptr_t entry;
+	uint32_t nameoff;
+	uint32_t args;
+	uint32_t deferreturn;
+	uint32_t pcsp;
+	uint32_t pcfile;
+	uint32_t pcln;
+	uint32_t npcdata;
+	uint32_t cuoff;
+	uint8_t funcid;
+	uint8_t pad[2];
+	uint8_t nfuncdata;
+} go_func116_t;
+
+typedef struct go_func118 {
+	uint32_t entryoff;
+	uint32_t nameoff;
+	uint32_t args;
+	uint32_t deferreturn;
+	uint32_t pcsp;
+	uint32_t pcfile;
+	uint32_t pcln;
+	uint32_t npcdata;
+	uint32_t cuoff;
+	uint8_t funcid;
+	uint8_t flag;
+	uint8_t pad;
+	uint8_t nfuncdata;
+} go_func118_t;
+
+typedef struct go_func120 {
+	uint32_t entryoff;
+	uint32_t nameoff;
+	uint32_t args;
+	uint32_t deferreturn;
+	uint32_t pcsp;
+	uint32_t pcfile;
+	uint32_t pcln;
+	uint32_t npcdata;
+	uint32_t cuoff;
+	int32_t startline;
+	uint8_t funcid;
+	uint8_t flag;
+	uint8_t pad;
+	uint8_t nfuncdata;
+} go_func120_t;
+
 /*
- * In-memory function information.
+ * In-memory function information, the same whatever the format.  Name and
+ * table offsets are from the start of the pclntab, and a file number from
+ * a pcfile table is turned into a file key (see go_filename()) by adding
+ * cuoff.  frame is 0 where the format doesn't record it.
  */
 typedef struct go_func {
 	uintptr_t entry;
@@ -109,552 +232,4634 @@ typedef struct go_func {
 	uint32_t pcln;
 	uint32_t npcdata;
 	uint32_t nfuncdata;
+	uint32_t cuoff;
 } go_func_t;
 
+/*
+ * The argument size of assembly functions that don't declare one.
+ */
+#define	GO_ARGS_UNKNOWN		0x80000000U
+
+/*
+ * Each format's decoders, chosen by configure().
+ */
+typedef struct go_pclnfmt {
+	uint32_t gpf_magic;
+	const char *gpf_name;
+	int (*gpf_hdr)(const struct pctabhdr *);
+	go_functbl_t *(*gpf_ftab)(size_t, boolean_t *);
+	int (*gpf_func)(uintptr_t, go_func_t *);
+	int (*gpf_fileoff)(uint32_t, uint32_t *);
+	int (*gpf_funcdata)(uintptr_t, const go_func_t *, uint_t, uintptr_t *);
+	size_t gpf_funcsz;		/* size of a function record */
+	size_t gpf_inlsz;		/* size of an inline tree entry */
+} go_pclnfmt_t;
+
+/*
+ * The Go 1.2 pclntab served Go 1.2 to 1.15, and the function records and
+ * inline trees it points to changed under it, so for it we need to know
+ * the release too: that's x of "go1.x" in runtime.buildVersion.  Releases
+ * before 1.5 don't have the variable, and development builds don't say;
+ * for those go_minor is -1.
+ */
+#define	GO_MINOR_UNKNOWN	(-1)
+
 /*
  * Global storage.
  */
 uintptr_t pclntab;
+size_t pclntabsz;
 uintptr_t ftabsize;
-uint32_t filetab;
-
-#define	GO_FUNCTABLE_OFFSET	(pclntab + sizeof (struct pctabhdr))
+uintptr_t filetab;
+
+static const go_pclnfmt_t *go_pclnfmt;
+static int go_minor = GO_MINOR_UNKNOWN;
+static size_t go_inlsz;			/* 0 if we can't decode the trees */
+static uintptr_t go_functab;		/* these are offsets from pclntab */
+static uintptr_t go_funcnametab;
+static uintptr_t go_cutab;
+static uintptr_t go_pctabbase;
+static uintptr_t go_textstart;
+static uintptr_t go_gofunc;		/* Go 1.18 on; see go_funcdata118() */
+
+#define	GO_FUNCTABLE_OFFSET	(pclntab + go_functab)
 #define	GO_FUNCTABLE_SIZE	(ftabsize * sizeof (go_functbl_t))
 
 #define	GO_FILETABLE_OFFSET	(GO_FUNCTABLE_OFFSET + GO_FUNCTABLE_SIZE)
 
 #define	GO_PCLNTAB_OFFSET(x)	(pclntab + x)
-#define	GO_FILETAB_OFFSET(x)	(filetab + (x * sizeof(filetab)))
+#define	GO_FILETAB_OFFSET(x)	(filetab + (x * sizeof (uint32_t)))
 
 /*
- * Find a corresponding function to an address in the ftab.
+ * Go 1.2: the function table follows the header, and the offset of the file
+ * table is stored in the offset of the final PC.  The table is used in place
+ * if the binary is mapped.
  */
-uintptr_t
-findfunc(uintptr_t addr)
+static int
+go_pcln_hdr12(const struct pctabhdr *phdr)
+{
+	go_functbl_t ftbl;
+
+	go_functab = sizeof (struct pctabhdr);
+
+	if (go_vread(&ftbl, sizeof (ftbl), GO_FILETABLE_OFFSET) == -1) {
+		mdb_warn("Could not read pcvalue table offset\n");
+		return (-1);
+	}
+
+	filetab = GO_PCLNTAB_OFFSET((uint32_t)ftbl.offset);
+	return (0);
+}
+
+static go_functbl_t *
+go_ftab_read12(size_t bytes, boolean_t *borrowedp)
 {
 	go_functbl_t *ftbl;
-	unsigned int nf, n;
-	ssize_t len;
+	size_t avail;
 
-	if (ftabsize == 0) {
-        mdb_warn("findfunc ftabsize == 0");
+	if ((ftbl = (go_functbl_t *)go_elf_ptr(GO_FUNCTABLE_OFFSET,
+	    &avail)) != NULL && avail >= bytes &&
+	    ((uintptr_t)ftbl & (sizeof (uintptr_t) - 1)) == 0) {
+		*borrowedp = B_TRUE;
+		return (ftbl);
+	}
+
+	ftbl = mdb_alloc(bytes, UM_SLEEP);
+	if (go_vread(ftbl, bytes, GO_FUNCTABLE_OFFSET) == -1) {
+		mdb_free(ftbl, bytes);
+		return (NULL);
+	}
+
+	*borrowedp = B_FALSE;
+	return (ftbl);
+}
+
+static int
+go_func_read12(uintptr_t off, go_func_t *f)
+{
+	go_func12_t raw;
+
+	if (go_vread(&raw, sizeof (raw), GO_PCLNTAB_OFFSET(off)) == -1)
+		return (-1);
+
+	f->entry = raw.entry;
+	f->nameoff = raw.nameoff;
+	f->args = raw.args;
+	f->pcsp = raw.pcsp;
+	f->pcfile = raw.pcfile;
+	f->pcln = raw.pcln;
+	f->npcdata = raw.npcdata;
+	f->cuoff = 0;
+
+	/*
+	 * The frame size is only there before Go 1.8; later releases leave
+	 * the word unused, and from Go 1.12 it holds deferreturn.
+	 */
+	if (go_minor != GO_MINOR_UNKNOWN && go_minor < 8)
+		f->frame = raw.frame;
+	else
+		f->frame = 0;
+
+	/*
+	 * From Go 1.10, the last word holds funcID in its low byte and
+	 * nfuncdata in its high byte.
+	 */
+	if (go_minor >= 10)
+		f->nfuncdata = raw.nfuncdata >> 24;
+	else
+		f->nfuncdata = raw.nfuncdata;
+
+	return (0);
+}
+
+static int
+go_fileoff12(uint32_t file, uint32_t *offp)
+{
+	return (go_vread(offp, sizeof (*offp), GO_FILETAB_OFFSET(file)) ==
+	    -1 ? -1 : 0);
+}
+
+/*
+ * Go 1.16 on.  Offsets of pc-value tables are from the start of the pctab,
+ * where offset 0 means there's no table, and offsets of function records
+ * from the start of the function table.
+ */
+static int
+go_pcln_hdr116(const struct pctabhdr *phdr)
+{
+	const go_pctabhdr116_t *hdr = (const go_pctabhdr116_t *)phdr;
+
+	go_funcnametab = hdr->ph_funcnametab;
+	go_cutab = hdr->ph_cutab;
+	filetab = GO_PCLNTAB_OFFSET(hdr->ph_filetab);
+	go_pctabbase = hdr->ph_pctab;
+	go_functab = hdr->ph_functab;
+	go_textstart = 0;
+
+	return (0);
+}
+
+static int
+go_pcln_hdr118(const struct pctabhdr *phdr)
+{
+	const go_pctabhdr118_t *hdr = (const go_pctabhdr118_t *)phdr;
+
+	go_funcnametab = hdr->ph_funcnametab;
+	go_cutab = hdr->ph_cutab;
+	filetab = GO_PCLNTAB_OFFSET(hdr->ph_filetab);
+	go_pctabbase = hdr->ph_pctab;
+	go_functab = hdr->ph_functab;
+	go_textstart = hdr->ph_textstart;
+
+	return (0);
+}
+
+static go_functbl_t *
+go_ftab_read116(size_t bytes, boolean_t *borrowedp)
+{
+	go_functbl_t *ftbl;
+	size_t i;
+
+	ftbl = mdb_alloc(bytes, UM_SLEEP);
+	if (go_vread(ftbl, bytes, GO_FUNCTABLE_OFFSET) == -1) {
+		mdb_free(ftbl, bytes);
+		return (NULL);
+	}
+
+	for (i = 0; i < ftabsize; i++)
+		ftbl[i].offset += go_functab;
+
+	*borrowedp = B_FALSE;
+	return (ftbl);
+}
+
+static go_functbl_t *
+go_ftab_read118(size_t bytes, boolean_t *borrowedp)
+{
+	go_functbl118_t *raw;
+	go_functbl_t *ftbl;
+	size_t rawbytes = (ftabsize + 1) * sizeof (go_functbl118_t), i;
+
+	raw = mdb_alloc(rawbytes, UM_SLEEP);
+	if (go_vread(raw, rawbytes, GO_FUNCTABLE_OFFSET) == -1) {
+		mdb_free(raw, rawbytes);
 		return (NULL);
 	}
 
-	ftbl = mdb_alloc(GO_FUNCTABLE_SIZE, UM_SLEEP);
-	len = mdb_vread(ftbl, GO_FUNCTABLE_SIZE, GO_FUNCTABLE_OFFSET);
+	ftbl = mdb_alloc(bytes, UM_SLEEP);
+	for (i = 0; i <= ftabsize; i++) {
+		ftbl[i].entry = go_textstart + raw[i].entryoff;
+		ftbl[i].offset = go_functab + raw[i].funcoff;
+	}
+	mdb_free(raw, rawbytes);
+
+	*borrowedp = B_FALSE;
+	return (ftbl);
+}
+
+#define	GO_PCTAB116(off)	((off) == 0 ? 0 : (uint32_t)(go_pctabbase + (off)))
+
+static int
+go_func_read116(uintptr_t off, go_func_t *f)
+{
+	go_func116_t raw;
+
+	if (go_vread(&raw, sizeof (raw), GO_PCLNTAB_OFFSET(off)) == -1)
+		return (-1);
+
+	f->entry = raw.entry;
+	f->nameoff = go_funcnametab + raw.nameoff;
+	f->args = raw.args;
+	f->frame = 0;
+	f->pcsp = GO_PCTAB116(raw.pcsp);
+	f->pcfile = GO_PCTAB116(raw.pcfile);
+	f->pcln = GO_PCTAB116(raw.pcln);
+	f->npcdata = raw.npcdata;
+	f->nfuncdata = raw.nfuncdata;
+	f->cuoff = raw.cuoff;
+
+	return (0);
+}
+
+static int
+go_func_read118(uintptr_t off, go_func_t *f)
+{
+	go_func118_t raw;
+
+	if (go_vread(&raw, sizeof (raw), GO_PCLNTAB_OFFSET(off)) == -1)
+		return (-1);
+
+	f->entry = go_textstart + raw.entryoff;
+	f->nameoff = go_funcnametab + raw.nameoff;
+	f->args = raw.args;
+	f->frame = 0;
+	f->pcsp = GO_PCTAB116(raw.pcsp);
+	f->pcfile = GO_PCTAB116(raw.pcfile);
+	f->pcln = GO_PCTAB116(raw.pcln);
+	f->npcdata = raw.npcdata;
+	f->nfuncdata = raw.nfuncdata;
+	f->cuoff = raw.cuoff;
+
+	return (0);
+}
+
+static int
+go_func_read120(uintptr_t off, go_func_t *f)
+{
+	go_func120_t raw;
+
+	if (go_vread(&raw, sizeof (raw), GO_PCLNTAB_OFFSET(off)) == -1)
+		return (-1);
+
+	f->entry = go_textstart + raw.entryoff;
+	f->nameoff = go_funcnametab + raw.nameoff;
+	f->args = raw.args;
+	f->frame = 0;
+	f->pcsp = GO_PCTAB116(raw.pcsp);
+	f->pcfile = GO_PCTAB116(raw.pcfile);
+	f->pcln = GO_PCTAB116(raw.pcln);
+	f->npcdata = raw.npcdata;
+	f->nfuncdata = raw.nfuncdata;
+	f->cuoff = raw.cuoff;
+
+	return (0);
+}
+
+/*
+ * A file key is an index into the cutab, which holds offsets into the file
+ * name table; ~0 marks a file the compilation unit doesn't use.
+ */
+static int
+go_fileoff116(uint32_t key, uint32_t *offp)
+{
+	uint32_t off;
+
+	if (go_vread(&off, sizeof (off), GO_PCLNTAB_OFFSET(go_cutab) +
+	    key * sizeof (uint32_t)) == -1 || off == (uint32_t)-1)
+		return (-1);
+
+	*offp = (uint32_t)(filetab - pclntab) + off;
+	return (0);
+}
+
+/*
+ * A function record is followed by its npcdata pcdata table offsets, which
+ * are made relative to the pclntab just as the pcsp, pcfile and pcln
+ * offsets are, and then its nfuncdata funcdata.  Through Go 1.17 each
+ * funcdata is a pointer, aligned to a pointer.
+ */
+static int
+go_funcdata12(uintptr_t off, const go_func_t *f, uint_t idx, uintptr_t *datap)
+{
+	uintptr_t addr;
+
+	if (idx >= f->nfuncdata)
+		return (-1);
+
+	addr = GO_PCLNTAB_OFFSET(off) + go_pclnfmt->gpf_funcsz +
+	    f->npcdata * sizeof (uint32_t);
+	addr = ((addr + sizeof (uintptr_t) - 1) & ~(sizeof (uintptr_t) - 1)) +
+	    idx * sizeof (uintptr_t);
+
+	if (go_vread(datap, sizeof (*datap), addr) == -1 || *datap == 0)
+		return (-1);
+
+	return (0);
+}
+
+/*
+ * From Go 1.18, each funcdata is a 32-bit offset from the module's gofunc
+ * symbol, with ~0 meaning there is none.
+ */
+static int
+go_funcdata118(uintptr_t off, const go_func_t *f, uint_t idx, uintptr_t *datap)
+{
+	GElf_Sym sym;
+	uint32_t doff;
+
+	if (idx >= f->nfuncdata)
+		return (-1);
+
+	if (go_gofunc == 0) {
+		if (mdb_lookup_by_name("go:func.*", &sym) != 0 &&
+		    mdb_lookup_by_name("go.func.*", &sym) != 0)
+			return (-1);
+		go_gofunc = (uintptr_t)sym.st_value;
+	}
+
+	if (go_vread(&doff, sizeof (doff), GO_PCLNTAB_OFFSET(off) +
+	    go_pclnfmt->gpf_funcsz + (f->npcdata + idx) * sizeof (uint32_t)) ==
+	    -1 || doff == (uint32_t)-1)
+		return (-1);
+
+	*datap = go_gofunc + doff;
+	return (0);
+}
+
+/*
+ * The offset of a function's pcdata table, or 0 if it has none.
+ */
+static uint32_t
+go_pcdata(uintptr_t off, const go_func_t *f, uint_t idx)
+{
+	uint32_t poff;
+
+	if (idx >= f->npcdata || go_vread(&poff, sizeof (poff),
+	    GO_PCLNTAB_OFFSET(off) + go_pclnfmt->gpf_funcsz +
+	    idx * sizeof (uint32_t)) == -1)
+		return (0);
+
+	return (GO_PCTAB116(poff));
+}
+
+/*
+ * The size of a function record, without any padding at the end.
+ */
+#define	GO_FUNC_SIZE(t, last)	(offsetof(t, last) + sizeof (((t *)0)->last))
+
+static const go_pclnfmt_t go_pclnfmts[] = {
+	{ GO_PCLN_MAGIC_12, "Go 1.2", go_pcln_hdr12, go_ftab_read12,
+	    go_func_read12, go_fileoff12, go_funcdata12,
+	    GO_FUNC_SIZE(go_func12_t, nfuncdata), 20 },
+	{ GO_PCLN_MAGIC_116, "Go 1.16", go_pcln_hdr116, go_ftab_read116,
+	    go_func_read116, go_fileoff116, go_funcdata12,
+	    GO_FUNC_SIZE(go_func116_t, nfuncdata), 20 },
+	{ GO_PCLN_MAGIC_118, "Go 1.18", go_pcln_hdr118, go_ftab_read118,
+	    go_func_read118, go_fileoff116, go_funcdata118,
+	    GO_FUNC_SIZE(go_func118_t, nfuncdata), 20 },
+	{ GO_PCLN_MAGIC_120, "Go 1.20", go_pcln_hdr118, go_ftab_read118,
+	    go_func_read120, go_fileoff116, go_funcdata118,
+	    GO_FUNC_SIZE(go_func120_t, nfuncdata), 16 },
+	{ 0 }
+};
+
+/*
+ * Read the function whose record is at the given offset in the pclntab.
+ */
+static int
+go_func_read(uintptr_t off, go_func_t *f)
+{
+	return (go_pclnfmt->gpf_func(off, f));
+}
+
+/*
+ * PC-to-function index, modeled on the runtime's findfunctab.  The text
+ * covered by the function table is cut into fixed-size buckets, each split
+ * into GO_FINDFUNC_NSUB sub-buckets.  A bucket records the index of the
+ * function containing its first PC, and each sub-bucket the distance from
+ * that index to the function containing the sub-bucket's first PC.  A lookup
+ * is then two array references and a short forward scan, instead of a
+ * binary search over the whole table.  A sub-bucket whose delta does not fit
+ * in a byte is marked GO_FINDFUNC_OVERFLOW and falls back to a binary search
+ * bounded by its bucket.
+ */
+#define	GO_FINDFUNC_BUCKETSZ	4096
+#define	GO_FINDFUNC_NSUB	16
+#define	GO_FINDFUNC_SUBSZ	(GO_FINDFUNC_BUCKETSZ / GO_FINDFUNC_NSUB)
+#define	GO_FINDFUNC_OVERFLOW	0xff
+
+typedef struct go_findfuncbucket {
+	uint32_t ffb_idx;
+	uint8_t ffb_sub[GO_FINDFUNC_NSUB];
+} go_findfuncbucket_t;
+
+typedef struct go_findtab {
+	const go_functbl_t *ft_ftab;	/* nfunc + 1 entries */
+	size_t ft_nfunc;
+	uintptr_t ft_minpc;
+	uintptr_t ft_maxpc;
+	go_findfuncbucket_t *ft_buckets;
+	size_t ft_nbuckets;
+} go_findtab_t;
+
+/*
+ * Binary search for the function containing pc in [lo, hi), given that
+ * ftbl[lo].entry <= pc < ftbl[hi].entry.
+ */
+static size_t
+go_ftab_bsearch(const go_functbl_t *ftbl, size_t lo, size_t hi, uintptr_t pc)
+{
+	size_t mid;
+
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (pc < ftbl[mid].entry)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	return (lo);
+}
+
+static int
+go_findtab_build(go_findtab_t *ft, const go_functbl_t *ftbl, size_t nfunc)
+{
+	size_t b, i, idx, nb;
+	uintptr_t pc;
+
+	bzero(ft, sizeof (*ft));
+
+	if (nfunc == 0 || ftbl[nfunc].entry <= ftbl[0].entry)
+		return (-1);
+
+	ft->ft_ftab = ftbl;
+	ft->ft_nfunc = nfunc;
+	ft->ft_minpc = ftbl[0].entry;
+	ft->ft_maxpc = ftbl[nfunc].entry;
+
+	nb = (ft->ft_maxpc - ft->ft_minpc + GO_FINDFUNC_BUCKETSZ - 1) /
+	    GO_FINDFUNC_BUCKETSZ;
+	ft->ft_buckets = mdb_alloc(nb * sizeof (go_findfuncbucket_t),
+	    UM_SLEEP);
+	ft->ft_nbuckets = nb;
+
+	/*
+	 * Both the buckets and the function table are in PC order, so a
+	 * single cursor through the table fills in every sub-bucket.
+	 */
+	idx = 0;
+	for (b = 0; b < nb; b++) {
+		go_findfuncbucket_t *fb = &ft->ft_buckets[b];
+
+		for (i = 0; i < GO_FINDFUNC_NSUB; i++) {
+			pc = ft->ft_minpc + b * GO_FINDFUNC_BUCKETSZ +
+			    i * GO_FINDFUNC_SUBSZ;
+
+			while (idx + 1 < nfunc && ftbl[idx + 1].entry <= pc)
+				idx++;
+
+			if (i == 0)
+				fb->ffb_idx = (uint32_t)idx;
+
+			fb->ffb_sub[i] = idx - fb->ffb_idx < GO_FINDFUNC_OVERFLOW ?
+			    (uint8_t)(idx - fb->ffb_idx) : GO_FINDFUNC_OVERFLOW;
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Check a lookup index that we didn't build ourselves.  A lookup scans
+ * forward from the function its bucket and sub-bucket give, or searches
+ * between adjacent buckets' functions, so those must be in order and within
+ * the table.
+ */
+static int
+go_findtab_check(const go_findtab_t *ft)
+{
+	const go_findfuncbucket_t *fb;
+	uint32_t prev = 0;
+	size_t b;
+	uint_t i;
+
+	for (b = 0; b < ft->ft_nbuckets; b++) {
+		fb = &ft->ft_buckets[b];
+		if (fb->ffb_idx < prev || fb->ffb_idx >= ft->ft_nfunc)
+			return (-1);
+
+		for (i = 0; i < GO_FINDFUNC_NSUB; i++) {
+			if (fb->ffb_sub[i] != GO_FINDFUNC_OVERFLOW &&
+			    (size_t)fb->ffb_idx + fb->ffb_sub[i] >=
+			    ft->ft_nfunc)
+				return (-1);
+		}
+
+		prev = fb->ffb_idx;
+	}
+
+	return (0);
+}
+
+static void
+go_findtab_destroy(go_findtab_t *ft)
+{
+	if (ft->ft_buckets != NULL) {
+		mdb_free(ft->ft_buckets,
+		    ft->ft_nbuckets * sizeof (go_findfuncbucket_t));
+	}
+
+	bzero(ft, sizeof (*ft));
+}
+
+/*
+ * Returns the index in the function table of the function containing pc,
+ * or -1 if pc is outside the table.
+ */
+static ssize_t
+go_findtab_lookup(const go_findtab_t *ft, uintptr_t pc)
+{
+	const go_functbl_t *ftbl = ft->ft_ftab;
+	const go_findfuncbucket_t *fb;
+	uintptr_t x;
+	size_t idx, hi;
+	uint_t sub;
+
+	if (pc < ft->ft_minpc || pc >= ft->ft_maxpc)
+		return (-1);
+
+	x = pc - ft->ft_minpc;
+	fb = &ft->ft_buckets[x / GO_FINDFUNC_BUCKETSZ];
+	sub = fb->ffb_sub[(x % GO_FINDFUNC_BUCKETSZ) / GO_FINDFUNC_SUBSZ];
+
+	if (sub == GO_FINDFUNC_OVERFLOW) {
+		hi = x / GO_FINDFUNC_BUCKETSZ + 1 < ft->ft_nbuckets ?
+		    fb[1].ffb_idx + 1 : ft->ft_nfunc;
+		return (go_ftab_bsearch(ftbl, fb->ffb_idx, hi, pc));
+	}
+
+	for (idx = fb->ffb_idx + sub; ftbl[idx + 1].entry <= pc; idx++)
+		continue;
+
+	return (idx);
+}
+
+/*
+ * The function table is read out of the target once and kept resident for
+ * the life of the target (or used in place in the mapped binary); every PC
+ * lookup is then a search of this copy.  The table has ftabsize + 1 entries:
+ * the last holds the end of the text covered by the table.
+ */
+static go_functbl_t *go_ftab;
+static size_t go_ftab_bytes;
+static go_findtab_t go_findtab;
+static boolean_t go_ftab_mapped;	/* both are in the sidecar index */
+static boolean_t go_ftab_borrowed;	/* the table is in the binary */
+
+/*
+ * The function name and line indexes point into both the function table and
+ * the interned names, so they go whenever either does.
+ */
+static void go_names_flush(void);
+static void go_lines_flush(void);
+
+static void
+go_ftab_reset(void)
+{
+	go_names_flush();
+	go_lines_flush();
+
+	if (go_ftab_mapped) {
+		bzero(&go_findtab, sizeof (go_findtab));
+	} else {
+		go_findtab_destroy(&go_findtab);
+		if (go_ftab != NULL && !go_ftab_borrowed)
+			mdb_free(go_ftab, go_ftab_bytes);
+	}
+
+	go_ftab = NULL;
+	go_ftab_bytes = 0;
+	go_ftab_mapped = B_FALSE;
+	go_ftab_borrowed = B_FALSE;
+}
+
+/*
+ * Use the function table and lookup index from the sidecar index, if it has
+ * them and they hold together: the sections must be the size the number of
+ * functions and the span of their text call for, and every bucket must lead
+ * to a function in the table.
+ */
+static int
+go_ftab_map(void)
+{
+	const go_functbl_t *ftbl;
+	const go_findfuncbucket_t *fb;
+	size_t bytes, fbbytes, nb;
+
+	if ((ftbl = go_index_sect(GO_INDEX_FTAB, &bytes)) == NULL ||
+	    bytes != GO_FUNCTABLE_SIZE + sizeof (go_functbl_t) ||
+	    (fb = go_index_sect(GO_INDEX_BUCKETS, &fbbytes)) == NULL ||
+	    ftbl[ftabsize].entry <= ftbl[0].entry)
+		return (-1);
+
+	nb = (ftbl[ftabsize].entry - ftbl[0].entry + GO_FINDFUNC_BUCKETSZ - 1) /
+	    GO_FINDFUNC_BUCKETSZ;
+	if (fbbytes != nb * sizeof (go_findfuncbucket_t))
+		return (-1);
+
+	go_findtab.ft_ftab = ftbl;
+	go_findtab.ft_nfunc = ftabsize;
+	go_findtab.ft_minpc = ftbl[0].entry;
+	go_findtab.ft_maxpc = ftbl[ftabsize].entry;
+	go_findtab.ft_buckets = (go_findfuncbucket_t *)fb;
+	go_findtab.ft_nbuckets = nb;
+
+	if (go_findtab_check(&go_findtab) != 0) {
+		mdb_warn("ignoring malformed function index in sidecar "
+		    "index\n");
+		bzero(&go_findtab, sizeof (go_findtab));
+		return (-1);
+	}
+
+	go_ftab = (go_functbl_t *)ftbl;
+	go_ftab_bytes = bytes;
+	go_ftab_mapped = B_TRUE;
+
+	return (0);
+}
+
+static go_functbl_t *
+go_ftab_load(void)
+{
+	go_functbl_t *ftbl;
+	boolean_t borrowed;
+	size_t bytes;
+
+	if (go_ftab != NULL)
+		return (go_ftab);
+
+	if (ftabsize == 0) {
+		mdb_warn("findfunc ftabsize == 0");
+		return (NULL);
+	}
+
+	if (go_ftab_map() == 0)
+		return (go_ftab);
+
+	bytes = GO_FUNCTABLE_SIZE + sizeof (go_functbl_t);
+
+	if ((ftbl = go_pclnfmt->gpf_ftab(bytes, &borrowed)) == NULL) {
+		mdb_warn("failed to read function table at %p",
+		    GO_FUNCTABLE_OFFSET);
+		return (NULL);
+	}
+
+	if (go_findtab_build(&go_findtab, ftbl, ftabsize) != 0) {
+		mdb_warn("function table at %p is malformed",
+		    GO_FUNCTABLE_OFFSET);
+		if (!borrowed)
+			mdb_free(ftbl, bytes);
+		return (NULL);
+	}
+
+	go_ftab = ftbl;
+	go_ftab_bytes = bytes;
+	go_ftab_borrowed = borrowed;
+
+	return (go_ftab);
+}
+
+/*
+ * Find a corresponding function to an address in the ftab.
+ */
+static uintptr_t
+go_findfunc(uintptr_t addr, boolean_t warn)
+{
+	go_functbl_t *ftbl;
+	ssize_t idx;
+
+	if ((ftbl = go_ftab_load()) == NULL)
+		return (0);
+
+	if ((idx = go_findtab_lookup(&go_findtab, addr)) == -1) {
+		if (warn)
+			mdb_warn("findfunc addr is outside of symbol table");
+		return (0);
+	}
+
+	return (ftbl[idx].offset);
+}
+
+uintptr_t
+findfunc(uintptr_t addr)
+{
+	return (go_findfunc(addr, B_TRUE));
+}
+
+/*
+ * A pc-value table is a sequence of (value delta, pc delta) varint pairs
+ * terminated by a zero value delta.  Tables are streamed out of the target
+ * through a small buffer that is refilled as the decoder consumes it, so
+ * that tables of any length decode correctly without first having to know
+ * how long they are; if the binary is mapped, they are decoded in place.  A
+ * reader never consumes more than GO_PCTAB_MAXLEN bytes, which bounds the
+ * damage done by a corrupt table.
+ */
+#define	GO_PCREADER_BUFSZ	256
+#define	GO_PCTAB_MAXLEN		(1024 * 1024)
+
+typedef struct go_pcreader {
+	uintptr_t pr_addr;		/* target address of pr_data[pr_len] */
+	const uchar_t *pr_data;		/* pr_buf, or the mapped binary */
+	size_t pr_pos;			/* next byte to decode */
+	size_t pr_len;			/* valid bytes in pr_data */
+	size_t pr_left;			/* bytes we may still fetch */
+	uchar_t pr_buf[GO_PCREADER_BUFSZ];
+} go_pcreader_t;
+
+static void
+go_pcreader_init(go_pcreader_t *pr, uintptr_t addr)
+{
+	pr->pr_addr = addr;
+	pr->pr_pos = 0;
+	pr->pr_len = 0;
+	pr->pr_left = GO_PCTAB_MAXLEN;
+}
+
+/*
+ * Refill the buffer.  A table may end just short of the end of a mapping,
+ * so a read that fails is retried with successively smaller sizes before
+ * we give up.
+ */
+static int
+go_pcreader_fill(go_pcreader_t *pr)
+{
+	const uchar_t *data;
+	size_t len;
+
+	if ((data = go_elf_ptr(pr->pr_addr, &len)) != NULL) {
+		if (len > pr->pr_left)
+			len = pr->pr_left;
+		if (len == 0)
+			return (-1);
+		pr->pr_data = data;
+		pr->pr_addr += len;
+		pr->pr_left -= len;
+		pr->pr_pos = 0;
+		pr->pr_len = len;
+		return (0);
+	}
+
+	len = pr->pr_left < sizeof (pr->pr_buf) ?
+	    pr->pr_left : sizeof (pr->pr_buf);
+
+	for (; len > 0; len /= 2) {
+		if (go_vread(pr->pr_buf, len, pr->pr_addr) == (ssize_t)len)
+			break;
+	}
+
+	if (len == 0)
+		return (-1);
+
+	pr->pr_data = pr->pr_buf;
+	pr->pr_addr += len;
+	pr->pr_left -= len;
+	pr->pr_pos = 0;
+	pr->pr_len = len;
+
+	return (0);
+}
+
+static int
+readvarint(go_pcreader_t *pr, uint32_t *vp)
+{
+	uint32_t v = 0;
+	uint_t shift;
+	uchar_t c;
+
+	for (shift = 0; shift < 35; shift += 7) {
+		if (pr->pr_pos == pr->pr_len && go_pcreader_fill(pr) != 0)
+			return (-1);
+
+		c = pr->pr_data[pr->pr_pos++];
+		v |= (uint32_t)(c & 0x7F) << shift;
+
+		if (!(c & 0x80)) {
+			*vp = v;
+			return (0);
+		}
+	}
+
+	return (-1);
+}
+
+/*
+ * Decode the next entry: returns 1 if *pc and *value were advanced, 0 at the
+ * end of the table and -1 if the table could not be read.
+ */
+static int
+step(go_pcreader_t *pr, uintptr_t *pc, int32_t *value, int first)
+{
+	uint32_t uvdelta, pcdelta;
+
+	if (readvarint(pr, &uvdelta) != 0)
+		return (-1);
+
+	if (uvdelta == 0 && !first)
+		return (0);
+	if (uvdelta & 1)
+		uvdelta = ~(uvdelta >> 1);
+	else
+		uvdelta >>= 1;
+
+	if (readvarint(pr, &pcdelta) != 0)
+		return (-1);
+
+	*value += (int32_t)uvdelta;
+	*pc += pcdelta * GO_PC_QUANTUM;
+	return (1);
+}
+
+/*
+ * Look up the values for n target PCs, sorted in ascending order, in one
+ * pass over a pc-value table.  PCs the table does not cover get -1.
+ */
+static void
+pcvalue_multi(go_func_t *f, int32_t off, const uintptr_t *targetpcs,
+    int32_t *values, size_t n)
+{
+	go_pcreader_t pr;
+	uintptr_t pc;
+	int32_t value;
+	size_t i = 0;
+	int rv = 0;
+
+	if (off != 0) {
+		go_pcreader_init(&pr, pclntab + off);
+		pc = f->entry;
+		value = -1;
+
+		while (i < n &&
+		    (rv = step(&pr, &pc, &value, pc == f->entry)) == 1) {
+			while (i < n && targetpcs[i] < pc)
+				values[i++] = value;
+		}
+
+		if (i < n && rv == -1)
+			mdb_warn("Unable to read pcvalue table at %p\n",
+			    pclntab + off);
+	}
+
+	for (; i < n; i++)
+		values[i] = -1;
+}
+
+/*
+ * Decoded pc-value tables are kept in a cache bounded by go_pctab_max bytes
+ * and evicted least-recently-used first.  A cached table is the list of
+ * runs in the table: each run ends (exclusive) at pt_ends[i] bytes past the
+ * function's entry and has value pt_vals[i], so a lookup is a binary search.
+ * Tables are keyed by their offset in the pclntab alone; the linker may share
+ * a table between functions, which is why the PCs are stored relative to the
+ * entry rather than absolute.
+ */
+#define	GO_PCTAB_HASHSZ		4096
+#define	GO_PCTAB_DEFMAX		(8 * 1024 * 1024)
+
+typedef struct go_pctab {
+	struct go_pctab *pt_hnext;	/* hash chain */
+	struct go_pctab *pt_prev;	/* LRU list, toward most recent */
+	struct go_pctab *pt_next;	/* LRU list, toward least recent */
+	uint32_t pt_off;		/* offset of table in pclntab */
+	uint32_t pt_n;			/* number of runs */
+	size_t pt_size;			/* size of this allocation */
+	uint32_t *pt_ends;
+	int32_t *pt_vals;
+} go_pctab_t;
+
+static go_pctab_t *go_pctab_hash[GO_PCTAB_HASHSZ];
+static go_pctab_t *go_pctab_mru;
+static go_pctab_t *go_pctab_lru;
+static size_t go_pctab_max = GO_PCTAB_DEFMAX;
+static size_t go_pctab_bytes;
+static size_t go_pctab_count;
+static uint64_t go_pctab_hits;
+static uint64_t go_pctab_misses;
+static uint64_t go_pctab_evictions;
+
+#define	GO_PCTAB_HASH(off)	(((off) * 2654435761U) % GO_PCTAB_HASHSZ)
+
+static void
+go_pctab_unlink(go_pctab_t *pt)
+{
+	go_pctab_t **ptp;
+
+	for (ptp = &go_pctab_hash[GO_PCTAB_HASH(pt->pt_off)]; *ptp != pt;
+	    ptp = &(*ptp)->pt_hnext)
+		continue;
+	*ptp = pt->pt_hnext;
+
+	if (pt->pt_prev != NULL)
+		pt->pt_prev->pt_next = pt->pt_next;
+	else
+		go_pctab_mru = pt->pt_next;
+
+	if (pt->pt_next != NULL)
+		pt->pt_next->pt_prev = pt->pt_prev;
+	else
+		go_pctab_lru = pt->pt_prev;
+
+	go_pctab_bytes -= pt->pt_size;
+	go_pctab_count--;
+}
+
+static void
+go_pctab_evict(size_t target)
+{
+	go_pctab_t *pt;
+
+	while (go_pctab_bytes > target && (pt = go_pctab_lru) != NULL) {
+		go_pctab_unlink(pt);
+		mdb_free(pt, pt->pt_size);
+		go_pctab_evictions++;
+	}
+}
+
+static void
+go_pctab_flush(void)
+{
+	go_pctab_evict(0);
+	go_pctab_evictions = 0;
+	go_pctab_hits = 0;
+	go_pctab_misses = 0;
+}
+
+/*
+ * Decode an entire table out of the target.
+ */
+static go_pctab_t *
+go_pctab_decode(go_func_t *f, uint32_t off)
+{
+	go_pcreader_t pr;
+	go_pctab_t *pt;
+	uint32_t *ends, *nends;
+	int32_t *vals, *nvals;
+	uint32_t n = 0, nalloc = 32;
+	uintptr_t pc;
+	int32_t value;
+	size_t size;
+	int rv;
+
+	ends = mdb_alloc(nalloc * sizeof (uint32_t), UM_SLEEP);
+	vals = mdb_alloc(nalloc * sizeof (int32_t), UM_SLEEP);
+
+	go_pcreader_init(&pr, pclntab + off);
+	pc = f->entry;
+	value = -1;
+
+	while ((rv = step(&pr, &pc, &value, pc == f->entry)) == 1) {
+		if (n == nalloc) {
+			nends = mdb_alloc(2 * nalloc * sizeof (uint32_t),
+			    UM_SLEEP);
+			nvals = mdb_alloc(2 * nalloc * sizeof (int32_t),
+			    UM_SLEEP);
+			bcopy(ends, nends, n * sizeof (uint32_t));
+			bcopy(vals, nvals, n * sizeof (int32_t));
+			mdb_free(ends, nalloc * sizeof (uint32_t));
+			mdb_free(vals, nalloc * sizeof (int32_t));
+			ends = nends;
+			vals = nvals;
+			nalloc *= 2;
+		}
+
+		ends[n] = (uint32_t)(pc - f->entry);
+		vals[n] = value;
+		n++;
+	}
+
+	pt = NULL;
+
+	if (rv == 0) {
+		size = sizeof (go_pctab_t) +
+		    n * (sizeof (uint32_t) + sizeof (int32_t));
+		pt = mdb_zalloc(size, UM_SLEEP);
+		pt->pt_off = off;
+		pt->pt_n = n;
+		pt->pt_size = size;
+		pt->pt_ends = (uint32_t *)(pt + 1);
+		pt->pt_vals = (int32_t *)(pt->pt_ends + n);
+		bcopy(ends, pt->pt_ends, n * sizeof (uint32_t));
+		bcopy(vals, pt->pt_vals, n * sizeof (int32_t));
+	} else {
+		mdb_warn("Unable to read pcvalue table at %p\n",
+		    pclntab + off);
+	}
+
+	mdb_free(ends, nalloc * sizeof (uint32_t));
+	mdb_free(vals, nalloc * sizeof (int32_t));
+
+	return (pt);
+}
+
+static go_pctab_t *
+go_pctab_lookup(go_func_t *f, uint32_t off)
+{
+	go_pctab_t *pt;
+	uint_t h = GO_PCTAB_HASH(off);
+
+	for (pt = go_pctab_hash[h]; pt != NULL; pt = pt->pt_hnext) {
+		if (pt->pt_off != off)
+			continue;
+
+		go_pctab_hits++;
+
+		if (pt != go_pctab_mru) {
+			pt->pt_prev->pt_next = pt->pt_next;
+			if (pt->pt_next != NULL)
+				pt->pt_next->pt_prev = pt->pt_prev;
+			else
+				go_pctab_lru = pt->pt_prev;
+
+			pt->pt_prev = NULL;
+			pt->pt_next = go_pctab_mru;
+			go_pctab_mru->pt_prev = pt;
+			go_pctab_mru = pt;
+		}
+
+		return (pt);
+	}
+
+	go_pctab_misses++;
+
+	if ((pt = go_pctab_decode(f, off)) == NULL)
+		return (NULL);
+
+	/*
+	 * A table too big for the cache is handed back uncached; the caller
+	 * frees it once it has its answer.
+	 */
+	if (pt->pt_size > go_pctab_max)
+		return (pt);
+
+	go_pctab_evict(go_pctab_max - pt->pt_size);
+
+	pt->pt_hnext = go_pctab_hash[h];
+	go_pctab_hash[h] = pt;
+	pt->pt_next = go_pctab_mru;
+	if (go_pctab_mru != NULL)
+		go_pctab_mru->pt_prev = pt;
+	else
+		go_pctab_lru = pt;
+	go_pctab_mru = pt;
+
+	go_pctab_bytes += pt->pt_size;
+	go_pctab_count++;
+
+	return (pt);
+}
+
+static int32_t
+go_pctab_value(const go_pctab_t *pt, uintptr_t pcoff)
+{
+	uint32_t lo = 0, hi = pt->pt_n, mid;
+
+	/*
+	 * Find the first run that ends beyond pcoff.
+	 */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (pt->pt_ends[mid] <= pcoff)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo < pt->pt_n ? pt->pt_vals[lo] : -1);
+}
+
+/*
+ * In the sidecar index, each pc-value table is a go_idxpc_t giving the
+ * offset in the pclntab, the number of runs, and the offset in the
+ * GO_INDEX_PCDATA section of the table's ends and then its values, laid out
+ * just as in a go_pctab_t.
+ */
+typedef struct go_idxpc {
+	uint32_t ip_off;
+	uint32_t ip_n;
+	uint64_t ip_data;
+} go_idxpc_t;
+
+static int
+go_pctab_mapped(uint32_t off, go_pctab_t *pt)
+{
+	const go_idxpc_t *ip;
+	const char *data;
+	size_t n, datasz, lo, hi, mid;
+
+	if ((ip = go_index_sect(GO_INDEX_PCIDX, &n)) == NULL ||
+	    (data = go_index_sect(GO_INDEX_PCDATA, &datasz)) == NULL)
+		return (-1);
+
+	for (lo = 0, hi = n / sizeof (go_idxpc_t); lo < hi; ) {
+		mid = lo + (hi - lo) / 2;
+		if (ip[mid].ip_off < off) {
+			lo = mid + 1;
+		} else if (ip[mid].ip_off > off) {
+			hi = mid;
+		} else {
+			if (ip[mid].ip_data > datasz ||
+			    (uint64_t)ip[mid].ip_n * (sizeof (uint32_t) +
+			    sizeof (int32_t)) > datasz - ip[mid].ip_data)
+				return (-1);
+
+			bzero(pt, sizeof (*pt));
+			pt->pt_off = off;
+			pt->pt_n = ip[mid].ip_n;
+			pt->pt_ends = (uint32_t *)(data + ip[mid].ip_data);
+			pt->pt_vals = (int32_t *)(pt->pt_ends + pt->pt_n);
+			return (0);
+		}
+	}
+
+	return (-1);
+}
+
+static int32_t
+pcvalue(go_func_t *f, int32_t off, uintptr_t targetpc)
+{
+	go_pctab_t *pt, mapped;
+	int32_t value;
+
+	if (off == 0 || targetpc < f->entry)
+		return (-1);
+
+	if (go_pctab_mapped((uint32_t)off, &mapped) == 0)
+		return (go_pctab_value(&mapped, targetpc - f->entry));
+
+	/*
+	 * With the cache disabled, stream the table just as far as we need.
+	 */
+	if (go_pctab_max == 0) {
+		pcvalue_multi(f, off, &targetpc, &value, 1);
+		return (value);
+	}
+
+	if ((pt = go_pctab_lookup(f, (uint32_t)off)) == NULL)
+		return (-1);
+
+	value = go_pctab_value(pt, targetpc - f->entry);
+
+	if (pt->pt_size > go_pctab_max)
+		mdb_free(pt, pt->pt_size);
+
+	return (value);
+}
+
+/*
+ * Function and file names are interned: each is read out of the target once,
+ * with reads sized to the string rather than to a fixed buffer, and copied
+ * into an append-only arena.  The pointers handed out stay valid until the
+ * target changes.  Function names are keyed by their offset in the pclntab,
+ * file names by their file key (see go_filename()).
+ */
+#define	GO_STRARENA_CHUNK	(64 * 1024)
+#define	GO_STR_READSZ		64
+#define	GO_STR_MAXLEN		(64 * 1024)
+#define	GO_STR_INITHASH		1024
+
+typedef enum {
+	GO_STR_FUNC,
+	GO_STR_FILE
+} go_strkind_t;
+
+typedef struct go_strchunk {
+	struct go_strchunk *sc_next;
+	size_t sc_size;			/* size of this allocation */
+	size_t sc_used;			/* bytes of sc_data handed out */
+	uint64_t sc_data[1];		/* keep the arena 8-byte aligned */
+} go_strchunk_t;
+
+typedef struct go_str {
+	struct go_str *gs_next;		/* hash chain */
+	uint64_t gs_key;
+	const char *gs_str;
+} go_str_t;
+
+static go_strchunk_t *go_strarena;
+static size_t go_strarena_bytes;
+static go_str_t **go_str_hash;
+static size_t go_str_hashsz;
+static size_t go_str_count;
+static uint64_t go_str_hits;
+static uint64_t go_str_misses;
+
+#define	GO_STR_KEY(kind, off)	(((uint64_t)(kind) << 32) | (uint32_t)(off))
+#define	GO_STR_HASH(key, sz)	((size_t)(((key) * 0x9e3779b97f4a7c15ULL) >> \
+	32) & ((sz) - 1))
+
+static void *
+go_strarena_alloc(size_t len)
+{
+	go_strchunk_t *sc = go_strarena;
+	size_t size;
+	void *p;
+
+	len = (len + sizeof (uint64_t) - 1) & ~(sizeof (uint64_t) - 1);
+
+	if (sc == NULL || sc->sc_used + len >
+	    sc->sc_size - offsetof(go_strchunk_t, sc_data)) {
+		size = offsetof(go_strchunk_t, sc_data) + len;
+		if (size < GO_STRARENA_CHUNK)
+			size = GO_STRARENA_CHUNK;
+
+		sc = mdb_alloc(size, UM_SLEEP);
+		sc->sc_size = size;
+		sc->sc_used = 0;
+		sc->sc_next = go_strarena;
+		go_strarena = sc;
+		go_strarena_bytes += size;
+	}
+
+	p = (char *)sc->sc_data + sc->sc_used;
+	sc->sc_used += len;
+
+	return (p);
+}
+
+static void
+go_str_flush(void)
+{
+	go_strchunk_t *sc;
+
+	go_names_flush();
+	go_lines_flush();
+
+	while ((sc = go_strarena) != NULL) {
+		go_strarena = sc->sc_next;
+		mdb_free(sc, sc->sc_size);
+	}
+
+	if (go_str_hash != NULL)
+		mdb_free(go_str_hash, go_str_hashsz * sizeof (go_str_t *));
+
+	go_str_hash = NULL;
+	go_str_hashsz = 0;
+	go_str_count = 0;
+	go_strarena_bytes = 0;
+	go_str_hits = 0;
+	go_str_misses = 0;
+}
+
+static void
+go_str_grow(void)
+{
+	go_str_t **nhash, *gs;
+	size_t nsz, i, h;
+
+	nsz = go_str_hashsz == 0 ? GO_STR_INITHASH : go_str_hashsz * 2;
+	nhash = mdb_zalloc(nsz * sizeof (go_str_t *), UM_SLEEP);
+
+	for (i = 0; i < go_str_hashsz; i++) {
+		while ((gs = go_str_hash[i]) != NULL) {
+			go_str_hash[i] = gs->gs_next;
+			h = GO_STR_HASH(gs->gs_key, nsz);
+			gs->gs_next = nhash[h];
+			nhash[h] = gs;
+		}
+	}
+
+	if (go_str_hash != NULL)
+		mdb_free(go_str_hash, go_str_hashsz * sizeof (go_str_t *));
+
+	go_str_hash = nhash;
+	go_str_hashsz = nsz;
+}
+
+/*
+ * Read a NUL-terminated string out of the target into the arena, a small
+ * read at a time so that short names cost one short read.  Strings in the
+ * mapped binary are used where they lie.
+ */
+static const char *
+go_str_read(uintptr_t addr)
+{
+	char sbuf[GO_STR_READSZ * 4], *buf = sbuf, *nbuf, *nul, *str;
+	size_t len = 0, bufsz = sizeof (sbuf), rsz;
+	const char *data;
+
+	if ((data = go_elf_ptr(addr, &rsz)) != NULL) {
+		if (rsz > GO_STR_MAXLEN)
+			rsz = GO_STR_MAXLEN;
+		return (memchr(data, '\0', rsz) != NULL ? data : NULL);
+	}
+
+	for (;;) {
+		if (len + GO_STR_READSZ > bufsz) {
+			if (bufsz >= GO_STR_MAXLEN)
+				break;
+			nbuf = mdb_alloc(bufsz * 2, UM_SLEEP);
+			bcopy(buf, nbuf, len);
+			if (buf != sbuf)
+				mdb_free(buf, bufsz);
+			buf = nbuf;
+			bufsz *= 2;
+		}
+
+		/*
+		 * The string may end just short of the end of a mapping.
+		 */
+		for (rsz = GO_STR_READSZ; rsz > 0; rsz /= 2) {
+			if (go_vread(buf + len, rsz, addr + len) == (ssize_t)rsz)
+				break;
+		}
+
+		if (rsz == 0)
+			break;
+
+		if ((nul = memchr(buf + len, '\0', rsz)) != NULL) {
+			len = nul - buf;
+			str = go_strarena_alloc(len + 1);
+			bcopy(buf, str, len + 1);
+			if (buf != sbuf)
+				mdb_free(buf, bufsz);
+			return (str);
+		}
+
+		len += rsz;
+	}
+
+	if (buf != sbuf)
+		mdb_free(buf, bufsz);
+
+	return (NULL);
+}
+
+/*
+ * In the sidecar index, names are go_idxstr_t's sorted by key, each giving
+ * the offset of the name in the GO_INDEX_STRS section.
+ */
+typedef struct go_idxstr {
+	uint64_t is_key;
+	uint64_t is_off;
+} go_idxstr_t;
+
+static const char *
+go_str_mapped(uint64_t key)
+{
+	const go_idxstr_t *is;
+	const char *strs;
+	size_t n, strsz, lo, hi, mid;
+
+	if ((is = go_index_sect(GO_INDEX_STRIDX, &n)) == NULL ||
+	    (strs = go_index_sect(GO_INDEX_STRS, &strsz)) == NULL ||
+	    strsz == 0 || strs[strsz - 1] != '\0')
+		return (NULL);
+
+	for (lo = 0, hi = n / sizeof (go_idxstr_t); lo < hi; ) {
+		mid = lo + (hi - lo) / 2;
+		if (is[mid].is_key < key)
+			lo = mid + 1;
+		else if (is[mid].is_key > key)
+			hi = mid;
+		else
+			return (is[mid].is_off < strsz ? strs + is[mid].is_off :
+			    NULL);
+	}
+
+	return (NULL);
+}
+
+static const char *
+go_str_intern(go_strkind_t kind, uint32_t off)
+{
+	uint64_t key = GO_STR_KEY(kind, off);
+	uint32_t fileoff;
+	const char *str;
+	go_str_t *gs;
+	size_t h;
+
+	if (go_str_hashsz != 0) {
+		h = GO_STR_HASH(key, go_str_hashsz);
+		for (gs = go_str_hash[h]; gs != NULL; gs = gs->gs_next) {
+			if (gs->gs_key == key) {
+				go_str_hits++;
+				return (gs->gs_str);
+			}
+		}
+	}
+
+	if ((str = go_str_mapped(key)) != NULL) {
+		go_str_hits++;
+		return (str);
+	}
+
+	go_str_misses++;
+
+	switch (kind) {
+	case GO_STR_FUNC:
+		str = go_str_read(GO_PCLNTAB_OFFSET(off));
+		break;
+
+	case GO_STR_FILE:
+		if (go_pclnfmt->gpf_fileoff(off, &fileoff) != 0) {
+			mdb_warn("Could not load filename offset\n");
+			return (NULL);
+		}
+		str = go_str_read(GO_PCLNTAB_OFFSET(fileoff));
+		break;
+
+	default:
+		return (NULL);
+	}
+
+	if (str == NULL)
+		return (NULL);
+
+	if (go_str_count >= go_str_hashsz)
+		go_str_grow();
+
+	gs = go_strarena_alloc(sizeof (go_str_t));
+	gs->gs_key = key;
+	gs->gs_str = str;
+	h = GO_STR_HASH(key, go_str_hashsz);
+	gs->gs_next = go_str_hash[h];
+	go_str_hash[h] = gs;
+	go_str_count++;
+
+	return (str);
+}
+
+static const char *
+go_funcname(const go_func_t *f)
+{
+	return (go_str_intern(GO_STR_FUNC, f->nameoff));
+}
+
+/*
+ * The name of file number file in function f's pcfile table.  Before Go
+ * 1.16 file numbers index the whole binary's file table; since then they
+ * index the table of f's compilation unit, which starts at f->cuoff in the
+ * cutab.  Either way the sum is the file's key.
+ */
+static const char *
+go_filename(const go_func_t *f, int32_t file)
+{
+	if (file < 0)
+		return (NULL);
+
+	return (go_str_intern(GO_STR_FILE, f->cuoff + (uint32_t)file));
+}
+
+/*
+ * Inlined calls.  A function's FUNCDATA_InlTree is a table of the calls
+ * inlined into it, and its PCDATA_InlTreeIndex table gives for each PC the
+ * entry for the innermost inlined call that PC is in, or -1.  Each entry
+ * names the function called and gives the PC in the caller, relative to the
+ * function's entry, of the call; the entry for that PC is then the caller's
+ * own, and so on out to the function itself.  (Go 1.12 to 1.19 also record
+ * each call's parent and position, which we don't need.)  The pcfile and
+ * pcln tables give the position in the innermost call.  Go 1.9 to 1.11
+ * record no parentPc, so calls inlined by those releases, or by a Go
+ * 1.2-format binary whose release we don't know, aren't expanded.
+ *
+ * Decoded trees are cached, keyed by the function, as are functions that
+ * inline nothing, so a frame costs no target reads once its function has
+ * been seen.
+ */
+#define	GO_PCDATA_INLTREEINDEX	2
+#define	GO_FUNCDATA_INLTREE	3
+#define	GO_INLTREE_MAXENTS	(64 * 1024)
+#define	GO_INLTREE_INITHASH	256
+#define	GO_INL_MAXDEPTH		32
+
+typedef struct go_inlent {
+	uint32_t ie_nameoff;		/* name, for go_str_intern() */
+	uint32_t ie_parentpc;		/* PC of the call, from the entry */
+} go_inlent_t;
+
+typedef struct go_inltree {
+	struct go_inltree *it_next;	/* hash chain */
+	uintptr_t it_func;		/* offset of function record */
+	uint32_t it_idxtab;		/* its InlTreeIndex table, or 0 */
+	uint32_t it_n;			/* entries in it_ents */
+	size_t it_size;			/* size of this allocation */
+	go_inlent_t it_ents[1];
+} go_inltree_t;
+
+typedef struct go_inlframe {
+	const char *gi_name;
+	const char *gi_file;
+	int32_t gi_line;
+} go_inlframe_t;
+
+static go_inltree_t **go_inl_hash;
+static size_t go_inl_hashsz;
+static size_t go_inl_count;
+static size_t go_inl_bytes;
+static uint64_t go_inl_hits;
+static uint64_t go_inl_misses;
+
+#define	GO_INL_HASH(off, sz)	((size_t)((((uint64_t)(off)) * \
+	0x9e3779b97f4a7c15ULL) >> 32) & ((sz) - 1))
+
+static void
+go_inl_flush(void)
+{
+	go_inltree_t *it;
+	size_t i;
+
+	for (i = 0; i < go_inl_hashsz; i++) {
+		while ((it = go_inl_hash[i]) != NULL) {
+			go_inl_hash[i] = it->it_next;
+			mdb_free(it, it->it_size);
+		}
+	}
+
+	if (go_inl_hash != NULL)
+		mdb_free(go_inl_hash, go_inl_hashsz * sizeof (go_inltree_t *));
+
+	go_inl_hash = NULL;
+	go_inl_hashsz = 0;
+	go_inl_count = 0;
+	go_inl_bytes = 0;
+	go_inl_hits = 0;
+	go_inl_misses = 0;
+}
+
+static void
+go_inl_grow(void)
+{
+	go_inltree_t **nhash, *it;
+	size_t nsz, i, h;
+
+	nsz = go_inl_hashsz == 0 ? GO_INLTREE_INITHASH : go_inl_hashsz * 2;
+	nhash = mdb_zalloc(nsz * sizeof (go_inltree_t *), UM_SLEEP);
+
+	for (i = 0; i < go_inl_hashsz; i++) {
+		while ((it = go_inl_hash[i]) != NULL) {
+			go_inl_hash[i] = it->it_next;
+			h = GO_INL_HASH(it->it_func, nsz);
+			it->it_next = nhash[h];
+			nhash[h] = it;
+		}
+	}
+
+	if (go_inl_hash != NULL)
+		mdb_free(go_inl_hash, go_inl_hashsz * sizeof (go_inltree_t *));
+
+	go_inl_hash = nhash;
+	go_inl_hashsz = nsz;
+}
+
+/*
+ * Read and decode the inline tree of the function whose record is at off.
+ * The tree's length isn't recorded, so it's taken from the largest index
+ * in the InlTreeIndex table.
+ */
+static go_inltree_t *
+go_inltree_read(uintptr_t off, go_func_t *f)
+{
+	go_pcreader_t pr;
+	go_inltree_t *it;
+	uintptr_t tree, pc = f->entry;
+	uint32_t idxtab, n = 0, i;
+	int32_t value = -1;
+	size_t size, entsz = go_inlsz;
+	uchar_t *raw = NULL, *e;
+
+	if (entsz != 0 &&
+	    (idxtab = go_pcdata(off, f, GO_PCDATA_INLTREEINDEX)) != 0 &&
+	    go_pclnfmt->gpf_funcdata(off, f, GO_FUNCDATA_INLTREE, &tree) == 0) {
+		go_pcreader_init(&pr, pclntab + idxtab);
+		while (step(&pr, &pc, &value, pc == f->entry) == 1) {
+			if (value >= 0 && (uint32_t)value >= n)
+				n = (uint32_t)value + 1;
+		}
+
+		if (n > GO_INLTREE_MAXENTS)
+			n = 0;
+
+		if (n != 0) {
+			raw = mdb_alloc(n * entsz, UM_SLEEP);
+			if (go_vread(raw, n * entsz, tree) == -1) {
+				mdb_free(raw, n * entsz);
+				raw = NULL;
+				n = 0;
+			}
+		}
+	}
+
+	size = offsetof(go_inltree_t, it_ents) + (n == 0 ? 1 : n) *
+	    sizeof (go_inlent_t);
+	it = mdb_zalloc(size, UM_SLEEP);
+	it->it_func = off;
+	it->it_idxtab = n == 0 ? 0 : idxtab;
+	it->it_n = n;
+	it->it_size = size;
+
+	/*
+	 * Go 1.20 entries are { funcID, pad[3], nameOff, parentPc, startLine };
+	 * before, { parent (16 bits), funcID, pad, file, line, func, parentPc }.
+	 */
+	for (i = 0; i < n; i++) {
+		e = raw + i * entsz;
+		if (entsz == 16) {
+			bcopy(e + 4, &it->it_ents[i].ie_nameoff, 4);
+			bcopy(e + 8, &it->it_ents[i].ie_parentpc, 4);
+		} else {
+			bcopy(e + 12, &it->it_ents[i].ie_nameoff, 4);
+			bcopy(e + 16, &it->it_ents[i].ie_parentpc, 4);
+		}
+		it->it_ents[i].ie_nameoff += go_funcnametab;
+	}
+
+	if (raw != NULL)
+		mdb_free(raw, n * entsz);
+
+	return (it);
+}
+
+static const go_inltree_t *
+go_inltree_lookup(uintptr_t off, go_func_t *f)
+{
+	go_inltree_t *it;
+	size_t h;
+
+	if (go_inl_hashsz != 0) {
+		h = GO_INL_HASH(off, go_inl_hashsz);
+		for (it = go_inl_hash[h]; it != NULL; it = it->it_next) {
+			if (it->it_func == off) {
+				go_inl_hits++;
+				return (it);
+			}
+		}
+	}
+
+	go_inl_misses++;
+	it = go_inltree_read(off, f);
+
+	if (go_inl_count >= go_inl_hashsz)
+		go_inl_grow();
+
+	h = GO_INL_HASH(off, go_inl_hashsz);
+	it->it_next = go_inl_hash[h];
+	go_inl_hash[h] = it;
+	go_inl_count++;
+	go_inl_bytes += it->it_size;
+
+	return (it);
+}
+
+/*
+ * Expand the calls inlined at pc in the function whose record is at off:
+ * fill in up to max frames, innermost first, and return how many, setting
+ * *outerpc to the PC in the function itself at which to look up its own
+ * file and line.
+ */
+static int
+go_inline_frames(uintptr_t off, go_func_t *f, uintptr_t pc,
+    go_inlframe_t *frames, int max, uintptr_t *outerpc)
+{
+	const go_inltree_t *it = go_inltree_lookup(off, f);
+	const go_inlent_t *ie;
+	int32_t ix;
+	int n = 0;
+
+	*outerpc = pc;
+	if (it->it_n == 0)
+		return (0);
+
+	while (n < max && (ix = pcvalue(f, it->it_idxtab, pc)) >= 0 &&
+	    (uint32_t)ix < it->it_n) {
+		ie = &it->it_ents[ix];
+		frames[n].gi_name = go_str_intern(GO_STR_FUNC, ie->ie_nameoff);
+		frames[n].gi_file = go_filename(f, pcvalue(f, f->pcfile, pc));
+		frames[n].gi_line = pcvalue(f, f->pcln, pc);
+		n++;
+		pc = f->entry + ie->ie_parentpc;
+	}
+
+	*outerpc = pc;
+	return (n);
+}
+
+#ifdef	MDB_GO_HOST
+/*
+ * The line number of a PC, for host/mdb_go_bench.c.
+ */
+int32_t
+go_host_pcln(uintptr_t pc)
+{
+	uintptr_t offset;
+	go_func_t f;
+
+	if ((offset = findfunc(pc)) == 0 || go_func_read(offset, &f) != 0)
+		return (-1);
+
+	return (pcvalue(&f, f.pcln, pc));
+}
+#endif
+
+/*
+ * Describe the frame at addr.  If addr is a return address (ret), the call
+ * it returns from is the instruction before, which may be the last one in
+ * the function; the function, the calls inlined there and the file and
+ * line are all looked up at that instruction.
+ */
+static int
+do_goframe(uintptr_t addr, uintptr_t sp, char *prop, boolean_t ret)
+{
+	uintptr_t lookup = ret ? addr - 1 : addr;
+	uintptr_t offset, arg, outerpc;
+	int32_t file, lineno, spdelta;
+	uint32_t i;
+	const char *funcname, *filename;
+	go_inlframe_t inl[GO_INL_MAXDEPTH];
+	int ninl, j;
+	go_func_t f, *fp;
+
+	offset = findfunc(lookup);
+	if (offset == 0) {
+		return (DCMD_ERR);
+	}
+
+	if (go_func_read(offset, &f) != 0) {
+		mdb_warn("Could not load function from function table\n");
+		return (DCMD_ERR);
+	}
+
+	fp = &f;
+	ninl = go_inline_frames(offset, fp, lookup, inl, GO_INL_MAXDEPTH,
+	    &outerpc);
+	file = pcvalue(fp, fp->pcfile, outerpc);
+	lineno = pcvalue(fp, fp->pcln, outerpc);
+	spdelta = pcvalue(fp, fp->pcsp, addr);
+
+	if ((funcname = go_funcname(fp)) == NULL) {
+		mdb_warn("Could not read function name\n");
+		return (DCMD_ERR);
+	}
+
+	if ((filename = go_filename(fp, file)) == NULL) {
+		mdb_warn("Could not load filename\n");
+		return (DCMD_ERR);
+	}
+
+	if (prop != NULL && strcmp(prop, "name") == 0) {
+		for (j = 0; j < ninl; j++)
+			mdb_printf("%s(...)\n", inl[j].gi_name != NULL ?
+			    inl[j].gi_name : "?");
+		mdb_printf("%s(", funcname);
+		for (i = 1; f.args != GO_ARGS_UNKNOWN &&
+		    i <= (f.args / sizeof (uintptr_t)); i++) {
+			go_vread(&arg, sizeof (arg), sp + (i * sizeof (uintptr_t)));
+			mdb_printf("%s0x%x", i == 1 ? "" : ", ", arg);
+		}
+		mdb_printf(")\n");
+		return (DCMD_OK);
+	}
+
+	mdb_printf("%p = {\n", GO_PCLNTAB_OFFSET(offset));
+	mdb_inc_indent(8);
+	mdb_printf("entry = %p,\n", f.entry);
+	mdb_printf("nameoff = %p (%s),\n", f.nameoff, funcname);
+	mdb_printf("args = %p (len=%d),\n", f.args, (f.args / sizeof (uintptr_t)));
+	mdb_printf("frame = %p,\n", f.frame);
+	mdb_printf("pcsp = %p (delta=%d),\n", f.pcsp, spdelta);
+	mdb_printf("pcfile = %p (%s),\n", f.pcfile, filename);
+	mdb_printf("pcln = %p (%d),\n", f.pcln, lineno);
+	for (j = 0; j < ninl; j++) {
+		mdb_printf("inlined = %s (%s:%d),\n",
+		    inl[j].gi_name != NULL ? inl[j].gi_name : "?",
+		    inl[j].gi_file != NULL ? inl[j].gi_file : "?",
+		    inl[j].gi_line);
+	}
+	mdb_printf("npcdata = %p,\n", f.npcdata);
+	mdb_printf("nfuncdata = %p,\n", f.nfuncdata);
+	mdb_dec_indent(8);
+	mdb_printf("}\n");
+	return (DCMD_OK);
+}
+
+static int
+dcmd_goframe(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uintptr_t p;
+	char *opt_p = NULL;
+
+	if (mdb_getopts(argc, argv,
+	    'p', MDB_OPT_STR, &opt_p, NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (!(flags & DCMD_ADDRSPEC)) {
+		if (load_current_context(NULL, NULL, &addr) != 0)
+			return (DCMD_ERR);
+	}
+
+	if (go_vread(&p, sizeof (p), addr) == -1) {
+		mdb_warn("Could not load function from function table\n");
+		return (DCMD_ERR);
+	}
+
+	do_goframe(p, addr, opt_p, B_TRUE);
+
+	return (DCMD_OK);
+}
+
+/*
+ * The unwind cache.  What an unwinder needs to know about a PC -- its
+ * function, the SP delta at the PC and whether the stack ends there -- is
+ * the same every time the PC turns up, and in a dump of many goroutines the
+ * same return addresses turn up over and over.  So the answers are kept in
+ * a two-way set-associative table keyed by PC, consulted before the
+ * function table and the pcsp table.  PCs for which there is no answer are
+ * cached too.
+ */
+#define	GO_UNWIND_CACHESZ	8192
+
+typedef struct go_unwind_ent {
+	uintptr_t ue_pc;		/* 0 if empty */
+	uintptr_t ue_func;		/* offset of function, or 0 if none */
+	int32_t ue_spdelta;		/* at ue_pc, or -1 */
+	uint32_t ue_nameoff;		/* name, for go_str_intern() */
+	boolean_t ue_top;		/* function is the top of a stack */
+} go_unwind_ent_t;
+
+static go_unwind_ent_t go_unwind_cache[GO_UNWIND_CACHESZ];
+static size_t go_unwind_count;
+static uint64_t go_unwind_hits;
+static uint64_t go_unwind_misses;
+static uint64_t go_unwind_evictions;
+
+#define	GO_UNWIND_SETSHIFT	52	/* 2^(64 - 52) sets of two */
+#define	GO_UNWIND_HASH(pc)	\
+	((size_t)(((uint64_t)(pc) * 0x9e3779b97f4a7c15ULL) >> \
+	GO_UNWIND_SETSHIFT) * 2)
+
+/*
+ * The functions at the outermost end of a stack, which aren't called from
+ * anywhere we could unwind to.
+ */
+static const char *go_topfuncs[] = {
+	"runtime.goexit",
+	"runtime.mstart",
+	"runtime.mstart0",
+	"runtime.rt0_go",
+	"runtime.mcall",
+	"runtime.morestack",
+	NULL
+};
+
+static boolean_t
+go_topofstack(const char *name)
+{
+	const char *suffix;
+	size_t len;
+	int i;
+
+	if (name == NULL)
+		return (B_FALSE);
+
+	/* assembly functions have an ABI suffix from Go 1.17 on */
+	len = (suffix = strrchr(name, '.')) != NULL &&
+	    strcmp(suffix, ".abi0") == 0 ? suffix - name : strlen(name);
+
+	for (i = 0; go_topfuncs[i] != NULL; i++) {
+		if (strlen(go_topfuncs[i]) == len &&
+		    strncmp(go_topfuncs[i], name, len) == 0)
+			return (B_TRUE);
+	}
+
+	return (B_FALSE);
+}
+
+static void
+go_unwind_flush(void)
+{
+	bzero(go_unwind_cache, sizeof (go_unwind_cache));
+	go_unwind_count = 0;
+	go_unwind_hits = 0;
+	go_unwind_misses = 0;
+	go_unwind_evictions = 0;
+}
+
+/*
+ * Look up pc, resolving and caching it on a miss.
+ */
+static const go_unwind_ent_t *
+go_unwind_lookup(uintptr_t pc)
+{
+	go_unwind_ent_t *set = &go_unwind_cache[GO_UNWIND_HASH(pc)], *ue;
+	uintptr_t offset;
+	go_func_t f;
+
+	if (pc != 0 && (set[0].ue_pc == pc || set[1].ue_pc == pc)) {
+		go_unwind_hits++;
+		return (set[0].ue_pc == pc ? &set[0] : &set[1]);
+	}
+
+	go_unwind_misses++;
+
+	/*
+	 * The newest entry of a set goes first; the older of the two is the
+	 * one evicted.
+	 */
+	if (set[1].ue_pc != 0)
+		go_unwind_evictions++;
+	else
+		go_unwind_count++;
+	set[1] = set[0];
+
+	ue = &set[0];
+	ue->ue_pc = pc;
+	ue->ue_func = 0;
+	ue->ue_spdelta = -1;
+	ue->ue_nameoff = 0;
+	ue->ue_top = B_FALSE;
+
+	/* stacks hold all sorts of things; don't complain about them */
+	if ((offset = go_findfunc(pc, B_FALSE)) == 0)
+		return (ue);
+
+	if (go_func_read(offset, &f) != 0) {
+		mdb_warn("Could not load function from function table\n");
+		return (ue);
+	}
+
+	ue->ue_func = offset;
+	ue->ue_spdelta = pcvalue(&f, f.pcsp, pc);
+	ue->ue_nameoff = f.nameoff;
+	ue->ue_top = go_topofstack(go_funcname(&f));
+
+	return (ue);
+}
+
+/*
+ * Frames are identified by the address of their return address.  The
+ * function executing at pc, with the stack pointer at sp, has its return
+ * address at sp plus the pcsp value at pc: the SP delta there is what the
+ * function has pushed so far, so this is right wherever pc is, including
+ * in a function's prologue or epilogue.
+ */
+static int
+go_frame_first(uintptr_t pc, uintptr_t sp, uintptr_t *slotp)
+{
+	const go_unwind_ent_t *ue;
+
+	if (pc == 0 || sp == 0 || (ue = go_unwind_lookup(pc))->ue_func == 0 ||
+	    ue->ue_spdelta < 0 || ue->ue_top)
+		return (-1);
+
+	*slotp = sp + ue->ue_spdelta;
+	return (0);
+}
+
+/*
+ * Step out of the frame whose return address is at slot: returns that
+ * return address, and in *nextp where the return address of the frame it
+ * returns to is, or 0 if that frame is the last.  The caller's SP is just
+ * past the return address, and its return address is the pcsp value at
+ * the return address beyond that.
+ */
+static int
+go_frame_next(uintptr_t slot, uintptr_t *retp, uintptr_t *nextp)
+{
+	const go_unwind_ent_t *ue;
+	uintptr_t p;
+
+	if (go_vread(&p, sizeof (p), slot) == -1 || p == 0)
+		return (-1);
+
+	if ((ue = go_unwind_lookup(p))->ue_func == 0)
+		return (-1);
+
+	*retp = p;
+	*nextp = ue->ue_top || ue->ue_spdelta < 0 ? 0 :
+	    slot + sizeof (uintptr_t) + ue->ue_spdelta;
+	return (0);
+}
+
+/*
+ * Where to start unwinding the goroutine at g: from where it entered a
+ * system call, if it's in one, and otherwise from its saved registers.  Its
+ * stack ends at its upper bound.  With no goroutine, we start from the
+ * current thread's registers and don't know where the stack ends.
+ */
+static int
+go_stack_start(uintptr_t g, uintptr_t *pcp, uintptr_t *spp,
+    uintptr_t *stackhip)
+{
+	static const go_fieldid_t fields[] = {
+		GO_G_STATUS, GO_G_SCHED_PC, GO_G_SCHED_SP, GO_G_SYSCALLPC,
+		GO_G_SYSCALLSP, GO_G_STACKHI
+	};
+	uint64_t v[sizeof (fields) / sizeof (fields[0])];
+
+	if (g == 0) {
+		*stackhip = 0;
+		return (load_current_context(NULL, pcp, spp));
+	}
+
+	if (!GO_FIELD_PRESENT(GO_G_SCHED_PC) ||
+	    go_fields_read(g, fields, sizeof (fields) / sizeof (fields[0]),
+	    v) != 0) {
+		mdb_warn("failed to read G from %p\n", g);
+		return (-1);
+	}
+
+	if (GO_GSTATUS(v[0]) == GS_Gsyscall && v[4] != 0) {
+		*pcp = (uintptr_t)v[3];
+		*spp = (uintptr_t)v[4];
+	} else {
+		*pcp = (uintptr_t)v[1];
+		*spp = (uintptr_t)v[2];
+	}
+	*stackhip = (uintptr_t)v[5];
+
+	return (0);
+}
+
+/*
+ * The goframe walker walks the frames of the goroutine at the given
+ * address, or of the current thread, returning the address of each frame's
+ * return address.  It stops at the end of the stack, or at the most
+ * GO_FRAMES_MAX frames in if it can't tell where that is.
+ */
+#define	GO_FRAMES_MAX		1024
+
+typedef struct go_frames {
+	uintptr_t gf_stackhi;		/* 0 if unknown */
+	uint_t gf_nframes;
+} go_frames_t;
+
+static int
+walk_goframes_init(mdb_walk_state_t *wsp)
+{
+	uintptr_t pc, sp, stackhi, slot;
+	go_frames_t *gf;
+
+	if (go_stack_start(wsp->walk_addr, &pc, &sp, &stackhi) != 0)
+		return (WALK_ERR);
+
+	if (go_frame_first(pc, sp, &slot) != 0)
+		slot = 0;
+
+	gf = mdb_zalloc(sizeof (go_frames_t), UM_SLEEP);
+	gf->gf_stackhi = stackhi;
+	wsp->walk_data = gf;
+	wsp->walk_addr = slot;
+
+	return (WALK_NEXT);
+}
+
+static int
+walk_goframes_step(mdb_walk_state_t *wsp)
+{
+	go_frames_t *gf = wsp->walk_data;
+	uintptr_t addr = wsp->walk_addr, p;
+	int rv;
+
+	if (addr == 0 || gf->gf_nframes++ >= GO_FRAMES_MAX ||
+	    (gf->gf_stackhi != 0 &&
+	    addr + sizeof (uintptr_t) > gf->gf_stackhi))
+		return (WALK_DONE);
+
+	/* the stack ends at the first thing that isn't a return address */
+	if (go_frame_next(addr, &p, &wsp->walk_addr) != 0)
+		return (WALK_DONE);
+
+	rv = wsp->walk_callback(addr, NULL, wsp->walk_cbdata);
+
+	return (rv);
+}
+
+static void
+walk_goframes_fini(mdb_walk_state_t *wsp)
+{
+	mdb_free(wsp->walk_data, sizeof (go_frames_t));
+}
+
+/*
+ * Unwind a stack from pc and sp into pcs[], the PC followed by the return
+ * addresses, going no further than stackhi (if known) or max frames.
+ * Returns the number of PCs.
+ */
+static int
+go_unwind(uintptr_t pc, uintptr_t sp, uintptr_t stackhi, uintptr_t *pcs,
+    int max)
+{
+	uintptr_t ret, slot;
+	int n = 0;
+
+	if (max == 0 || pc == 0)
+		return (0);
+
+	pcs[n++] = pc;
+
+	if (go_frame_first(pc, sp, &slot) != 0)
+		return (n);
+
+	while (n < max && slot != 0 && (stackhi == 0 ||
+	    slot + sizeof (uintptr_t) <= stackhi)) {
+		if (go_frame_next(slot, &ret, &slot) != 0)
+			break;
+		pcs[n++] = ret;
+	}
+
+	return (n);
+}
+
+static int
+dcmd_gostack(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uintptr_t pc, sp, stackhi, slot;
+	char *opt_p = NULL;
+
+	if (mdb_getopts(argc, argv,
+	    'p', MDB_OPT_STR, &opt_p,
+	    NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (!(flags & DCMD_ADDRSPEC))
+		addr = 0;
+
+	if (go_stack_start(addr, &pc, &sp, &stackhi) != 0)
+		return (DCMD_ERR);
+
+	/* the arguments of the innermost frame are above its return address */
+	if (go_frame_first(pc, sp, &slot) != 0)
+		slot = sp;
+
+	/* the innermost frame's PC is where it is, not a return address */
+	do_goframe(pc, slot, opt_p, B_FALSE);
+
+	if (mdb_pwalk_dcmd("goframe", "goframe", argc, argv, addr) == -1)
+		return (DCMD_ERR);
+
+	return (DCMD_OK);
+}
+
+/*
+ * A G being scanned is described by the status it had before the scan.
+ */
+static const char *
+mdb_go_g_status(int16_t status)
+{
+	status = GO_GSTATUS(status);
+
+	return (status == GS_Gidle ? "Gidle" :
+	    status == GS_Grunnable ? "Grunnable" :
+	    status == GS_Grunning ? "Grunning" :
+	    status == GS_Gsyscall ? "Gsyscall" :
+	    status == GS_Gwaiting ? "Gwaiting" :
+	    status == GS_Gmoribund_unused ? "Gmoribund_unused" :
+	    status == GS_Gdead ? "Gdead" :
+	    status == GS_Genqueue_unused ? "Genqueue_unused" :
+	    status == GS_Gcopystack ? "Gcopystack" :
+	    status == GS_Gpreempted ? "Gpreempted" :
+	    "<UNKNOWN>");
+}
+
+static const char *
+mdb_go_p_status(int16_t status)
+{
+	return (status == PS_Pidle ? "Pidle" :
+	    status == PS_Prunning ? "Prunning" :
+	    status == PS_Psyscall ? "Psyscall" :
+	    status == PS_Pgcstop ? "Pgcstop" :
+	    status == PS_Pdead ? "Pdead" :
+	    "<UNKNOWN>");
+}
+
+static int
+dcmd_go_p(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint64_t id, status, v;
+
+	if (go_field_read(addr, GO_P_ID, &id) != 0 ||
+	    go_field_read(addr, GO_P_STATUS, &status) != 0) {
+		mdb_warn("failed to read P from %p", addr);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("%p: goproc %d [%s]\n", addr, (int32_t)id,
+	    mdb_go_p_status((int16_t)status));
+	if (go_field_read(addr, GO_P_RUNQSIZE, &v) == 0) {
+		mdb_printf("    runqsz %d\n", (int32_t)v);
+	} else if (go_field_read(addr, GO_P_RUNQHEAD, &id) == 0 &&
+	    go_field_read(addr, GO_P_RUNQTAIL, &v) == 0) {
+		mdb_printf("    runqsz %d\n", (int32_t)(v - id));
+	}
+	if (go_field_read(addr, GO_P_M, &v) == 0)
+		mdb_printf("    m %p\n", (uintptr_t)v);
+
+	return (DCMD_OK);
+}
+
+/*
+ * Print a pointer-sized field of a G, if this runtime has it.
+ */
+static void
+go_g_print(uintptr_t addr, const char *name, go_fieldid_t id, boolean_t sym)
+{
+	uint64_t v;
+
+	if (go_field_read(addr, id, &v) != 0)
+		return;
+
+	if (sym)
+		mdb_printf("%14s: %p (%a)\n", name, (uintptr_t)v, (uintptr_t)v);
+	else
+		mdb_printf("%14s: %p\n", name, (uintptr_t)v);
+}
+
+static int
+dcmd_go_g(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint64_t goid, status, gopc, ispanic, issystem, isbackground;
+
+	if (go_field_read(addr, GO_G_GOID, &goid) != 0 ||
+	    go_field_read(addr, GO_G_STATUS, &status) != 0) {
+		mdb_warn("failed to read G from %p", addr);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("%p: goroutine %lld [%s]\n", addr, (int64_t)goid,
+	    mdb_go_g_status((int16_t)status));
+	if (go_field_read(addr, GO_G_ISPANIC, &ispanic) == 0 &&
+	    go_field_read(addr, GO_G_ISSYSTEM, &issystem) == 0 &&
+	    go_field_read(addr, GO_G_ISBACKGROUND, &isbackground) == 0) {
+		mdb_printf("      flags: %s %s %s\n",
+		    ispanic ? "panic" : "!panic",
+		    issystem ? "system" : "!system",
+		    isbackground ? "background" : "!background");
+	}
+	if (go_field_read(addr, GO_G_GOPC, &gopc) == 0) {
+		mdb_printf("      create_pc %p (%a)\n", (uintptr_t)gopc,
+		    (uintptr_t)gopc);
+	}
+
+	/*
+	 * Later runtimes keep the stack bounds in g.stack while in a system
+	 * call, and have no syscallstack or syscallguard.
+	 */
+	if (GO_GSTATUS(status) == GS_Gsyscall &&
+	    GO_FIELD_PRESENT(GO_G_SYSCALLSP)) {
+		go_g_print(addr, "stackbase",
+		    GO_FIELD_PRESENT(GO_G_SYSCALLSTACK) ?
+		    GO_G_SYSCALLSTACK : GO_G_STACKHI, B_FALSE);
+		go_g_print(addr, "sp", GO_G_SYSCALLSP, B_FALSE);
+		go_g_print(addr, "pc", GO_G_SYSCALLPC, B_TRUE);
+		go_g_print(addr, "stackguard",
+		    GO_FIELD_PRESENT(GO_G_SYSCALLGUARD) ?
+		    GO_G_SYSCALLGUARD : GO_G_STACKGUARD, B_FALSE);
+	} else {
+		go_g_print(addr, "stackbase", GO_G_STACKHI, B_FALSE);
+		go_g_print(addr, "sp", GO_G_SCHED_SP, B_FALSE);
+		go_g_print(addr, "pc", GO_G_SCHED_PC, B_TRUE);
+		go_g_print(addr, "stackguard", GO_G_STACKGUARD, B_FALSE);
+	}
+
+	return (DCMD_OK);
+}
+
+static int
+dcmd_go_m(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint64_t id, p, nextp, v, fn, n;
+
+	if (go_field_read(addr, GO_M_ID, &id) != 0) {
+		mdb_warn("failed to read M from %p", addr);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("%p: gomach %d\n", addr, (int32_t)id);
+	if (go_field_read(addr, GO_M_P, &p) == 0 &&
+	    go_field_read(addr, GO_M_NEXTP, &nextp) == 0)
+		mdb_printf("    p %p nextp %p\n", (uintptr_t)p, (uintptr_t)nextp);
+	if (go_field_read(addr, GO_M_CURG, &v) == 0)
+		mdb_printf("    curg %p\n", (uintptr_t)v);
+	if (go_field_read(addr, GO_M_GSIGNAL, &v) == 0) {
+		mdb_printf("    gsignal %p", (uintptr_t)v);
+		if (go_field_read(addr, GO_M_CAUGHTSIG, &v) == 0)
+			mdb_printf(" caughtsig %p", (uintptr_t)v);
+		mdb_printf("\n");
+	}
+	if (go_field_read(addr, GO_M_LIBCALL_FN, &fn) == 0 &&
+	    go_field_read(addr, GO_M_LIBCALL_N, &n) == 0) {
+		mdb_printf("    libcall %p (fn %a, n %d)\n",
+		    GO_FIELD_ADDR(addr, GO_M_LIBCALL), (uintptr_t)fn, (int)n);
+	}
+
+	return (DCMD_OK);
+}
+
+/*
+ * The commonly used fields of a G (go_grec_t, in mdb_go.h), M or P.  The
+ * go_g_rec, go_m_rec and go_p_rec walkers hand one of these to their
+ * callbacks, read with a single read of the part of the structure that holds
+ * these fields.
+ */
+typedef struct go_mrec {
+	int64_t mr_id;
+	uintptr_t mr_g0;
+	uintptr_t mr_curg;
+	uintptr_t mr_p;
+	uintptr_t mr_nextp;
+	uintptr_t mr_gsignal;
+	uint64_t mr_procid;
+} go_mrec_t;
+
+typedef struct go_prec {
+	int32_t pr_id;
+	uint32_t pr_status;
+	uintptr_t pr_m;
+	uint32_t pr_runqsize;
+} go_prec_t;
+
+/*
+ * In the order of the records, followed by the link to the next one.
+ */
+static const go_fieldid_t go_grec_fields[] = {
+	GO_G_GOID, GO_G_STATUS, GO_G_SCHED_SP, GO_G_SCHED_PC, GO_G_SCHED_BP,
+	GO_G_STACKLO, GO_G_STACKHI, GO_G_SYSCALLSP, GO_G_SYSCALLPC, GO_G_M,
+	GO_G_GOPC, GO_G_STARTPC, GO_G_WAITREASON, GO_G_STACKSIZE,
+	GO_G_WAITREASON_STR, GO_G_WAITREASON_LEN, GO_G_ALLLINK
+};
+
+static const go_fieldid_t go_mrec_fields[] = {
+	GO_M_ID, GO_M_G0, GO_M_CURG, GO_M_P, GO_M_NEXTP, GO_M_GSIGNAL,
+	GO_M_PROCID, GO_M_ALLLINK
+};
+
+static const go_fieldid_t go_prec_fields[] = {
+	GO_P_ID, GO_P_STATUS, GO_P_M, GO_P_RUNQSIZE, GO_P_RUNQHEAD,
+	GO_P_RUNQTAIL, GO_P_LINK
+};
+
+static const go_fieldid_t go_srec_fields[] = {
+	GO_MSPAN_STARTADDR, GO_MSPAN_NPAGES, GO_MSPAN_FREEINDEX,
+	GO_MSPAN_NELEMS, GO_MSPAN_ALLOCBITS, GO_MSPAN_GCMARKBITS,
+	GO_MSPAN_ELEMSIZE, GO_MSPAN_LIMIT, GO_MSPAN_ALLOCCOUNT,
+	GO_MSPAN_SPANCLASS, GO_MSPAN_STATE, GO_MSPAN_SPECIALS, GO_MSPAN_NEXT
+};
+
+#define	GO_REC_MAXFIELDS	20
+
+static void
+go_grec_fill(const uint64_t *v, void *rec)
+{
+	go_grec_t *gr = rec;
+
+	gr->gr_goid = (int64_t)v[0];
+	gr->gr_status = (uint32_t)v[1];
+	gr->gr_sp = (uintptr_t)v[2];
+	gr->gr_pc = (uintptr_t)v[3];
+	gr->gr_bp = (uintptr_t)v[4];
+	gr->gr_stacklo = (uintptr_t)v[5];
+	gr->gr_stackhi = (uintptr_t)v[6];
+	gr->gr_syscallsp = (uintptr_t)v[7];
+	gr->gr_syscallpc = (uintptr_t)v[8];
+	gr->gr_m = (uintptr_t)v[9];
+	gr->gr_gopc = (uintptr_t)v[10];
+	gr->gr_startpc = (uintptr_t)v[11];
+	if (GO_FIELD_PRESENT(GO_G_WAITREASON_STR)) {
+		gr->gr_waitreason = v[14];
+		gr->gr_waitlen = v[15];
+	} else {
+		gr->gr_waitreason = v[12];
+		gr->gr_waitlen = 0;
+	}
+	/* later runtimes have only the bounds */
+	gr->gr_stacksize = GO_FIELD_PRESENT(GO_G_STACKSIZE) ? v[13] :
+	    gr->gr_stackhi - gr->gr_stacklo;
+}
+
+static void
+go_mrec_fill(const uint64_t *v, void *rec)
+{
+	go_mrec_t *mr = rec;
+
+	mr->mr_id = (int64_t)v[0];
+	mr->mr_g0 = (uintptr_t)v[1];
+	mr->mr_curg = (uintptr_t)v[2];
+	mr->mr_p = (uintptr_t)v[3];
+	mr->mr_nextp = (uintptr_t)v[4];
+	mr->mr_gsignal = (uintptr_t)v[5];
+	mr->mr_procid = v[6];
+}
+
+static void
+go_prec_fill(const uint64_t *v, void *rec)
+{
+	go_prec_t *pr = rec;
+
+	pr->pr_id = (int32_t)v[0];
+	pr->pr_status = (uint32_t)v[1];
+	pr->pr_m = (uintptr_t)v[2];
+	/* later runtimes keep only the head and tail of the run queue */
+	pr->pr_runqsize = GO_FIELD_PRESENT(GO_P_RUNQSIZE) ? (uint32_t)v[3] :
+	    (uint32_t)v[5] - (uint32_t)v[4];
+}
+
+static void
+go_srec_fill(const uint64_t *v, void *rec)
+{
+	go_srec_t *sr = rec;
+
+	sr->sr_start = (uintptr_t)v[0];
+	sr->sr_npages = (uintptr_t)v[1];
+	sr->sr_freeindex = (uintptr_t)v[2];
+	sr->sr_nelems = (uintptr_t)v[3];
+	sr->sr_allocbits = (uintptr_t)v[4];
+	sr->sr_gcmarkbits = (uintptr_t)v[5];
+	sr->sr_elemsize = (uintptr_t)v[6];
+	sr->sr_limit = (uintptr_t)v[7];
+	sr->sr_alloccount = (uint32_t)v[8];
+	/* the low bit of the span class says whether there are pointers */
+	sr->sr_sizeclass = (uint8_t)(v[9] >> 1);
+	sr->sr_noscan = (uint8_t)(v[9] & 1);
+	sr->sr_state = (uint8_t)v[10];
+	sr->sr_specials = (uintptr_t)v[11];
+}
+
+/*
+ * How to walk all the Gs, Ms or Ps.  Later runtimes keep the Gs in the
+ * runtime.allgs slice and the Ps in the runtime.allp slice (for a while
+ * allp was a fixed array) rather than linking them together; where the
+ * target has such a slice or array we read its elements a chunk at a time
+ * and walk those, otherwise we follow the list from its head.  Either way
+ * we read only the link of each structure, unless the walker is to hand
+ * its callback a record.  The heap's spans are only in a slice, which is a
+ * field of the heap, mheap_.
+ */
+typedef struct go_walkdef {
+	const char *gwd_array;		/* slice or array of them, or NULL */
+	const char *gwd_head;		/* symbol holding the first, or NULL */
+	go_fieldid_t gwd_link;
+	const char *gwd_what;
+	const go_fieldid_t *gwd_fields;
+	size_t gwd_nfields;		/* including the link */
+	size_t gwd_recsz;
+	void (*gwd_fill)(const uint64_t *, void *);
+	boolean_t gwd_infield;		/* the slice is a field of gwd_array */
+	go_fieldid_t gwd_field;
+} go_walkdef_t;
+
+static const go_walkdef_t go_walk_g = {
+	"runtime.allgs", "runtime.allg", GO_G_ALLLINK, "G", go_grec_fields,
+	sizeof (go_grec_fields) / sizeof (go_grec_fields[0]),
+	sizeof (go_grec_t), go_grec_fill
+};
+
+static const go_walkdef_t go_walk_m = {
+	NULL, "runtime.allm", GO_M_ALLLINK, "M", go_mrec_fields,
+	sizeof (go_mrec_fields) / sizeof (go_mrec_fields[0]),
+	sizeof (go_mrec_t), go_mrec_fill
+};
+
+static const go_walkdef_t go_walk_p = {
+	"runtime.allp", "runtime.allp", GO_P_LINK, "P", go_prec_fields,
+	sizeof (go_prec_fields) / sizeof (go_prec_fields[0]),
+	sizeof (go_prec_t), go_prec_fill
+};
+
+/*
+ * Given an address, the span walkers follow a list of spans instead.
+ */
+static const go_walkdef_t go_walk_span = {
+	"runtime.mheap_", NULL, GO_MSPAN_NEXT, "span", go_srec_fields,
+	sizeof (go_srec_fields) / sizeof (go_srec_fields[0]),
+	sizeof (go_srec_t), go_srec_fill, B_TRUE, GO_MHEAP_ALLSPANS
+};
+
+#define	GO_WALK_CHUNK	512		/* elements read at a time */
+
+typedef struct go_walk {
+	const go_walkdef_t *gw_def;
+	void *gw_rec;			/* NULL unless handing out records */
+	boolean_t gw_array;		/* walking an array, not a list */
+	uintptr_t gw_base;		/* of the array ... */
+	size_t gw_len;			/* ... and its length */
+	size_t gw_idx;			/* of the next element */
+	size_t gw_chunkidx;		/* of gw_chunk[0] */
+	size_t gw_nchunk;
+	boolean_t (*gw_filter)(const void *, uintptr_t);
+	uintptr_t gw_filterarg;
+	uintptr_t gw_chunk[GO_WALK_CHUNK];
+} go_walk_t;
+
+/*
+ * Find the slice or array holding all of them.  A symbol only a pointer
+ * in size is the head of a list instead.
+ */
+static int
+go_walk_array(const go_walkdef_t *def, go_walk_t *gw)
+{
+	GElf_Sym sym;
+	uintptr_t slice[3];
+
+	if (def->gwd_array == NULL ||
+	    mdb_lookup_by_name(def->gwd_array, &sym) != 0)
+		return (-1);
+
+	if (def->gwd_infield) {
+		if (go_fields[def->gwd_field].gf_size != sizeof (slice))
+			return (-1);
+		sym.st_value += go_fields[def->gwd_field].gf_off;
+		sym.st_size = sizeof (slice);
+	} else if (sym.st_size <= sizeof (uintptr_t)) {
+		return (-1);
+	}
+
+	if (sym.st_size == sizeof (slice)) {
+		if (go_vread(slice, sizeof (slice), sym.st_value) == -1) {
+			mdb_warn("could not load %s", def->gwd_array);
+			return (-1);
+		}
+		gw->gw_base = slice[0];
+		gw->gw_len = slice[1];
+	} else {
+		gw->gw_base = sym.st_value;
+		gw->gw_len = sym.st_size / sizeof (uintptr_t);
+	}
+
+	gw->gw_array = B_TRUE;
+	return (0);
+}
+
+static int
+go_walk_init(mdb_walk_state_t *wsp, const go_walkdef_t *def, boolean_t rec)
+{
+	GElf_Sym sym;
+	uintptr_t head;
+	go_walk_t *gw;
+
+	gw = mdb_zalloc(sizeof (go_walk_t), UM_SLEEP);
+	gw->gw_def = def;
+
+	if (wsp->walk_addr != 0 || go_walk_array(def, gw) != 0) {
+		if (wsp->walk_addr == 0 && def->gwd_head == NULL) {
+			mdb_warn("could not find the %ss in %s\n",
+			    def->gwd_what, def->gwd_array);
+			mdb_free(gw, sizeof (go_walk_t));
+			return (WALK_ERR);
+		}
+
+		if (!GO_FIELD_PRESENT(def->gwd_link)) {
+			mdb_warn("this runtime doesn't link its %ss together\n",
+			    def->gwd_what);
+			mdb_free(gw, sizeof (go_walk_t));
+			return (WALK_ERR);
+		}
+
+		if (wsp->walk_addr == 0) {
+			if (mdb_lookup_by_name(def->gwd_head, &sym) != 0) {
+				mdb_warn("could not find %s", def->gwd_head);
+				mdb_free(gw, sizeof (go_walk_t));
+				return (WALK_ERR);
+			}
+
+			if (go_vread(&head, sizeof (head),
+			    sym.st_value) == -1) {
+				mdb_warn("could not load %s", def->gwd_head);
+				mdb_free(gw, sizeof (go_walk_t));
+				return (WALK_ERR);
+			}
+
+			wsp->walk_addr = head;
+		}
+	}
+
+	if (rec)
+		gw->gw_rec = mdb_zalloc(def->gwd_recsz, UM_SLEEP);
+	wsp->walk_data = gw;
+
+	return (WALK_NEXT);
+}
+
+/*
+ * The next element of the array, reading another chunk of it as needed;
+ * nil elements (the unused end of a fixed array) are skipped.
+ */
+static int
+go_walk_next(go_walk_t *gw, uintptr_t *addrp)
+{
+	size_t n;
+
+	for (; gw->gw_idx < gw->gw_len; gw->gw_idx++) {
+		if (gw->gw_idx >= gw->gw_chunkidx + gw->gw_nchunk) {
+			n = gw->gw_len - gw->gw_idx;
+			if (n > GO_WALK_CHUNK)
+				n = GO_WALK_CHUNK;
+			if (go_vread(gw->gw_chunk, n * sizeof (uintptr_t),
+			    gw->gw_base + gw->gw_idx * sizeof (uintptr_t)) ==
+			    -1) {
+				mdb_warn("could not read %s", gw->gw_def->
+				    gwd_array);
+				return (-1);
+			}
+			gw->gw_chunkidx = gw->gw_idx;
+			gw->gw_nchunk = n;
+		}
+
+		if ((*addrp = gw->gw_chunk[gw->gw_idx -
+		    gw->gw_chunkidx]) != 0) {
+			gw->gw_idx++;
+			return (1);
+		}
+	}
+
+	return (0);
+}
+
+static int
+go_walk_step(mdb_walk_state_t *wsp)
+{
+	go_walk_t *gw = wsp->walk_data;
+	const go_walkdef_t *def = gw->gw_def;
+	uint64_t vals[GO_REC_MAXFIELDS];
+	uintptr_t addr;
+	uint64_t next = 0;
+	int rv;
+
+	if (gw->gw_array) {
+		if ((rv = go_walk_next(gw, &addr)) <= 0)
+			return (rv == 0 ? WALK_DONE : WALK_ERR);
+	} else if ((addr = wsp->walk_addr) == 0) {
+		return (WALK_DONE);
+	}
+
+	if (gw->gw_rec != NULL) {
+		if (go_fields_read(addr, def->gwd_fields, def->gwd_nfields,
+		    vals) != 0) {
+			mdb_warn("could not read %s at %p", def->gwd_what, addr);
+			return (WALK_ERR);
+		}
+		def->gwd_fill(vals, gw->gw_rec);
+		next = vals[def->gwd_nfields - 1];
+	} else if (!gw->gw_array) {
+		/*
+		 * Read just the link to the next one.
+		 */
+		if (go_field_read(addr, def->gwd_link, &next) != 0) {
+			mdb_warn("could not read next %s pointer",
+			    def->gwd_what);
+			return (WALK_ERR);
+		}
+	}
+
+	if (gw->gw_filter != NULL &&
+	    !gw->gw_filter(gw->gw_rec, gw->gw_filterarg))
+		rv = WALK_NEXT;
+	else
+		rv = wsp->walk_callback(addr, gw->gw_rec, wsp->walk_cbdata);
+
+	if (!gw->gw_array)
+		wsp->walk_addr = (uintptr_t)next;
+
+	return (rv);
+}
+
+static void
+go_walk_fini(mdb_walk_state_t *wsp)
+{
+	go_walk_t *gw = wsp->walk_data;
+
+	if (gw->gw_rec != NULL)
+		mdb_free(gw->gw_rec, gw->gw_def->gwd_recsz);
+	mdb_free(gw, sizeof (go_walk_t));
+}
+
+static int
+walk_go_g_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_g, B_FALSE));
+}
+
+static int
+walk_go_g_rec_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_g, B_TRUE));
+}
+
+static int
+walk_go_m_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_m, B_FALSE));
+}
+
+static int
+walk_go_m_rec_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_m, B_TRUE));
+}
+
+static int
+walk_go_p_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_p, B_FALSE));
+}
+
+static int
+walk_go_p_rec_init(mdb_walk_state_t *wsp)
+{
+	return (go_walk_init(wsp, &go_walk_p, B_TRUE));
+}
+
+/*
+ * The spans walkers check first that this is a heap we understand: made of
+ * arenas, which came in with Go 1.11.
+ */
+static int
+go_heap_check(void)
+{
+	if (!GO_FIELD_PRESENT(GO_MHEAP_ARENAS) ||
+	    !GO_FIELD_PRESENT(GO_MSPAN_STARTADDR) ||
+	    !GO_FIELD_PRESENT(GO_MSPAN_NPAGES) ||
+	    !GO_FIELD_PRESENT(GO_MSPAN_ELEMSIZE)) {
+		mdb_warn("the heap needs Go 1.11 or later, and the binary's "
+		    "DWARF to describe it\n");
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int
+go_span_walk_init(mdb_walk_state_t *wsp,
+    boolean_t (*filter)(const void *, uintptr_t), uintptr_t arg)
+{
+	go_walk_t *gw;
+
+	if (go_heap_check() != 0 ||
+	    go_walk_init(wsp, &go_walk_span, B_TRUE) != WALK_NEXT)
+		return (WALK_ERR);
+
+	gw = wsp->walk_data;
+	gw->gw_filter = filter;
+	gw->gw_filterarg = arg;
+
+	return (WALK_NEXT);
+}
+
+/*ARGSUSED*/
+static boolean_t
+go_span_inuse(const void *rec, uintptr_t arg)
+{
+	return (((const go_srec_t *)rec)->sr_state == GO_MSPAN_INUSE);
+}
+
+static boolean_t
+go_span_inclass(const void *rec, uintptr_t sizeclass)
+{
+	const go_srec_t *sr = rec;
+
+	return (sr->sr_state == GO_MSPAN_INUSE &&
+	    sr->sr_sizeclass == sizeclass);
+}
+
+static int
+walk_go_span_init(mdb_walk_state_t *wsp)
+{
+	return (go_span_walk_init(wsp, NULL, 0));
+}
+
+static int
+walk_go_span_inuse_init(mdb_walk_state_t *wsp)
+{
+	return (go_span_walk_init(wsp, go_span_inuse, 0));
+}
+
+/*
+ * The size class to walk is given as the address; class 0 is the spans of
+ * large objects.
+ */
+static int
+walk_go_span_class_init(mdb_walk_state_t *wsp)
+{
+	uintptr_t sizeclass = wsp->walk_addr;
+
+	wsp->walk_addr = 0;
+	return (go_span_walk_init(wsp, go_span_inclass, sizeclass));
+}
+
+/*
+ * ::gosummary groups all the goroutines by status, wait reason and the PC
+ * that created them, in one pass of the go_g_rec walker.
+ */
+#define	GO_SUM_INITHASH		256
+#define	GO_SUM_WAITLEN		64
+
+typedef struct go_sumgrp {
+	struct go_sumgrp *sg_next;	/* hash chain */
+	uint32_t sg_status;
+	uint64_t sg_wait;
+	uint64_t sg_waitlen;
+	uintptr_t sg_gopc;
+	uint64_t sg_count;
+	uint64_t sg_stackbytes;
+} go_sumgrp_t;
+
+typedef struct go_summary {
+	go_sumgrp_t **gs_hash;
+	size_t gs_hashsz;
+	size_t gs_ngrps;
+	uint64_t gs_count;
+	uint64_t gs_stackbytes;
+} go_summary_t;
+
+#define	GO_SUM_HASH(status, wait, gopc, sz)	\
+	((size_t)((((uint64_t)(status) << 48) ^ ((uint64_t)(wait) << 24) ^ \
+	(gopc)) * 0x9e3779b97f4a7c15ULL >> 32) & ((sz) - 1))
+
+static void
+go_summary_grow(go_summary_t *gs)
+{
+	go_sumgrp_t **nhash, *sg;
+	size_t nsz, i, h;
+
+	nsz = gs->gs_hashsz == 0 ? GO_SUM_INITHASH : gs->gs_hashsz * 2;
+	nhash = mdb_zalloc(nsz * sizeof (go_sumgrp_t *), UM_SLEEP);
+
+	for (i = 0; i < gs->gs_hashsz; i++) {
+		while ((sg = gs->gs_hash[i]) != NULL) {
+			gs->gs_hash[i] = sg->sg_next;
+			h = GO_SUM_HASH(sg->sg_status, sg->sg_wait, sg->sg_gopc,
+			    nsz);
+			sg->sg_next = nhash[h];
+			nhash[h] = sg;
+		}
+	}
+
+	if (gs->gs_hash != NULL)
+		mdb_free(gs->gs_hash, gs->gs_hashsz * sizeof (go_sumgrp_t *));
+
+	gs->gs_hash = nhash;
+	gs->gs_hashsz = nsz;
+}
+
+/*ARGSUSED*/
+static int
+go_summary_g(uintptr_t addr, const void *data, void *arg)
+{
+	const go_grec_t *gr = data;
+	go_summary_t *gs = arg;
+	go_sumgrp_t *sg;
+	uint32_t status = GO_GSTATUS(gr->gr_status);
+	uint64_t wait, waitlen;
+	size_t h;
+
+	/* the runtime leaves the wait reason behind once it's running */
+	wait = status == GS_Gwaiting ? gr->gr_waitreason : 0;
+	waitlen = status == GS_Gwaiting ? gr->gr_waitlen : 0;
+
+	h = GO_SUM_HASH(status, wait, gr->gr_gopc, gs->gs_hashsz);
+	for (sg = gs->gs_hash[h]; sg != NULL; sg = sg->sg_next) {
+		if (sg->sg_status == status && sg->sg_wait == wait &&
+		    sg->sg_waitlen == waitlen && sg->sg_gopc == gr->gr_gopc)
+			break;
+	}
+
+	if (sg == NULL) {
+		if (gs->gs_ngrps >= gs->gs_hashsz) {
+			go_summary_grow(gs);
+			h = GO_SUM_HASH(status, wait, gr->gr_gopc,
+			    gs->gs_hashsz);
+		}
+
+		sg = mdb_zalloc(sizeof (go_sumgrp_t), UM_SLEEP);
+		sg->sg_status = status;
+		sg->sg_wait = wait;
+		sg->sg_waitlen = waitlen;
+		sg->sg_gopc = gr->gr_gopc;
+		sg->sg_next = gs->gs_hash[h];
+		gs->gs_hash[h] = sg;
+		gs->gs_ngrps++;
+	}
+
+	sg->sg_count++;
+	sg->sg_stackbytes += gr->gr_stacksize;
+	gs->gs_count++;
+	gs->gs_stackbytes += gr->gr_stacksize;
+
+	return (WALK_NEXT);
+}
+
+static int
+go_sumgrp_cmp(const void *l, const void *r)
+{
+	const go_sumgrp_t *lg = *(const go_sumgrp_t **)l;
+	const go_sumgrp_t *rg = *(const go_sumgrp_t **)r;
+
+	if (lg->sg_count != rg->sg_count)
+		return (lg->sg_count > rg->sg_count ? -1 : 1);
+	if (lg->sg_stackbytes != rg->sg_stackbytes)
+		return (lg->sg_stackbytes > rg->sg_stackbytes ? -1 : 1);
+	if (lg->sg_gopc != rg->sg_gopc)
+		return (lg->sg_gopc < rg->sg_gopc ? -1 : 1);
+	return (0);
+}
+
+/*
+ * Describe a wait reason.  The C runtime points g.waitreason at a C string;
+ * from Go 1.4 it is a Go string, whose length is waitlen; and from Go 1.11
+ * it is an index into runtime.waitReasonStrings, an array of Go strings.
+ */
+static void
+go_waitreason(uint64_t wait, uint64_t waitlen, char *buf, size_t len)
+{
+	GElf_Sym sym;
+	uintptr_t str[2];
+
+	(void) strcpy(buf, "-");
+
+	if (GO_FIELD_PRESENT(GO_G_WAITREASON_STR)) {
+		if (wait == 0 || waitlen == 0)
+			return;
+		if (waitlen > len - 1)
+			waitlen = len - 1;
+		if (go_vread(buf, (size_t)waitlen, (uintptr_t)wait) != -1)
+			buf[waitlen] = '\0';
+		else
+			(void) mdb_snprintf(buf, len, "%p", (uintptr_t)wait);
+		return;
+	}
+
+	if (go_fields[GO_G_WAITREASON].gf_size == sizeof (uintptr_t)) {
+		if (wait != 0 && go_readstr(buf, len, (uintptr_t)wait) <= 0)
+			(void) mdb_snprintf(buf, len, "%p", (uintptr_t)wait);
+		return;
+	}
+
+	if (wait == 0)
+		return;
+
+	if (mdb_lookup_by_name("runtime.waitReasonStrings", &sym) == 0 &&
+	    (wait + 1) * sizeof (str) <= sym.st_size &&
+	    go_vread(str, sizeof (str), sym.st_value +
+	    wait * sizeof (str)) != -1 && str[1] != 0) {
+		if (str[1] > len - 1)
+			str[1] = len - 1;
+		if (go_vread(buf, str[1], str[0]) != -1) {
+			buf[str[1]] = '\0';
+			return;
+		}
+	}
+
+	(void) mdb_snprintf(buf, len, "reason %llu", wait);
+}
+
+/*ARGSUSED*/
+static int
+dcmd_gosummary(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	go_summary_t gs;
+	go_sumgrp_t **grps, *sg;
+	char wait[GO_SUM_WAITLEN];
+	uintptr_t top = 20;
+	size_t i, n;
+	int rv = DCMD_OK;
+
+	if ((flags & DCMD_ADDRSPEC) || mdb_getopts(argc, argv,
+	    'n', MDB_OPT_UINTPTR, &top, NULL) != argc)
+		return (DCMD_USAGE);
+
+	bzero(&gs, sizeof (gs));
+	go_summary_grow(&gs);
+
+	if (mdb_walk("go_g_rec", go_summary_g, &gs) == -1) {
+		mdb_warn("failed to walk goroutines");
+		rv = DCMD_ERR;
+	}
+
+	grps = mdb_alloc((gs.gs_ngrps + 1) * sizeof (go_sumgrp_t *), UM_SLEEP);
+	for (n = 0, i = 0; i < gs.gs_hashsz; i++) {
+		for (sg = gs.gs_hash[i]; sg != NULL; sg = sg->sg_next)
+			grps[n++] = sg;
+	}
+	qsort(grps, n, sizeof (go_sumgrp_t *), go_sumgrp_cmp);
+
+	if (rv == DCMD_OK) {
+		mdb_printf("%8s %12s %-16s %-20s %s\n", "COUNT", "STACKBYTES",
+		    "STATUS", "WAIT", "CREATED BY");
+
+		for (i = 0; i < n && (top == 0 || i < top); i++) {
+			sg = grps[i];
+			go_waitreason(sg->sg_wait, sg->sg_waitlen, wait,
+			    sizeof (wait));
+			mdb_printf("%8llu %12llu %-16s %-20s %a\n", sg->sg_count,
+			    sg->sg_stackbytes,
+			    mdb_go_g_status((int16_t)sg->sg_status), wait,
+			    sg->sg_gopc);
+		}
+
+		if (i < n)
+			mdb_printf("%8s %12s (%lu more groups)\n", "...", "...",
+			    (ulong_t)(n - i));
+		mdb_printf("%8llu %12llu total in %lu groups\n", gs.gs_count,
+		    gs.gs_stackbytes, (ulong_t)n);
+	}
+
+	for (i = 0; i < n; i++)
+		mdb_free(grps[i], sizeof (go_sumgrp_t));
+	mdb_free(grps, (gs.gs_ngrps + 1) * sizeof (go_sumgrp_t *));
+	mdb_free(gs.gs_hash, gs.gs_hashsz * sizeof (go_sumgrp_t *));
+
+	return (rv);
+}
+
+static void
+dcmd_gosummary_help(void)
+{
+	mdb_printf(
+	    "Group all goroutines by status, wait reason and the PC of the go\n"
+	    "statement that created them, and print the largest groups with\n"
+	    "their goroutine counts and total stack bytes.\n\n"
+	    "  -n count  print at most count groups (default 20; 0 for all)\n");
+}
+
+/*
+ * ::gostacks unwinds every goroutine and groups those with the same stack
+ * (and status and wait reason), so that each distinct stack is symbolized
+ * and printed once, however many goroutines share it.
+ */
+#define	GO_STACK_MAXDEPTH	100
+#define	GO_STACKS_INITHASH	256
+
+typedef struct go_stackgrp {
+	struct go_stackgrp *sk_next;	/* hash chain */
+	uint64_t sk_hash;
+	uint32_t sk_status;
+	uint64_t sk_wait;
+	uint64_t sk_waitlen;
+	int sk_depth;
+	uintptr_t *sk_pcs;
+	int64_t *sk_goids;
+	size_t sk_count;
+	size_t sk_goidalloc;
+} go_stackgrp_t;
+
+typedef struct go_stacks {
+	go_stackgrp_t **gk_hash;
+	size_t gk_hashsz;
+	size_t gk_ngrps;
+	uint64_t gk_count;
+	uintptr_t gk_pcs[GO_STACK_MAXDEPTH];
+} go_stacks_t;
+
+static uint64_t
+go_stack_hash(uint32_t status, uint64_t wait, const uintptr_t *pcs, int n)
+{
+	uint64_t h = 0xcbf29ce484222325ULL ^ status ^ (wait << 16);
+	int i;
+
+	for (i = 0; i < n; i++)
+		h = (h ^ pcs[i]) * 0x100000001b3ULL;
+
+	return (h ^ (h >> 29));
+}
+
+static void
+go_stacks_grow(go_stacks_t *gk)
+{
+	go_stackgrp_t **nhash, *sk;
+	size_t nsz, i, h;
+
+	nsz = gk->gk_hashsz == 0 ? GO_STACKS_INITHASH : gk->gk_hashsz * 2;
+	nhash = mdb_zalloc(nsz * sizeof (go_stackgrp_t *), UM_SLEEP);
+
+	for (i = 0; i < gk->gk_hashsz; i++) {
+		while ((sk = gk->gk_hash[i]) != NULL) {
+			gk->gk_hash[i] = sk->sk_next;
+			h = sk->sk_hash & (nsz - 1);
+			sk->sk_next = nhash[h];
+			nhash[h] = sk;
+		}
+	}
+
+	if (gk->gk_hash != NULL)
+		mdb_free(gk->gk_hash, gk->gk_hashsz * sizeof (go_stackgrp_t *));
+
+	gk->gk_hash = nhash;
+	gk->gk_hashsz = nsz;
+}
+
+/*ARGSUSED*/
+static int
+go_stacks_g(uintptr_t addr, const void *data, void *arg)
+{
+	const go_grec_t *gr = data;
+	go_stacks_t *gk = arg;
+	go_stackgrp_t *sk;
+	uintptr_t pc, sp;
+	uint64_t wait, waitlen, hash;
+	uint32_t status = GO_GSTATUS(gr->gr_status);
+	int64_t *ngoids;
+	int n;
+
+	if (status == GS_Gdead || status == GS_Gidle)
+		return (WALK_NEXT);
+
+	if (status == GS_Gsyscall && gr->gr_syscallsp != 0) {
+		pc = gr->gr_syscallpc;
+		sp = gr->gr_syscallsp;
+	} else {
+		pc = gr->gr_pc;
+		sp = gr->gr_sp;
+	}
+
+	n = go_unwind(pc, sp, gr->gr_stackhi, gk->gk_pcs, GO_STACK_MAXDEPTH);
+	wait = status == GS_Gwaiting ? gr->gr_waitreason : 0;
+	waitlen = status == GS_Gwaiting ? gr->gr_waitlen : 0;
+	hash = go_stack_hash(status, wait, gk->gk_pcs, n);
+
+	for (sk = gk->gk_hash[hash & (gk->gk_hashsz - 1)]; sk != NULL;
+	    sk = sk->sk_next) {
+		if (sk->sk_hash == hash && sk->sk_status == status &&
+		    sk->sk_wait == wait && sk->sk_waitlen == waitlen &&
+		    sk->sk_depth == n &&
+		    bcmp(sk->sk_pcs, gk->gk_pcs, n * sizeof (uintptr_t)) == 0)
+			break;
+	}
+
+	if (sk == NULL) {
+		if (gk->gk_ngrps >= gk->gk_hashsz)
+			go_stacks_grow(gk);
+
+		sk = mdb_zalloc(sizeof (go_stackgrp_t), UM_SLEEP);
+		sk->sk_hash = hash;
+		sk->sk_status = status;
+		sk->sk_wait = wait;
+		sk->sk_waitlen = waitlen;
+		sk->sk_depth = n;
+		if (n != 0) {
+			sk->sk_pcs = mdb_alloc(n * sizeof (uintptr_t),
+			    UM_SLEEP);
+			bcopy(gk->gk_pcs, sk->sk_pcs, n * sizeof (uintptr_t));
+		}
+		sk->sk_next = gk->gk_hash[hash & (gk->gk_hashsz - 1)];
+		gk->gk_hash[hash & (gk->gk_hashsz - 1)] = sk;
+		gk->gk_ngrps++;
+	}
+
+	if (sk->sk_count == sk->sk_goidalloc) {
+		size_t nalloc = sk->sk_goidalloc == 0 ? 4 :
+		    sk->sk_goidalloc * 2;
+
+		ngoids = mdb_alloc(nalloc * sizeof (int64_t), UM_SLEEP);
+		if (sk->sk_goids != NULL) {
+			bcopy(sk->sk_goids, ngoids,
+			    sk->sk_count * sizeof (int64_t));
+			mdb_free(sk->sk_goids,
+			    sk->sk_goidalloc * sizeof (int64_t));
+		}
+		sk->sk_goids = ngoids;
+		sk->sk_goidalloc = nalloc;
+	}
+
+	sk->sk_goids[sk->sk_count++] = gr->gr_goid;
+	gk->gk_count++;
+
+	return (WALK_NEXT);
+}
+
+static int
+go_stackgrp_cmp(const void *l, const void *r)
+{
+	const go_stackgrp_t *lk = *(const go_stackgrp_t **)l;
+	const go_stackgrp_t *rk = *(const go_stackgrp_t **)r;
+
+	if (lk->sk_count != rk->sk_count)
+		return (lk->sk_count > rk->sk_count ? -1 : 1);
+	if (lk->sk_goids[0] != rk->sk_goids[0])
+		return (lk->sk_goids[0] < rk->sk_goids[0] ? -1 : 1);
+	return (0);
+}
+
+/*
+ * Print a frame of a stack, preceded by the calls inlined at its PC.  A
+ * return address follows the call, which may be the last instruction of the
+ * function, so its line is that of the instruction before.
+ */
+static void
+go_stacks_frame(uintptr_t pc, boolean_t ret)
+{
+	uintptr_t lookup = ret ? pc - 1 : pc, offset;
+	go_inlframe_t inl[GO_INL_MAXDEPTH];
+	const char *name, *file;
+	int32_t line;
+	int i, ninl;
+	go_func_t f;
+
+	if ((offset = findfunc(lookup)) == 0 ||
+	    go_func_read(offset, &f) != 0 ||
+	    (name = go_funcname(&f)) == NULL) {
+		mdb_printf("    %p\n", pc);
+		return;
+	}
+
+	ninl = go_inline_frames(offset, &f, lookup, inl, GO_INL_MAXDEPTH,
+	    &lookup);
+	for (i = 0; i < ninl; i++) {
+		mdb_printf("    %s (inlined)\n",
+		    inl[i].gi_name != NULL ? inl[i].gi_name : "?");
+		mdb_printf("        %s:%d\n",
+		    inl[i].gi_file != NULL ? inl[i].gi_file : "?",
+		    inl[i].gi_line);
+	}
+
+	file = go_filename(&f, pcvalue(&f, f.pcfile, lookup));
+	line = pcvalue(&f, f.pcln, lookup);
+
+	mdb_printf("    %s+0x%lx\n", name, (ulong_t)(pc - f.entry));
+	mdb_printf("        %s:%d\n", file != NULL ? file : "?", line);
+}
+
+/*ARGSUSED*/
+static int
+dcmd_gostacks(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	go_stacks_t *gk;
+	go_stackgrp_t **grps, *sk;
+	char wait[GO_SUM_WAITLEN];
+	size_t i, j, n;
+	int rv = DCMD_OK, d;
+
+	if ((flags & DCMD_ADDRSPEC) || argc != 0)
+		return (DCMD_USAGE);
+
+	gk = mdb_zalloc(sizeof (go_stacks_t), UM_SLEEP);
+	go_stacks_grow(gk);
+
+	if (mdb_walk("go_g_rec", go_stacks_g, gk) == -1) {
+		mdb_warn("failed to walk goroutines");
+		rv = DCMD_ERR;
+	}
+
+	grps = mdb_alloc((gk->gk_ngrps + 1) * sizeof (go_stackgrp_t *),
+	    UM_SLEEP);
+	for (n = 0, i = 0; i < gk->gk_hashsz; i++) {
+		for (sk = gk->gk_hash[i]; sk != NULL; sk = sk->sk_next)
+			grps[n++] = sk;
+	}
+	qsort(grps, n, sizeof (go_stackgrp_t *), go_stackgrp_cmp);
+
+	for (i = 0; rv == DCMD_OK && i < n; i++) {
+		sk = grps[i];
+
+		mdb_printf("%lu goroutine%s [%s", (ulong_t)sk->sk_count,
+		    sk->sk_count == 1 ? "" : "s",
+		    mdb_go_g_status((int16_t)sk->sk_status));
+		if (sk->sk_wait != 0) {
+			go_waitreason(sk->sk_wait, sk->sk_waitlen, wait,
+			    sizeof (wait));
+			mdb_printf(", %s", wait);
+		}
+		mdb_printf("]:");
+		for (j = 0; j < sk->sk_count; j++)
+			mdb_printf(" %lld", sk->sk_goids[j]);
+		mdb_printf("\n");
+
+		for (d = 0; d < sk->sk_depth; d++)
+			go_stacks_frame(sk->sk_pcs[d], d != 0);
+		if (sk->sk_depth == GO_STACK_MAXDEPTH)
+			mdb_printf("    ...\n");
+		mdb_printf("\n");
+	}
+
+	if (rv == DCMD_OK) {
+		mdb_printf("%llu goroutines, %lu distinct stacks\n",
+		    gk->gk_count, (ulong_t)n);
+	}
+
+	for (i = 0; i < n; i++) {
+		sk = grps[i];
+		if (sk->sk_pcs != NULL)
+			mdb_free(sk->sk_pcs, sk->sk_depth * sizeof (uintptr_t));
+		mdb_free(sk->sk_goids, sk->sk_goidalloc * sizeof (int64_t));
+		mdb_free(sk, sizeof (go_stackgrp_t));
+	}
+	mdb_free(grps, (gk->gk_ngrps + 1) * sizeof (go_stackgrp_t *));
+	mdb_free(gk->gk_hash, gk->gk_hashsz * sizeof (go_stackgrp_t *));
+	mdb_free(gk, sizeof (go_stacks_t));
+
+	return (rv);
+}
+
+static void
+dcmd_gostacks_help(void)
+{
+	mdb_printf(
+	    "Print the stack of every goroutine, grouping goroutines whose\n"
+	    "stacks, status and wait reason are the same: each distinct stack\n"
+	    "is printed once, with the number of goroutines and their IDs.\n"
+	    "Goroutines are unwound from their saved registers, or from where\n"
+	    "they entered a system call.\n");
+}
+
+/*
+ * ::gosym symbolizes a batch of PCs together.  The PCs are sorted and met
+ * by a single cursor moving forward through the function table, so that
+ * each function with PCs in it is read and named once, and its file and
+ * line tables are each decoded once, in one pass, for all of its PCs.  The
+ * cursor skips over functions with no PCs in them using the lookup index,
+ * so a batch costs about as much as the PCs and functions it touches.  The
+ * answers are printed in the order the PCs came in.
+ */
+typedef struct go_sym {
+	uintptr_t sy_pc;		/* PC as given */
+	uintptr_t sy_lookup;		/* PC to look up */
+	size_t sy_ndx;			/* position in the input */
+	const char *sy_name;		/* NULL if not in any function */
+	const char *sy_file;
+	uintptr_t sy_off;
+	int32_t sy_line;
+} go_sym_t;
+
+static int
+go_sym_cmp(const void *l, const void *r)
+{
+	const go_sym_t *ls = l;
+	const go_sym_t *rs = r;
+
+	if (ls->sy_lookup != rs->sy_lookup)
+		return (ls->sy_lookup < rs->sy_lookup ? -1 : 1);
+	return (ls->sy_ndx < rs->sy_ndx ? -1 : ls->sy_ndx > rs->sy_ndx);
+}
+
+static int
+go_sym_ndxcmp(const void *l, const void *r)
+{
+	const go_sym_t *ls = l;
+	const go_sym_t *rs = r;
+
+	return (ls->sy_ndx < rs->sy_ndx ? -1 : ls->sy_ndx > rs->sy_ndx);
+}
+
+/*
+ * Symbolize syms[0..n), which are sorted by lookup PC.
+ */
+static void
+go_sym_resolve(go_sym_t *syms, size_t n)
+{
+	const go_functbl_t *ftbl;
+	uintptr_t *pcs;
+	int32_t *files, *lines;
+	const char *name;
+	ssize_t idx = -1;
+	size_t i, j, k;
+	go_func_t f;
+
+	if ((ftbl = go_ftab_load()) == NULL)
+		return;
+
+	pcs = mdb_alloc(n * sizeof (uintptr_t), UM_SLEEP);
+	files = mdb_alloc(n * sizeof (int32_t), UM_SLEEP);
+	lines = mdb_alloc(n * sizeof (int32_t), UM_SLEEP);
+
+	for (i = 0; i < n; i = k) {
+		uintptr_t pc = syms[i].sy_lookup;
+
+		if (idx == -1 || pc >= ftbl[idx + 1].entry) {
+			if (idx != -1 && (size_t)idx + 1 < go_findtab.ft_nfunc &&
+			    pc < ftbl[idx + 2].entry)
+				idx++;
+			else
+				idx = go_findtab_lookup(&go_findtab, pc);
+		}
+
+		if (idx == -1) {
+			k = i + 1;
+			continue;
+		}
+
+		for (k = i; k < n && syms[k].sy_lookup < ftbl[idx + 1].entry;
+		    k++)
+			pcs[k - i] = syms[k].sy_lookup;
+
+		if (go_func_read(ftbl[idx].offset, &f) != 0 ||
+		    (name = go_funcname(&f)) == NULL)
+			continue;
+
+		pcvalue_multi(&f, f.pcfile, pcs, files, k - i);
+		pcvalue_multi(&f, f.pcln, pcs, lines, k - i);
+
+		for (j = i; j < k; j++) {
+			syms[j].sy_name = name;
+			syms[j].sy_off = syms[j].sy_pc - f.entry;
+			syms[j].sy_file = go_filename(&f, files[j - i]);
+			syms[j].sy_line = lines[j - i];
+		}
+	}
+
+	mdb_free(pcs, n * sizeof (uintptr_t));
+	mdb_free(files, n * sizeof (int32_t));
+	mdb_free(lines, n * sizeof (int32_t));
+}
+
+static int
+dcmd_gosym(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint_t opt_r = B_FALSE;
+	mdb_pipe_t p;
+	go_sym_t *syms;
+	size_t i, n = 0, npipe = 0;
+	int rv = DCMD_OK, nargs;
+
+	nargs = mdb_getopts(argc, argv,
+	    'r', MDB_OPT_SETBITS, B_TRUE, &opt_r, NULL);
+	argc -= nargs;
+	argv += nargs;
+
+	if (flags & DCMD_PIPE) {
+		mdb_get_pipe(&p);
+		npipe = p.pipe_len;
+	} else if (flags & DCMD_ADDRSPEC) {
+		p.pipe_data = &addr;
+		npipe = 1;
+	}
+
+	if (npipe + argc == 0)
+		return (DCMD_USAGE);
+
+	syms = mdb_zalloc((npipe + argc) * sizeof (go_sym_t), UM_SLEEP);
+
+	for (i = 0; i < npipe; i++)
+		syms[n++].sy_pc = p.pipe_data[i];
+
+	for (i = 0; i < argc; i++) {
+		if (argv[i].a_type == MDB_TYPE_STRING &&
+		    argv[i].a_un.a_str[0] != '-') {
+			syms[n++].sy_pc = mdb_strtoull(argv[i].a_un.a_str);
+		} else if (argv[i].a_type == MDB_TYPE_IMMEDIATE) {
+			syms[n++].sy_pc = argv[i].a_un.a_val;
+		} else {
+			rv = DCMD_USAGE;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		syms[i].sy_ndx = i;
+		syms[i].sy_lookup = opt_r && syms[i].sy_pc != 0 ?
+		    syms[i].sy_pc - 1 : syms[i].sy_pc;
+	}
+
+	qsort(syms, n, sizeof (go_sym_t), go_sym_cmp);
+	go_sym_resolve(syms, n);
+	qsort(syms, n, sizeof (go_sym_t), go_sym_ndxcmp);
+
+	for (i = 0; i < n; i++) {
+		if (syms[i].sy_name == NULL) {
+			mdb_printf("%p\n", syms[i].sy_pc);
+			continue;
+		}
+		mdb_printf("%s+0x%lx %s:%d\n", syms[i].sy_name,
+		    (ulong_t)syms[i].sy_off,
+		    syms[i].sy_file != NULL ? syms[i].sy_file : "?",
+		    syms[i].sy_line);
+	}
+
+out:
+	mdb_free(syms, (npipe + argc) * sizeof (go_sym_t));
+	return (rv);
+}
+
+static void
+dcmd_gosym_help(void)
+{
+	mdb_printf(
+	    "Print the function, offset, file and line of each PC given as\n"
+	    "the address, as an argument or on a pipe, in the order given.\n"
+	    "All PCs are symbolized together in one pass over the function\n"
+	    "table, so piping a large batch into a single ::gosym is much\n"
+	    "cheaper than symbolizing each PC by itself.\n"
+	    "\n"
+	    "  -r  the PCs are return addresses: look up the instruction\n"
+	    "      before each, as a stack trace does\n");
+}
+
+/*
+ * The function name index, for ::gofunc.  Every function in the function
+ * table is named once, and the names are sorted, so that a prefix (such as
+ * a package path) is a binary search and a scan of the names that follow;
+ * an open-addressed hash table of the distinct names makes an exact lookup
+ * a single probe or so.  The index is built on the first query and kept
+ * until the function table or the interned names it points to go away.
+ */
+#define	GO_NAMES_EMPTY		0
+
+typedef struct go_nameent {
+	const char *ne_name;		/* interned */
+	uint32_t ne_idx;		/* index in the function table */
+} go_nameent_t;
+
+static go_nameent_t *go_names;
+static size_t go_nnames;
+static size_t go_names_alloc;
+static uint32_t *go_names_hash;		/* 1 + index in go_names, or 0 */
+static size_t go_names_hashsz;
+
+static uint64_t
+go_names_hashstr(const char *s)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (*s != '\0')
+		h = (h ^ (uchar_t)*s++) * 0x100000001b3ULL;
+
+	return (h);
+}
+
+static void
+go_names_flush(void)
+{
+	if (go_names != NULL)
+		mdb_free(go_names, go_names_alloc * sizeof (go_nameent_t));
+	if (go_names_hash != NULL)
+		mdb_free(go_names_hash, go_names_hashsz * sizeof (uint32_t));
+
+	go_names = NULL;
+	go_nnames = 0;
+	go_names_alloc = 0;
+	go_names_hash = NULL;
+	go_names_hashsz = 0;
+}
+
+static int
+go_nameent_cmp(const void *l, const void *r)
+{
+	const go_nameent_t *ln = l;
+	const go_nameent_t *rn = r;
+	int c;
+
+	if ((c = strcmp(ln->ne_name, rn->ne_name)) != 0)
+		return (c);
+	return (ln->ne_idx < rn->ne_idx ? -1 : ln->ne_idx > rn->ne_idx);
+}
+
+static int
+go_names_load(void)
+{
+	const go_functbl_t *ftbl;
+	const char *name;
+	size_t i, n, h;
+	go_func_t f;
+
+	if (go_names != NULL)
+		return (0);
+
+	if ((ftbl = go_ftab_load()) == NULL)
+		return (-1);
+
+	n = go_findtab.ft_nfunc;
+	go_names = mdb_alloc(n * sizeof (go_nameent_t), UM_SLEEP);
+	go_names_alloc = n;
+
+	for (i = 0; i < n; i++) {
+		if (go_func_read(ftbl[i].offset, &f) != 0 ||
+		    (name = go_funcname(&f)) == NULL)
+			continue;
+
+		go_names[go_nnames].ne_name = name;
+		go_names[go_nnames].ne_idx = (uint32_t)i;
+		go_nnames++;
+	}
+
+	qsort(go_names, go_nnames, sizeof (go_nameent_t), go_nameent_cmp);
+
+	/*
+	 * Only the first of a run of equal names goes in the hash table;
+	 * the rest follow it in go_names.
+	 */
+	for (go_names_hashsz = 1; go_names_hashsz < go_nnames * 2; )
+		go_names_hashsz *= 2;
+	go_names_hash = mdb_zalloc(go_names_hashsz * sizeof (uint32_t),
+	    UM_SLEEP);
+
+	for (i = 0; i < go_nnames; i++) {
+		if (i != 0 && strcmp(go_names[i - 1].ne_name,
+		    go_names[i].ne_name) == 0)
+			continue;
+
+		h = go_names_hashstr(go_names[i].ne_name) &
+		    (go_names_hashsz - 1);
+		while (go_names_hash[h] != GO_NAMES_EMPTY)
+			h = (h + 1) & (go_names_hashsz - 1);
+		go_names_hash[h] = (uint32_t)i + 1;
+	}
+
+	return (0);
+}
+
+/*
+ * Find the names in go_names equal to name, returning the index of the
+ * first and setting *endp to one past the last.
+ */
+static size_t
+go_names_exact(const char *name, size_t *endp)
+{
+	size_t h, i, end;
+
+	h = go_names_hashstr(name) & (go_names_hashsz - 1);
+	for (; go_names_hash[h] != GO_NAMES_EMPTY;
+	    h = (h + 1) & (go_names_hashsz - 1)) {
+		i = go_names_hash[h] - 1;
+		if (strcmp(go_names[i].ne_name, name) != 0)
+			continue;
+
+		for (end = i + 1; end < go_nnames &&
+		    strcmp(go_names[end].ne_name, name) == 0; end++)
+			continue;
+
+		*endp = end;
+		return (i);
+	}
+
+	*endp = 0;
+	return (0);
+}
+
+/*
+ * Likewise for the names beginning with prefix.
+ */
+static size_t
+go_names_prefix(const char *prefix, size_t *endp)
+{
+	size_t len = strlen(prefix), lo, hi, mid, end;
+
+	for (lo = 0, hi = go_nnames; lo < hi; ) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(go_names[mid].ne_name, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (end = lo; end < go_nnames &&
+	    strncmp(go_names[end].ne_name, prefix, len) == 0; end++)
+		continue;
+
+	*endp = end;
+	return (lo);
+}
+
+/*
+ * The size of a function's frame: the largest SP delta in its pcsp table.
+ * (Go 1.16 and later don't record it anywhere else.)
+ */
+static int32_t
+go_func_framesize(go_func_t *f)
+{
+	go_pcreader_t pr;
+	uintptr_t pc = f->entry;
+	int32_t value = -1, max = 0;
+
+	if (f->pcsp == 0)
+		return (f->frame);
+
+	go_pcreader_init(&pr, pclntab + f->pcsp);
+	while (step(&pr, &pc, &value, pc == f->entry) == 1) {
+		if (value > max)
+			max = value;
+	}
+
+	return (max);
+}
+
+static void
+go_func_print(const go_nameent_t *ne, uint_t flags)
+{
+	const char *file;
+	char args[16];
+	go_func_t f;
+
+	if (go_func_read(go_findtab.ft_ftab[ne->ne_idx].offset, &f) != 0) {
+		mdb_warn("failed to read function %s\n", ne->ne_name);
+		return;
+	}
+
+	if (flags & DCMD_PIPE_OUT) {
+		mdb_printf("%p\n", f.entry);
+		return;
+	}
+
+	if (f.args == GO_ARGS_UNKNOWN)
+		(void) strcpy(args, "-");
+	else
+		(void) mdb_snprintf(args, sizeof (args), "%u", f.args);
+
+	file = go_filename(&f, pcvalue(&f, f.pcfile, f.entry));
+	mdb_printf("%0?p %6d %6s %s %s:%d\n", f.entry, go_func_framesize(&f),
+	    args, ne->ne_name, file != NULL ? file : "?",
+	    pcvalue(&f, f.pcln, f.entry));
+}
+
+static int
+dcmd_gofunc(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint_t opt_p = B_FALSE;
+	const char *opt_r = NULL, *name = NULL;
+	size_t i, end;
+	regex_t re;
+	int err;
+	char errbuf[128];
+
+	if (flags & DCMD_ADDRSPEC)
+		return (DCMD_USAGE);
+
+	i = mdb_getopts(argc, argv,
+	    'p', MDB_OPT_SETBITS, B_TRUE, &opt_p,
+	    'r', MDB_OPT_STR, &opt_r, NULL);
+
+	if (opt_r != NULL) {
+		if (i != argc || opt_p)
+			return (DCMD_USAGE);
+	} else {
+		if (i != argc - 1 || argv[i].a_type != MDB_TYPE_STRING)
+			return (DCMD_USAGE);
+		name = argv[i].a_un.a_str;
+	}
+
+	if (go_names_load() != 0)
+		return (DCMD_ERR);
 
-	if (len == -1) {
-        mdb_warn("findfunc mdb_vread failed");
-		return (NULL);
+	if (opt_r != NULL &&
+	    (err = regcomp(&re, opt_r, REG_EXTENDED | REG_NOSUB)) != 0) {
+		(void) regerror(err, &re, errbuf, sizeof (errbuf));
+		mdb_warn("bad regular expression \"%s\": %s\n", opt_r, errbuf);
+		return (DCMD_ERR);
 	}
 
-	if (addr < ftbl[0].entry || addr >= ftbl[ftabsize - 1].entry) {
-		mdb_free(ftbl, GO_FUNCTABLE_SIZE);
-        mdb_warn("findfunc addr is outside of symbol table");
-		return (NULL);
+	if (opt_r != NULL) {
+		i = 0;
+		end = go_nnames;
+	} else if (opt_p) {
+		i = go_names_prefix(name, &end);
+	} else if ((i = go_names_exact(name, &end)) == end) {
+		mdb_warn("no function named %s\n", name);
+		return (DCMD_ERR);
 	}
 
-	nf = ftabsize;
+	if (!(flags & DCMD_PIPE_OUT) && i < end) {
+		mdb_printf("%<u>%-?s %6s %6s %s%</u>\n", "ENTRY", "FRAME",
+		    "ARGS", "FUNCTION AND SOURCE");
+	}
 
-	while (nf > 0) {
-		n = nf/2;
-		if (ftbl[n].entry <= addr && addr < ftbl[n+1].entry) {
-			return (ftbl[n].offset);
-		} else if (addr < ftbl[n].entry)
-			nf = n;
-		else {
-			ftbl += n+1;
-			nf -= n+1;
-		}
+	for (; i < end; i++) {
+		if (opt_r != NULL &&
+		    regexec(&re, go_names[i].ne_name, 0, NULL, 0) != 0)
+			continue;
+		go_func_print(&go_names[i], flags);
 	}
 
-	mdb_warn("unable to find go function at 0x%x\n", addr);
-	mdb_free(ftbl, GO_FUNCTABLE_SIZE);
-	return (NULL);
+	if (opt_r != NULL)
+		regfree(&re);
+
+	return (DCMD_OK);
 }
 
-static uint32_t
-readvarint(unsigned char **pp)
+static void
+dcmd_gofunc_help(void)
 {
-	unsigned char *p;
-	uint32_t v;
-	int32_t shift;
+	mdb_printf(
+	    "Look up Go functions by name, printing each one's entry point,\n"
+	    "frame size, argument size and the file and line where it\n"
+	    "starts.  The first query builds an index of the names of all\n"
+	    "the functions in the binary.\n"
+	    "\n"
+	    "  -p         print the functions whose names begin with name,\n"
+	    "             such as all of a package's\n"
+	    "  -r regex   print the functions whose names match the extended\n"
+	    "             regular expression\n"
+	    "\n"
+	    "As the source of a pipe, print only the entry points.\n");
+}
 
-	v = 0;
-	p = *pp;
+/*
+ * The line index, for ::golines: which PCs came from a given file and line.
+ * It's built in one pass over every function, walking its pcfile and pcln
+ * tables side by side and recording each run of PCs with the same file and
+ * line as an interval.  Files are numbered by name, since the same file has
+ * a different key in each compilation unit it's inlined into.  The intervals
+ * are then sorted by file, line and PC, and intervals that touch are merged,
+ * so a query is a binary search and a short scan.  Like the name index, the
+ * line index lasts until the function table or the interned names go.
+ */
+typedef struct go_lineent {
+	uint32_t le_file;		/* index in go_lines_files */
+	int32_t le_line;
+	uint32_t le_start;		/* offsets from the start of the text */
+	uint32_t le_end;
+} go_lineent_t;
+
+typedef struct go_linebuild {
+	uint32_t *lb_keymap;		/* file key to 1 + file index, or 0 */
+	size_t lb_nkeys;
+	uint32_t *lb_hash;		/* file name to 1 + file index, or 0 */
+	size_t lb_hashsz;
+} go_linebuild_t;
+
+static go_lineent_t *go_lines;
+static size_t go_nlines;
+static size_t go_lines_alloc;
+static const char **go_lines_files;
+static size_t go_lines_nfiles;
+static size_t go_lines_filesalloc;
+static boolean_t go_lines_loaded;
 
-	for (shift = 0; ; shift += 7) {
-		v |= (*p & 0x7F) << shift;
-		if (!(*p++ & 0x80))
-			break;
+static void
+go_lines_flush(void)
+{
+	if (go_lines != NULL)
+		mdb_free(go_lines, go_lines_alloc * sizeof (go_lineent_t));
+	if (go_lines_files != NULL) {
+		mdb_free(go_lines_files,
+		    go_lines_filesalloc * sizeof (const char *));
 	}
 
-	*pp = p;
-	return v;
+	go_lines = NULL;
+	go_nlines = 0;
+	go_lines_alloc = 0;
+	go_lines_files = NULL;
+	go_lines_nfiles = 0;
+	go_lines_filesalloc = 0;
+	go_lines_loaded = B_FALSE;
 }
 
-static int
-step(unsigned char **pp, uintptr_t *pc, int32_t *value, int first)
+static void
+go_linebuild_rehash(go_linebuild_t *lb, size_t nsz)
 {
-	uint32_t uvdelta, pcdelta;
-	int32_t vdelta;
+	size_t i, h;
 
-	uvdelta = readvarint(pp);
+	if (lb->lb_hash != NULL)
+		mdb_free(lb->lb_hash, lb->lb_hashsz * sizeof (uint32_t));
 
-	if (uvdelta == 0 && !first)
-		return 0;
-	if (uvdelta & 1)
-		uvdelta = ~(uvdelta >> 1);
-	else
-		uvdelta >>= 1;
+	lb->lb_hash = mdb_zalloc(nsz * sizeof (uint32_t), UM_SLEEP);
+	lb->lb_hashsz = nsz;
 
-	vdelta = (int32_t)uvdelta;
-	pcdelta = readvarint(pp) * GO_PC_QUANTUM;
-	*value += vdelta;
-	*pc += pcdelta;
-	return 1;
+	for (i = 0; i < go_lines_nfiles; i++) {
+		h = go_names_hashstr(go_lines_files[i]) & (nsz - 1);
+		while (lb->lb_hash[h] != 0)
+			h = (h + 1) & (nsz - 1);
+		lb->lb_hash[h] = (uint32_t)i + 1;
+	}
 }
 
-static int32_t
-pcvalue(go_func_t *f, int32_t off, uintptr_t targetpc)
+/*
+ * The index of the file with key f->cuoff + file, numbering it if it's new;
+ * -1 if it has no name.
+ */
+static int64_t
+go_linebuild_file(go_linebuild_t *lb, const go_func_t *f, int32_t file)
 {
-	unsigned char *p;
-	uintptr_t pc, val;
-	int32_t value;
-	ssize_t len;
-
-	if (off == 0)
-		return -1;
+	uint32_t key = f->cuoff + (uint32_t)file, *nmap;
+	const char **nfiles;
+	const char *name;
+	size_t nsz, h, idx;
 
-	len = mdb_vread(&val, sizeof(val), pclntab + off);
-	if (len == -1) {
-		mdb_warn("Unable to read pcvalue\n");
-		return -1;
-	}
+	if (key < lb->lb_nkeys && lb->lb_keymap[key] != 0)
+		return (lb->lb_keymap[key] - 1);
 
-	p = (unsigned char *)&val;
-	pc = f->entry;
-	value = -1;
+	if ((name = go_filename(f, file)) == NULL)
+		return (-1);
 
-	while (step(&p, &pc, &value, pc == f->entry)) {
-		if (targetpc < pc)
-			return value;
+	h = go_names_hashstr(name) & (lb->lb_hashsz - 1);
+	for (; lb->lb_hash[h] != 0; h = (h + 1) & (lb->lb_hashsz - 1)) {
+		if (strcmp(go_lines_files[lb->lb_hash[h] - 1], name) == 0)
+			break;
 	}
-	return -1;
-}
 
-static int
-do_goframe(uintptr_t addr, uintptr_t sp, char *prop)
-{
-	uintptr_t offset, arg;
-	uint32_t file, fileoff, lineno, spdelta, i;
-	char funcname[512], filename[512]; // XXX
-	go_func_t f, *fp;
+	if (lb->lb_hash[h] != 0) {
+		idx = lb->lb_hash[h] - 1;
+	} else {
+		if (go_lines_nfiles == go_lines_filesalloc) {
+			nsz = go_lines_filesalloc * 2;
+			nfiles = mdb_alloc(nsz * sizeof (const char *),
+			    UM_SLEEP);
+			bcopy(go_lines_files, nfiles,
+			    go_lines_nfiles * sizeof (const char *));
+			mdb_free(go_lines_files,
+			    go_lines_filesalloc * sizeof (const char *));
+			go_lines_files = nfiles;
+			go_lines_filesalloc = nsz;
+		}
 
-	offset = findfunc(addr);
-	if (offset == NULL) {
-		return (DCMD_ERR);
-	}
+		idx = go_lines_nfiles++;
+		go_lines_files[idx] = name;
+		lb->lb_hash[h] = (uint32_t)idx + 1;
 
-	if (mdb_vread(&f, sizeof (go_func_t),
-	    GO_PCLNTAB_OFFSET(offset)) == -1) {
-		mdb_warn("Could not load function from function table\n");
-		return (DCMD_ERR);
+		if (go_lines_nfiles * 2 > lb->lb_hashsz)
+			go_linebuild_rehash(lb, lb->lb_hashsz * 2);
 	}
 
-	fp = &f;
-	file = pcvalue(fp, fp->pcfile, addr);
-	lineno = pcvalue(fp, fp->pcln, addr);
-	spdelta = pcvalue(fp, fp->pcsp, addr);
-
-	if (mdb_vread(&funcname, sizeof (funcname),
-	    GO_PCLNTAB_OFFSET(f.nameoff)) == -1) {
-		mdb_warn("Could not read function name\n");
-		return (DCMD_ERR);
+	if (key >= lb->lb_nkeys) {
+		for (nsz = lb->lb_nkeys; nsz <= key; nsz *= 2)
+			continue;
+		nmap = mdb_zalloc(nsz * sizeof (uint32_t), UM_SLEEP);
+		bcopy(lb->lb_keymap, nmap, lb->lb_nkeys * sizeof (uint32_t));
+		mdb_free(lb->lb_keymap, lb->lb_nkeys * sizeof (uint32_t));
+		lb->lb_keymap = nmap;
+		lb->lb_nkeys = nsz;
 	}
 
-	if (mdb_vread(&fileoff, sizeof (fileoff),
-	    GO_FILETAB_OFFSET(file)) == -1) {
-		mdb_warn("Could not load filename offset\n");
-		return (DCMD_ERR);
-	}
+	lb->lb_keymap[key] = (uint32_t)idx + 1;
 
-	if (mdb_vread(&filename, sizeof (filename),
-	    GO_PCLNTAB_OFFSET(fileoff)) == -1) {
-		mdb_warn("Could not load filename\n");
-		return (DCMD_ERR);
-	}
+	return (idx);
+}
 
-	if (prop != NULL && strcmp(prop, "name") == 0) {
-		mdb_printf("%s(", funcname);
-		for (i = 1; i <= (f.args / sizeof (uintptr_t)); i++) {
-			mdb_vread(&arg, sizeof (arg), sp + (i * sizeof (uintptr_t)));
-			mdb_printf("%s0x%x", i == 1 ? "" : ", ", arg);
+static void
+go_lines_add(uint32_t file, int32_t line, uint32_t start, uint32_t end)
+{
+	go_lineent_t *le, *nlines;
+	size_t nsz;
+
+	/* a run that carries on from the last one extends it */
+	if (go_nlines != 0) {
+		le = &go_lines[go_nlines - 1];
+		if (le->le_file == file && le->le_line == line &&
+		    le->le_end == start) {
+			le->le_end = end;
+			return;
 		}
-		mdb_printf(")\n", funcname);
-		return (DCMD_OK);
 	}
 
-	mdb_printf("%p = {\n", f);
-	mdb_inc_indent(8);
-	mdb_printf("entry = %p,\n", f.entry);
-	mdb_printf("nameoff = %p (%s),\n", f.nameoff, funcname);
-	mdb_printf("args = %p (len=%d),\n", f.args, (f.args / sizeof (uintptr_t)));
-	mdb_printf("frame = %p,\n", f.frame);
-	mdb_printf("pcsp = %p (delta=%d),\n", f.pcsp, spdelta);
-	mdb_printf("pcfile = %p (%s),\n", f.pcfile, filename);
-	mdb_printf("pcln = %p (%d),\n", f.pcln, lineno);
-	mdb_printf("npcdata = %p,\n", f.npcdata);
-	mdb_printf("nfuncdata = %p,\n", f.nfuncdata);
-	mdb_dec_indent(8);
-	mdb_printf("}\n");
-	return (DCMD_OK);
+	if (go_nlines == go_lines_alloc) {
+		nsz = go_lines_alloc * 2;
+		nlines = mdb_alloc(nsz * sizeof (go_lineent_t), UM_SLEEP);
+		bcopy(go_lines, nlines, go_nlines * sizeof (go_lineent_t));
+		mdb_free(go_lines, go_lines_alloc * sizeof (go_lineent_t));
+		go_lines = nlines;
+		go_lines_alloc = nsz;
+	}
+
+	le = &go_lines[go_nlines++];
+	le->le_file = file;
+	le->le_line = line;
+	le->le_start = start;
+	le->le_end = end;
 }
 
-static int
-dcmd_goframe(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+/*
+ * Record the runs of function f, walking its pcfile and pcln tables in
+ * step: each run ends where the next change in either table is.
+ */
+static void
+go_lines_func(go_linebuild_t *lb, go_func_t *f)
 {
-	uintptr_t p;
-	char *opt_p = NULL;
+	go_pcreader_t fpr, lpr;
+	uintptr_t fpc, lpc, start, end, base = go_findtab.ft_minpc;
+	int32_t fval = -1, lval = -1;
+	int64_t file;
+	int frv, lrv;
 
-	if (mdb_getopts(argc, argv,
-	    'p', MDB_OPT_STR, &opt_p, NULL) != argc)
-		return (DCMD_USAGE);
+	if (f->pcfile == 0 || f->pcln == 0)
+		return;
 
-	if (!(flags & DCMD_ADDRSPEC)) {
-		if (load_current_context(NULL, NULL, &addr) != 0)
-			return (DCMD_ERR);
-	}
+	go_pcreader_init(&fpr, pclntab + f->pcfile);
+	go_pcreader_init(&lpr, pclntab + f->pcln);
+	fpc = lpc = start = f->entry;
+	frv = step(&fpr, &fpc, &fval, 1);
+	lrv = step(&lpr, &lpc, &lval, 1);
 
-	if (mdb_vread(&p, sizeof (p), addr) == -1) {
-		mdb_warn("Could not load function from function table\n");
-		return (DCMD_ERR);
-	}
+	while (frv == 1 && lrv == 1) {
+		end = fpc < lpc ? fpc : lpc;
 
-	do_goframe(p, addr, opt_p);
+		if (fval >= 0 && lval >= 0 && start >= base &&
+		    (file = go_linebuild_file(lb, f, fval)) != -1) {
+			go_lines_add((uint32_t)file, lval,
+			    (uint32_t)(start - base), (uint32_t)(end - base));
+		}
 
-	return (DCMD_OK);
+		start = end;
+		if (fpc == end)
+			frv = step(&fpr, &fpc, &fval, 0);
+		if (lpc == end)
+			lrv = step(&lpr, &lpc, &lval, 0);
+	}
 }
 
 static int
-walk_goframes_init(mdb_walk_state_t *wsp)
+go_lineent_cmp(const void *l, const void *r)
 {
-	if (wsp->walk_addr != NULL)
-		return (WALK_NEXT);
-
-	if (load_current_context(NULL, NULL, &wsp->walk_addr) != 0)
-		return (WALK_ERR);
-
-	return (WALK_NEXT);
+	const go_lineent_t *ll = l;
+	const go_lineent_t *rl = r;
+
+	if (ll->le_file != rl->le_file)
+		return (ll->le_file < rl->le_file ? -1 : 1);
+	if (ll->le_line != rl->le_line)
+		return (ll->le_line < rl->le_line ? -1 : 1);
+	if (ll->le_start != rl->le_start)
+		return (ll->le_start < rl->le_start ? -1 : 1);
+	return (0);
 }
 
 static int
-walk_goframes_step(mdb_walk_state_t *wsp)
+go_lines_load(void)
 {
-	uintptr_t addr, offset, p;
+	const go_functbl_t *ftbl;
+	go_linebuild_t lb;
+	go_lineent_t *le;
+	size_t i, n;
 	go_func_t f;
-	int rv;
-	ssize_t len;
 
-	addr = wsp->walk_addr;
-	rv = wsp->walk_callback(wsp->walk_addr, NULL, wsp->walk_cbdata);
+	if (go_lines_loaded)
+		return (0);
 
-	if (rv != WALK_NEXT)
-		return (rv);
+	if ((ftbl = go_ftab_load()) == NULL)
+		return (-1);
 
-	len = mdb_vread(&p, sizeof (p), addr);
-	offset = findfunc(p);
-	if (offset == NULL) {
-		return (DCMD_ERR);
+	bzero(&lb, sizeof (lb));
+	lb.lb_nkeys = 1024;
+	lb.lb_keymap = mdb_zalloc(lb.lb_nkeys * sizeof (uint32_t), UM_SLEEP);
+	go_lines_filesalloc = 256;
+	go_lines_files = mdb_alloc(go_lines_filesalloc *
+	    sizeof (const char *), UM_SLEEP);
+	go_linebuild_rehash(&lb, go_lines_filesalloc * 2);
+	go_lines_alloc = go_findtab.ft_nfunc * 4 + 1;
+	go_lines = mdb_alloc(go_lines_alloc * sizeof (go_lineent_t), UM_SLEEP);
+
+	for (i = 0; i < go_findtab.ft_nfunc; i++) {
+		if (go_func_read(ftbl[i].offset, &f) == 0)
+			go_lines_func(&lb, &f);
 	}
 
-	len = mdb_vread(&f, sizeof (go_func_t), GO_PCLNTAB_OFFSET(offset));
-	if (len == -1) {
-		mdb_warn("Could not load function from function table\n");
-		return (DCMD_ERR);
+	mdb_free(lb.lb_keymap, lb.lb_nkeys * sizeof (uint32_t));
+	mdb_free(lb.lb_hash, lb.lb_hashsz * sizeof (uint32_t));
+
+	qsort(go_lines, go_nlines, sizeof (go_lineent_t), go_lineent_cmp);
+
+	for (n = 0, i = 0; i < go_nlines; i++) {
+		le = n == 0 ? NULL : &go_lines[n - 1];
+		if (le != NULL && le->le_file == go_lines[i].le_file &&
+		    le->le_line == go_lines[i].le_line &&
+		    le->le_end >= go_lines[i].le_start) {
+			if (go_lines[i].le_end > le->le_end)
+				le->le_end = go_lines[i].le_end;
+			continue;
+		}
+		go_lines[n++] = go_lines[i];
 	}
+	go_nlines = n;
+	go_lines_loaded = B_TRUE;
 
-	/* Skip over current frame */
-	addr += f.frame;
+	return (0);
+}
 
-	if (addr == NULL)
-		return (WALK_DONE);
+/*
+ * Does the file name match what was asked for: the whole name, or its last
+ * components?
+ */
+static boolean_t
+go_lines_filematch(const char *name, const char *want, size_t wlen)
+{
+	size_t nlen = strlen(name);
 
-	wsp->walk_addr = addr;
-	return (WALK_NEXT);
+	if (wlen > nlen || strncmp(name + nlen - wlen, want, wlen) != 0)
+		return (B_FALSE);
+
+	return (wlen == nlen || name[nlen - wlen - 1] == '/' ||
+	    want[0] == '/');
 }
 
 static int
-dcmd_gostack(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+dcmd_golines(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	uintptr_t insptr, stkptr;
-	char *opt_p = NULL;
+	const char *file, *colon;
+	char *end;
+	const go_functbl_t *ftbl;
+	const char *name;
+	uint64_t line;
+	uintptr_t base, start, off;
+	size_t i, lo, hi, mid, flen, nmatch = 0;
+	ssize_t idx;
+	boolean_t header = B_FALSE;
+	go_func_t f;
+	uint32_t fi;
 
-	if (mdb_getopts(argc, argv,
-	    'p', MDB_OPT_STR, &opt_p,
-	    NULL) != argc)
+	if ((flags & DCMD_ADDRSPEC) || argc != 1 ||
+	    argv[0].a_type != MDB_TYPE_STRING)
 		return (DCMD_USAGE);
 
-	load_current_context(&addr, &insptr, &stkptr);
+	file = argv[0].a_un.a_str;
+	if ((colon = strrchr(file, ':')) == NULL || colon == file ||
+	    colon[1] == '\0')
+		return (DCMD_USAGE);
 
-	do_goframe(insptr, stkptr, opt_p);
+	/* line numbers are decimal, whatever the radix */
+	flen = colon - file;
+	line = strtoull(colon + 1, &end, 10);
+	if (*end != '\0')
+		return (DCMD_USAGE);
 
-	if (mdb_pwalk_dcmd("goframe", "goframe", argc, argv, stkptr) == -1)
+	if (go_lines_load() != 0)
 		return (DCMD_ERR);
 
-	return (DCMD_OK);
-}
+	ftbl = go_findtab.ft_ftab;
+	base = go_findtab.ft_minpc;
 
-static const char *
-mdb_go_g_status(int16_t status)
-{
-	return (status == GS_Gidle ? "Gidle" :
-	    status == GS_Grunnable ? "Grunnable" :
-	    status == GS_Grunning ? "Grunning" :
-	    status == GS_Gsyscall ? "Gsyscall" :
-	    status == GS_Gwaiting ? "Gwaiting" :
-	    status == GS_Gmoribund_unused ? "Gmoribund_unused" :
-	    status == GS_Gdead ? "Gdead" :
-	    "<UNKNOWN>");
-}
+	for (fi = 0; fi < go_lines_nfiles; fi++) {
+		if (!go_lines_filematch(go_lines_files[fi], file, flen))
+			continue;
 
-static const char *
-mdb_go_p_status(int16_t status)
-{
-	return (status == PS_Pidle ? "Pidle" :
-	    status == PS_Prunning ? "Prunning" :
-	    status == PS_Psyscall ? "Psyscall" :
-	    status == PS_Pgcstop ? "Pgcstop" :
-	    status == PS_Pdead ? "Pdead" :
-	    "<UNKNOWN>");
-}
+		nmatch++;
+		for (lo = 0, hi = go_nlines; lo < hi; ) {
+			mid = lo + (hi - lo) / 2;
+			if (go_lines[mid].le_file < fi ||
+			    (go_lines[mid].le_file == fi &&
+			    go_lines[mid].le_line < (int64_t)line))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
 
-static int
-dcmd_go_p(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
-{
-	P p;
+		for (i = lo; i < go_nlines && go_lines[i].le_file == fi &&
+		    go_lines[i].le_line == (int64_t)line; i++) {
+			start = base + go_lines[i].le_start;
+
+			if (flags & DCMD_PIPE_OUT) {
+				mdb_printf("%p\n", start);
+				continue;
+			}
+
+			if (!header) {
+				mdb_printf("%<u>%-?s %-?s %s%</u>\n", "START",
+				    "END", "FUNCTION AND SOURCE");
+				header = B_TRUE;
+			}
+
+			name = NULL;
+			if ((idx = go_findtab_lookup(&go_findtab, start)) != -1 &&
+			    go_func_read(ftbl[idx].offset, &f) == 0)
+				name = go_funcname(&f);
+			off = name != NULL ? start - f.entry : 0;
+
+			mdb_printf("%0?p %0?p %s+0x%lx %s:%d\n", start,
+			    base + go_lines[i].le_end, name != NULL ? name : "?",
+			    (ulong_t)off, go_lines_files[fi],
+			    go_lines[i].le_line);
+		}
+	}
 
-	if (mdb_vread(&p, sizeof (p), addr) == -1) {
-		mdb_warn("failed to read P from %p", addr);
+	if (nmatch == 0) {
+		mdb_warn("no file matches %.*s\n", (int)flen, file);
 		return (DCMD_ERR);
 	}
 
-	mdb_printf("%p: goproc %d [%s]\n", addr, p.id,
-	    mdb_go_p_status(p.status));
-	mdb_printf("    runqsz %d\n", p.runqsize);
-	mdb_printf("    m %p\n", p.m);
-
 	return (DCMD_OK);
 }
 
-static int
-dcmd_go_g(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+static void
+dcmd_golines_help(void)
 {
-	G g;
+	mdb_printf(
+	    "Print the ranges of PCs whose code came from the given line of\n"
+	    "the given file.  The file may be a whole path or its last\n"
+	    "components, such as net/http/server.go or server.go; every file\n"
+	    "that matches is searched.  Code inlined from the line into other\n"
+	    "functions is included.  The first query builds an index of the\n"
+	    "lines of all the functions in the binary.\n"
+	    "\n"
+	    "As the source of a pipe, print only the start of each range.\n");
+}
 
-	if (mdb_vread(&g, sizeof (g), addr) == -1) {
-		mdb_warn("failed to read G from %p", addr);
-		return (DCMD_ERR);
+/*
+ * ::go_heapstats walks every span of the heap once, and sums the in-use
+ * spans by size class.  Class 0 is the spans that each hold one large
+ * object; spans handed out by hand, mostly for goroutine stacks, are summed
+ * apart.  A slot is free if no object is allocated in it; the tail of a
+ * span too short to make another slot is waste.
+ */
+#define	GO_HEAP_NCLASS		128
+
+typedef struct go_heapclass {
+	uint64_t hc_spans;
+	uint64_t hc_objects;
+	uint64_t hc_slots;
+	uint64_t hc_bytes;		/* of the spans */
+	uint64_t hc_inuse;		/* of the objects */
+	uint64_t hc_free;
+	uint64_t hc_waste;
+	uintptr_t hc_elemsize;
+} go_heapclass_t;
+
+typedef struct go_heapstats {
+	go_heapclass_t hs_class[GO_HEAP_NCLASS];
+	go_heapclass_t hs_manual;
+	uint64_t hs_dead;
+} go_heapstats_t;
+
+/*ARGSUSED*/
+static int
+go_heapstats_span(uintptr_t addr, const void *rec, void *arg)
+{
+	const go_srec_t *sr = rec;
+	go_heapstats_t *hs = arg;
+	go_heapclass_t *hc;
+	uint64_t bytes = (uint64_t)sr->sr_npages * GO_PAGE_BYTES;
+	uint64_t used = (uint64_t)sr->sr_nelems * sr->sr_elemsize;
+
+	switch (sr->sr_state) {
+	case GO_MSPAN_INUSE:
+		hc = &hs->hs_class[sr->sr_sizeclass % GO_HEAP_NCLASS];
+		break;
+	case GO_MSPAN_MANUAL:
+		hs->hs_manual.hc_spans++;
+		hs->hs_manual.hc_bytes += bytes;
+		return (WALK_NEXT);
+	default:
+		hs->hs_dead++;
+		return (WALK_NEXT);
 	}
 
-	mdb_printf("%p: goroutine %d [%s]\n", addr, g.goid,
-	    mdb_go_g_status(g.status));
-	mdb_printf("      flags: %s %s %s\n", g.ispanic ? "panic" : "!panic",
-	    g.issystem ? "system" : "!system",
-	    g.isbackground ? "background" : "!background");
-	mdb_printf("      create_pc %p (%a)\n", g.gopc, g.gopc);
-
-	if (g.status == GS_Gsyscall) {
-		mdb_printf("     stackbase: %p\n", g.syscallstack);
-		mdb_printf("            sp: %p\n", g.syscallsp);
-		mdb_printf("            pc: %p (%a)\n",
-		    g.syscallpc, g.syscallpc);
-		mdb_printf("    stackguard: %p\n", g.syscallguard);
-	} else {
-		mdb_printf("     stackbase: %p\n", g.stackbase);
-		mdb_printf("            sp: %p\n", g.sched.sp);
-		mdb_printf("            pc: %p (%a)\n", g.sched.pc, g.sched.pc);
-		mdb_printf("    stackguard: %p\n", g.stackguard);
-	}
+	hc->hc_spans++;
+	hc->hc_objects += sr->sr_alloccount;
+	hc->hc_slots += sr->sr_nelems;
+	hc->hc_bytes += bytes;
+	hc->hc_inuse += (uint64_t)sr->sr_alloccount * sr->sr_elemsize;
+	if (sr->sr_nelems > sr->sr_alloccount)
+		hc->hc_free += (uint64_t)(sr->sr_nelems - sr->sr_alloccount) *
+		    sr->sr_elemsize;
+	if (bytes > used)
+		hc->hc_waste += bytes - used;
+	if (sr->sr_elemsize > hc->hc_elemsize)
+		hc->hc_elemsize = sr->sr_elemsize;
 
-	return (DCMD_OK);
+	return (WALK_NEXT);
 }
 
-static int
-dcmd_go_m(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+static void
+go_heapstats_add(go_heapclass_t *sum, const go_heapclass_t *hc)
 {
-	M m;
-
-	if (mdb_vread(&m, sizeof (m), addr) == -1) {
-		mdb_warn("failed to read M from %p", addr);
-		return (DCMD_ERR);
-	}
+	sum->hc_spans += hc->hc_spans;
+	sum->hc_objects += hc->hc_objects;
+	sum->hc_slots += hc->hc_slots;
+	sum->hc_bytes += hc->hc_bytes;
+	sum->hc_inuse += hc->hc_inuse;
+	sum->hc_free += hc->hc_free;
+	sum->hc_waste += hc->hc_waste;
+}
 
-	mdb_printf("%p: gomach %d\n", addr, m.id);
-	mdb_printf("    p %p nextp %p\n", m.p, m.nextp);
-	mdb_printf("    curg %p\n", m.curg);
-	mdb_printf("    gsignal %p caughtsig %p\n", m.gsignal, m.caughtsig);
-	mdb_printf("    libcall %p (fn %a, n %d)\n", addr +
-	    (uintptr_t)&m.libcall - (uintptr_t)&m, m.libcall.fn, m.libcall.n);
+static void
+go_heapstats_row(const char *class, const char *size, const go_heapclass_t *hc)
+{
+	uint64_t frag = hc->hc_bytes == 0 ? 0 :
+	    (hc->hc_free + hc->hc_waste) * 100 / hc->hc_bytes;
 
-	return (DCMD_OK);
+	mdb_printf("%6s %8s %8llu %10llu %12llu %12llu %12llu %12llu %4llu%%\n",
+	    class, size, hc->hc_spans, hc->hc_objects, hc->hc_bytes,
+	    hc->hc_inuse, hc->hc_free, hc->hc_waste, frag);
 }
 
+/*ARGSUSED*/
 static int
-walk_go_g_init(mdb_walk_state_t *wsp)
+dcmd_go_heapstats(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
 {
-	GElf_Sym sym;
-	uintptr_t allg;
+	go_heapstats_t *hs;
+	go_heapclass_t total;
+	char class[16], size[16];
+	boolean_t all = B_FALSE;
+	int i, rv = DCMD_OK;
+
+	if ((flags & DCMD_ADDRSPEC) || mdb_getopts(argc, argv,
+	    'a', MDB_OPT_SETBITS, B_TRUE, &all, NULL) != argc)
+		return (DCMD_USAGE);
 
-	if (wsp->walk_addr != NULL)
-		return (WALK_NEXT);
+	hs = mdb_zalloc(sizeof (go_heapstats_t), UM_SLEEP);
 
-	if (mdb_lookup_by_name("runtime.allg", &sym) != 0) {
-		mdb_warn("could not find runtime.allg");
-		return (WALK_ERR);
+	if (mdb_walk("go_span", go_heapstats_span, hs) == -1) {
+		mdb_warn("failed to walk spans");
+		rv = DCMD_ERR;
+		goto out;
 	}
 
-	if (mdb_vread(&allg, sizeof (allg), sym.st_value) == -1) {
-		mdb_warn("could not load runtime.allg");
-		return (WALK_ERR);
+	mdb_printf("%6s %8s %8s %10s %12s %12s %12s %12s %5s\n", "CLASS",
+	    "SIZE", "SPANS", "OBJECTS", "SPANBYTES", "INUSE", "FREE", "WASTE",
+	    "FRAG");
+
+	bzero(&total, sizeof (total));
+	for (i = 0; i < GO_HEAP_NCLASS; i++) {
+		go_heapclass_t *hc = &hs->hs_class[i];
+
+		if (hc->hc_spans == 0 && !all)
+			continue;
+
+		go_heapstats_add(&total, hc);
+		if (i == 0) {
+			(void) strcpy(class, "large");
+			(void) strcpy(size, "-");
+		} else {
+			(void) mdb_snprintf(class, sizeof (class), "%d", i);
+			(void) mdb_snprintf(size, sizeof (size), "%lu",
+			    (ulong_t)hc->hc_elemsize);
+		}
+		go_heapstats_row(class, size, hc);
 	}
 
-	wsp->walk_addr = allg;
+	go_heapstats_row("total", "-", &total);
+	if (hs->hs_manual.hc_spans != 0)
+		go_heapstats_row("manual", "-", &hs->hs_manual);
+	if (hs->hs_dead != 0)
+		mdb_printf("(%llu spans free)\n", hs->hs_dead);
 
-	return (WALK_NEXT);
+out:
+	mdb_free(hs, sizeof (go_heapstats_t));
+	return (rv);
 }
 
-static int
-walk_go_g_step(mdb_walk_state_t *wsp)
+static void
+dcmd_go_heapstats_help(void)
 {
-	uintptr_t addr;
-	int rv;
-	G g;
-
-	addr = wsp->walk_addr;
-	rv = wsp->walk_callback(wsp->walk_addr, NULL, wsp->walk_cbdata);
+	mdb_printf(
+	    "Sum the heap's in-use spans by size class, and print for each\n"
+	    "class the spans, the objects allocated in them, the bytes of the\n"
+	    "spans and of the objects, the bytes of unallocated slots (FREE),\n"
+	    "the bytes left over at the end of each span (WASTE), and how\n"
+	    "much of the spans' bytes that is (FRAG).  Class \"large\" is the\n"
+	    "spans of objects too large for a class; \"manual\" is spans\n"
+	    "given to goroutine stacks and the like, which are not in the\n"
+	    "total.\n"
+	    "Needs Go 1.11 or later and the binary's DWARF.\n\n"
+	    "  -a  print empty classes too\n");
+}
 
-	if (rv != WALK_NEXT)
-		return (rv);
+/*
+ * ::go_whatis resolves addresses to the heap objects holding them, through
+ * the index from page to span built the first time it's run.  Given a pipe,
+ * it takes all of it at once.
+ */
+static void
+go_whatis_one(uintptr_t addr, boolean_t pipeout, boolean_t allocated)
+{
+	const go_hspan_t *hs;
+	const go_srec_t *sr;
+	go_hobj_t ho;
+	char class[16];
+
+	if (go_heap_object(addr, &ho) == 0) {
+		if (allocated && !ho.ho_alloc)
+			return;
+
+		if (pipeout) {
+			mdb_printf("%lr\n", ho.ho_base);
+			return;
+		}
 
-	/*
-	 * Load this G to get the next G
-	 */
-	if (mdb_vread(&g, sizeof (g), addr) == -1) {
-		mdb_warn("could not read next P pointer");
-		return (WALK_ERR);
+		sr = &ho.ho_span->hs_rec;
+		if (sr->sr_sizeclass == 0)
+			(void) strcpy(class, "large");
+		else
+			(void) mdb_snprintf(class, sizeof (class), "class %d",
+			    sr->sr_sizeclass);
+
+		mdb_printf("%p is %p+0x%lx, %s %lu-byte object (%s%s) "
+		    "in span %p\n", addr, ho.ho_base,
+		    (ulong_t)(addr - ho.ho_base),
+		    ho.ho_alloc ? "allocated" : "free", (ulong_t)ho.ho_size,
+		    class, sr->sr_noscan ? ", noscan" : "",
+		    ho.ho_span->hs_addr);
+		return;
 	}
 
-	if (g.alllink == NULL)
-		return (WALK_DONE);
-	wsp->walk_addr = (uintptr_t) g.alllink;
+	if (allocated || pipeout)
+		return;
 
-	return (WALK_NEXT);
+	if ((hs = ho.ho_span) == NULL)
+		mdb_printf("%p is not in the Go heap\n", addr);
+	else if (hs->hs_rec.sr_state == GO_MSPAN_MANUAL)
+		mdb_printf("%p is in span %p, of stacks\n", addr, hs->hs_addr);
+	else
+		mdb_printf("%p is in span %p, past its last object\n", addr,
+		    hs->hs_addr);
 }
 
 static int
-walk_go_m_init(mdb_walk_state_t *wsp)
+dcmd_go_whatis(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 {
-	GElf_Sym sym;
-	uintptr_t allm;
+	uint_t opt_a = B_FALSE;
+	mdb_pipe_t p;
+	size_t i, n;
 
-	if (wsp->walk_addr != NULL)
-		return (WALK_NEXT);
+	if (mdb_getopts(argc, argv,
+	    'a', MDB_OPT_SETBITS, B_TRUE, &opt_a, NULL) != argc)
+		return (DCMD_USAGE);
 
-	if (mdb_lookup_by_name("runtime.allm", &sym) != 0) {
-		mdb_warn("could not find runtime.allm");
-		return (WALK_ERR);
+	if (flags & DCMD_PIPE) {
+		mdb_get_pipe(&p);
+		n = p.pipe_len;
+	} else if (flags & DCMD_ADDRSPEC) {
+		p.pipe_data = &addr;
+		n = 1;
+	} else {
+		return (DCMD_USAGE);
 	}
 
-	if (mdb_vread(&allm, sizeof (allm), sym.st_value) == -1) {
-		mdb_warn("could not load runtime.allm");
-		return (WALK_ERR);
+	if (go_heap_check() != 0)
+		return (DCMD_ERR);
+
+	if (go_heap_load() != 0) {
+		mdb_warn("failed to index the heap's spans\n");
+		return (DCMD_ERR);
 	}
 
-	wsp->walk_addr = allm;
+	for (i = 0; i < n; i++)
+		go_whatis_one(p.pipe_data[i], (flags & DCMD_PIPE_OUT) != 0,
+		    opt_a);
 
-	return (WALK_NEXT);
+	return (DCMD_OK);
 }
 
-static int
-walk_go_m_step(mdb_walk_state_t *wsp)
+static void
+dcmd_go_whatis_help(void)
 {
-	uintptr_t addr;
-	int rv;
-	M m;
-
-	addr = wsp->walk_addr;
-	rv = wsp->walk_callback(wsp->walk_addr, NULL, wsp->walk_cbdata);
-
-	if (rv != WALK_NEXT)
-		return (rv);
-
-	/*
-	 * Load this M to get the next M
-	 */
-	if (mdb_vread(&m, sizeof (m), addr) == -1) {
-		mdb_warn("could not read next M pointer");
-		return (WALK_ERR);
-	}
+	mdb_printf(
+	    "Print the heap object that holds each address: its base, size,\n"
+	    "size class and span, and whether it is allocated.  The first\n"
+	    "use indexes the heap's spans by page, after which each address\n"
+	    "is resolved without a search.  As the source of a pipe, print\n"
+	    "only the base of each object.\n"
+	    "Needs Go 1.11 or later and the binary's DWARF.\n\n"
+	    "  -a  only allocated objects\n");
+}
 
-	if (m.alllink == NULL)
-		return (WALK_DONE);
-	wsp->walk_addr = (uintptr_t) m.alllink;
+/*
+ * ::go_retainers answers "what keeps all this memory alive?" from the
+ * dominator tree of the heap's reference graph: the objects that retain
+ * the most, and the bytes retained by each span class.
+ */
+#define	GO_RETAINERS_DEFAULT	20
 
-	return (WALK_NEXT);
+static void
+go_retainers_class(char *buf, size_t len, uint8_t sizeclass, uint8_t noscan)
+{
+	if (sizeclass == 0)
+		(void) mdb_snprintf(buf, len, "large%s", noscan ? "/np" : "");
+	else
+		(void) mdb_snprintf(buf, len, "%d%s", sizeclass,
+		    noscan ? "/np" : "");
 }
 
 static int
-walk_go_p_init(mdb_walk_state_t *wsp)
+go_retclass_cmp(const void *l, const void *r)
 {
-	GElf_Sym sym;
-	uintptr_t allp;
+	const go_retclass_t *lc = *(const go_retclass_t **)l;
+	const go_retclass_t *rc = *(const go_retclass_t **)r;
 
-	if (wsp->walk_addr != NULL)
-		return (WALK_NEXT);
+	if (lc->rc_retained != rc->rc_retained)
+		return (lc->rc_retained > rc->rc_retained ? -1 : 1);
+	return (0);
+}
 
-	if (mdb_lookup_by_name("runtime.allp", &sym) != 0) {
-		mdb_warn("could not find runtime.allp");
-		return (WALK_ERR);
+static void
+go_retainers_classes(size_t max)
+{
+	const go_retclass_t *classes = go_graph_classes();
+	const go_retclass_t *sorted[GO_NSPANCLASS];
+	char class[16], size[16];
+	size_t i, n = 0;
+
+	for (i = 0; i < GO_NSPANCLASS; i++) {
+		if (classes[i].rc_objects != 0)
+			sorted[n++] = &classes[i];
 	}
-
-	if (mdb_vread(&allp, sizeof (allp), sym.st_value) == -1) {
-		mdb_warn("could not load runtime.allp");
-		return (WALK_ERR);
+	qsort(sorted, n, sizeof (sorted[0]), go_retclass_cmp);
+
+	mdb_printf("\n%-9s %8s %10s %12s %14s\n", "CLASS", "SIZE", "OBJECTS",
+	    "BYTES", "RETAINED");
+	for (i = 0; i < n && (max == 0 || i < max); i++) {
+		go_retainers_class(class, sizeof (class),
+		    (uint8_t)((sorted[i] - classes) >> 1),
+		    (uint8_t)((sorted[i] - classes) & 1));
+		if ((sorted[i] - classes) >> 1 == 0)
+			(void) strcpy(size, "-");
+		else
+			(void) mdb_snprintf(size, sizeof (size), "%lu",
+			    (ulong_t)sorted[i]->rc_elemsize);
+		mdb_printf("%-9s %8s %10llu %12llu %14llu\n", class, size,
+		    sorted[i]->rc_objects, sorted[i]->rc_bytes,
+		    sorted[i]->rc_retained);
 	}
-
-	wsp->walk_addr = allp;
-
-	return (WALK_NEXT);
 }
 
+/*ARGSUSED*/
 static int
-walk_go_p_step(mdb_walk_state_t *wsp)
+dcmd_go_retainers(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
 {
-	uintptr_t addr;
-	int rv;
-	P p;
+	go_graphstats_t gs;
+	go_retainer_t *rt;
+	const go_groot_t *gr;
+	char class[16];
+	uintptr_t top = GO_RETAINERS_DEFAULT, nthreads = 0;
+	boolean_t opt_c = B_FALSE;
+	ssize_t i, n;
 
-	addr = wsp->walk_addr;
-	rv = wsp->walk_callback(wsp->walk_addr, NULL, wsp->walk_cbdata);
+	if (mdb_getopts(argc, argv,
+	    'c', MDB_OPT_SETBITS, B_TRUE, &opt_c,
+	    'n', MDB_OPT_UINTPTR, &top,
+	    't', MDB_OPT_UINTPTR, &nthreads, NULL) != argc)
+		return (DCMD_USAGE);
 
-	if (rv != WALK_NEXT)
-		return (rv);
+	if (!(flags & DCMD_ADDRSPEC))
+		addr = 0;
+	else if (opt_c)
+		return (DCMD_USAGE);
 
-	/*
-	 * Load this P to get the next P
-	 */
-	if (mdb_vread(&p, sizeof (p), addr) == -1) {
-		mdb_warn("could not read next P pointer");
-		return (WALK_ERR);
+	if (go_heap_check() != 0)
+		return (DCMD_ERR);
+
+	if (go_graph_load((uint_t)nthreads) != 0) {
+		mdb_warn("failed to graph the heap\n");
+		return (DCMD_ERR);
 	}
 
-	if (p.link == NULL)
-		return (WALK_DONE);
-	wsp->walk_addr = (uintptr_t) p.link;
+	go_graph_stats(&gs);
+	if (addr == 0) {
+		mdb_printf("%llu objects, %llu reachable (%llu bytes) through "
+		    "%llu references from %llu roots\n", gs.gs_objects,
+		    gs.gs_reachable, gs.gs_bytes, gs.gs_edges, gs.gs_roots);
+		if (gs.gs_badreads != 0)
+			mdb_printf("(%llu reads of the heap failed)\n",
+			    gs.gs_badreads);
+	}
 
-	return (WALK_NEXT);
+	if (opt_c) {
+		go_retainers_classes(top);
+		return (DCMD_OK);
+	}
+
+	if ((n = go_graph_top(addr, &rt, top)) == -1) {
+		mdb_warn("%p is not in a reachable heap object\n", addr);
+		return (DCMD_ERR);
+	}
+
+	mdb_printf("\n%14s %10s %-16s %8s %-9s %s\n", "RETAINED", "OBJECTS",
+	    "OBJECT", "SIZE", "CLASS", "HELD BY");
+	for (i = 0; i < n; i++) {
+		go_retainers_class(class, sizeof (class), rt[i].rt_sizeclass,
+		    rt[i].rt_noscan);
+		mdb_printf("%14llu %10llu %-16p %8lu %-9s ", rt[i].rt_retained,
+		    rt[i].rt_objects, rt[i].rt_addr, (ulong_t)rt[i].rt_size,
+		    class);
+
+		if ((gr = rt[i].rt_root) == NULL && rt[i].rt_holder == 0)
+			mdb_printf("(several)\n");
+		else if (gr == NULL)
+			mdb_printf("%p\n", rt[i].rt_holder);
+		else if (gr->gr_kind == GO_ROOT_STACK)
+			mdb_printf("stack of goroutine %lld\n", gr->gr_goid);
+		else if (gr->gr_kind == GO_ROOT_DATA)
+			mdb_printf("%a\n", gr->gr_addr);
+		else
+			mdb_printf("finalizer of %p\n", gr->gr_addr);
+	}
+
+	if (addr == 0)
+		go_retainers_classes(top);
+
+	if (rt != NULL)
+		mdb_free(rt, n * sizeof (go_retainer_t));
+	return (DCMD_OK);
+}
+
+static void
+dcmd_go_retainers_help(void)
+{
+	mdb_printf(
+	    "Build the reference graph of the heap and its dominator tree,\n"
+	    "and print the objects that keep the most memory alive: those\n"
+	    "held directly by the roots (goroutine stacks, data and bss, and\n"
+	    "finalizers), or, given the address of an object, those it alone\n"
+	    "holds.  RETAINED is the bytes that would be freed if the object\n"
+	    "were.  HELD BY is the object that dominates it, or one of the\n"
+	    "roots that refer to it, or \"(several)\" if no one root or\n"
+	    "object holds it.  Then print, for each span class, the objects\n"
+	    "reachable and the bytes retained by those not held by another\n"
+	    "of their class; \"/np\" marks classes whose objects have no\n"
+	    "pointers.\n"
+	    "\n"
+	    "References are found by taking every word of an object that\n"
+	    "points into an allocated object as a pointer, so retained sizes\n"
+	    "are upper bounds.  The graph is built once; ::go_cache -c\n"
+	    "discards it.  Needs Go 1.11 or later and the binary's DWARF.\n\n"
+	    "  -c          print only the span classes\n"
+	    "  -n count    print at most count of each (default 20;\n"
+	    "              0 for all)\n"
+	    "  -t threads  scan with this many threads (default one per CPU);\n"
+	    "              only mdb_go_host uses threads\n");
 }
 
 static int
@@ -670,7 +4875,7 @@ dcmd_go_sigtab(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 		return (DCMD_ERR);
 	}
 
-	if (mdb_vread(&sigtab, sizeof (sigtab), sym.st_value) == -1) {
+	if (go_vread(&sigtab, sizeof (sigtab), sym.st_value) == -1) {
 		mdb_warn("failed to read sigtab");
 		return (DCMD_ERR);
 	}
@@ -692,7 +4897,7 @@ dcmd_go_sigtab(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 		char buf[500];
 		ssize_t sz;
 
-		if ((sz = mdb_readstr(buf, 500, (uintptr_t)sigtab[i].name)) == -1) {
+		if ((sz = go_readstr(buf, 500, (uintptr_t)sigtab[i].name)) == -1) {
 			mdb_warn("could not read");
 			continue;
 		}
@@ -738,7 +4943,7 @@ dcmd_go_timers(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 		return (DCMD_ERR);
 	}
 
-	if (mdb_vread(&timers, sizeof (timers), sym.st_value) == -1) {
+	if (go_vread(&timers, sizeof (timers), sym.st_value) == -1) {
 		mdb_warn("failed to read Timers from %p", addr);
 		return (DCMD_ERR);
 	}
@@ -756,12 +4961,12 @@ dcmd_go_timers(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 		taddr = (uintptr_t)timers.t;
 		taddr += (sizeof (void*)) * i;
 
-		if (mdb_vread(&ttt, sizeof (uintptr_t), taddr) == -1) {
+		if (go_vread(&ttt, sizeof (uintptr_t), taddr) == -1) {
 			mdb_warn("could not");
 			continue;
 		}
 
-		if (mdb_vread(&timer, sizeof (timer), ttt) == -1) {
+		if (go_vread(&timer, sizeof (timer), ttt) == -1) {
 			mdb_warn("could not");
 			continue;
 		}
@@ -773,13 +4978,521 @@ dcmd_go_timers(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
 	return (DCMD_OK);
 }
 
+#ifdef	MDB_GO_HOST
+/*
+ * Compare the findfunc index against a plain binary search over synthetic
+ * function tables of increasing size.  The tables are shaped like real Go
+ * text: functions are 16-byte aligned and between 16 bytes and 1K long.
+ * This is a development aid, so it is only built into mdb_go_host.
+ */
+static uint64_t
+go_findbench_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return (*state = x);
+}
+
+static void
+go_findbench_one(size_t nfunc, size_t nops)
+{
+	go_functbl_t *ftbl;
+	go_findtab_t ft;
+	uintptr_t *pcs, pc;
+	uint64_t seed = 0x9e3779b97f4a7c15ULL;
+	uint64_t sum_bs = 0, sum_ix = 0;
+	hrtime_t start, t_bs, t_ix;
+	size_t i;
+
+	ftbl = mdb_alloc((nfunc + 1) * sizeof (go_functbl_t), UM_SLEEP);
+	pcs = mdb_alloc(nops * sizeof (uintptr_t), UM_SLEEP);
+
+	pc = 0x400000;
+	for (i = 0; i <= nfunc; i++) {
+		ftbl[i].entry = pc;
+		ftbl[i].offset = i;
+		pc += 16 * (1 + go_findbench_rand(&seed) % 64);
+	}
+
+	for (i = 0; i < nops; i++) {
+		pcs[i] = ftbl[0].entry + go_findbench_rand(&seed) %
+		    (ftbl[nfunc].entry - ftbl[0].entry);
+	}
+
+	(void) go_findtab_build(&ft, ftbl, nfunc);
+
+	start = mdb_gethrtime();
+	for (i = 0; i < nops; i++)
+		sum_bs += ftbl[go_ftab_bsearch(ftbl, 0, nfunc, pcs[i])].offset;
+	t_bs = mdb_gethrtime() - start;
+
+	start = mdb_gethrtime();
+	for (i = 0; i < nops; i++)
+		sum_ix += ftbl[go_findtab_lookup(&ft, pcs[i])].offset;
+	t_ix = mdb_gethrtime() - start;
+
+	mdb_printf("%8lu %9llu.%llu %9llu.%llu %10lu%s\n", nfunc,
+	    (u_longlong_t)(t_bs / nops), (u_longlong_t)(t_bs * 10 / nops % 10),
+	    (u_longlong_t)(t_ix / nops), (u_longlong_t)(t_ix * 10 / nops % 10),
+	    ft.ft_nbuckets * sizeof (go_findfuncbucket_t),
+	    sum_bs == sum_ix ? "" : "  (MISMATCH)");
+
+	go_findtab_destroy(&ft);
+	mdb_free(pcs, nops * sizeof (uintptr_t));
+	mdb_free(ftbl, (nfunc + 1) * sizeof (go_functbl_t));
+}
+
+/*ARGSUSED*/
+static int
+dcmd_go_findbench(uintptr_t addr, uint_t flags, int argc,
+    const mdb_arg_t *argv)
+{
+	uintptr_t nops = 1000000;
+
+	if (mdb_getopts(argc, argv,
+	    'n', MDB_OPT_UINTPTR, &nops, NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (nops == 0)
+		return (DCMD_USAGE);
+
+	mdb_printf("%8s %11s %11s %10s\n", "NFUNC", "BSEARCH", "INDEX",
+	    "INDEXSZ");
+	go_findbench_one(10000, nops);
+	go_findbench_one(100000, nops);
+	go_findbench_one(1000000, nops);
+	mdb_printf("(ns per lookup over %lu random PCs)\n", nops);
+
+	return (DCMD_OK);
+}
+#endif
+
+static int
+dcmd_go_cache(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	uint64_t pctab_max = go_pctab_max;
+	uint64_t vcache_max = go_vcache_limit();
+	uint64_t pgsz = go_vcache_pagesize();
+	uint64_t lookups;
+	uint_t opt_c = B_FALSE;
+
+	if (mdb_getopts(argc, argv,
+	    'c', MDB_OPT_SETBITS, B_TRUE, &opt_c,
+	    'P', MDB_OPT_UINT64, &pgsz,
+	    't', MDB_OPT_UINT64, &pctab_max,
+	    'v', MDB_OPT_UINT64, &vcache_max, NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (opt_c) {
+		go_pctab_flush();
+		go_str_flush();
+		go_unwind_flush();
+		go_inl_flush();
+		go_heap_flush();
+		go_vcache_flush();
+		go_vcache_zero();
+	}
+
+	if (pctab_max != go_pctab_max) {
+		go_pctab_max = (size_t)pctab_max;
+		go_pctab_evict(go_pctab_max);
+	}
+
+	if (go_vcache_set((size_t)pgsz, (size_t)vcache_max) != 0)
+		return (DCMD_ERR);
+
+	lookups = go_pctab_hits + go_pctab_misses;
+
+	mdb_printf("%-8s %8s %10s %10s %12s %12s %10s %4s\n", "CACHE",
+	    "ENTRIES", "BYTES", "LIMIT", "HITS", "MISSES", "EVICTED", "HIT%");
+	mdb_printf("%-8s %8lu %10lu %10lu %12llu %12llu %10llu %3llu%%\n",
+	    "pctab", go_pctab_count, go_pctab_bytes, go_pctab_max,
+	    go_pctab_hits, go_pctab_misses, go_pctab_evictions,
+	    lookups == 0 ? 0 : go_pctab_hits * 100 / lookups);
+
+	lookups = go_str_hits + go_str_misses;
+	mdb_printf("%-8s %8lu %10lu %10s %12llu %12llu %10s %3llu%%\n",
+	    "strings", go_str_count, go_strarena_bytes, "-",
+	    go_str_hits, go_str_misses, "-",
+	    lookups == 0 ? 0 : go_str_hits * 100 / lookups);
+
+	lookups = go_unwind_hits + go_unwind_misses;
+	mdb_printf("%-8s %8lu %10lu %10lu %12llu %12llu %10llu %3llu%%\n",
+	    "unwind", go_unwind_count, go_unwind_count *
+	    sizeof (go_unwind_ent_t), sizeof (go_unwind_cache),
+	    go_unwind_hits, go_unwind_misses, go_unwind_evictions,
+	    lookups == 0 ? 0 : go_unwind_hits * 100 / lookups);
+
+	lookups = go_inl_hits + go_inl_misses;
+	mdb_printf("%-8s %8lu %10lu %10s %12llu %12llu %10s %3llu%%\n",
+	    "inline", go_inl_count, go_inl_bytes, "-",
+	    go_inl_hits, go_inl_misses, "-",
+	    lookups == 0 ? 0 : go_inl_hits * 100 / lookups);
+
+	go_heap_report();
+	go_vcache_report();
+	go_elf_report();
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_go_cache_help(void)
+{
+	mdb_printf(
+	    "Report on the caches this module keeps of data read from the\n"
+	    "target.\n\n"
+	    "  -c        discard cached data and zero the counters\n"
+	    "  -P size   set the page size of the target memory cache\n"
+	    "  -t bytes  set the memory limit for decoded pc-value tables;\n"
+	    "            0 disables the cache\n"
+	    "  -v bytes  set the memory limit for the target memory cache;\n"
+	    "            0 disables the cache\n");
+}
+
+/*
+ * Build a sidecar index for the target: the function table and its lookup
+ * index as they are, then every function's pc-value tables, decoded, and
+ * the names of the functions and of the files their pcfile tables refer to.
+ */
+typedef struct go_ibuf {
+	char *ib_buf;
+	size_t ib_len;
+	size_t ib_alloc;
+} go_ibuf_t;
+
+static void
+go_ibuf_append(go_ibuf_t *ib, const void *data, size_t len)
+{
+	size_t nalloc;
+	char *nbuf;
+
+	if (ib->ib_len + len > ib->ib_alloc) {
+		for (nalloc = ib->ib_alloc == 0 ? 4096 : ib->ib_alloc;
+		    ib->ib_len + len > nalloc; nalloc *= 2)
+			continue;
+		nbuf = mdb_alloc(nalloc, UM_SLEEP);
+		if (ib->ib_buf != NULL) {
+			bcopy(ib->ib_buf, nbuf, ib->ib_len);
+			mdb_free(ib->ib_buf, ib->ib_alloc);
+		}
+		ib->ib_buf = nbuf;
+		ib->ib_alloc = nalloc;
+	}
+
+	bcopy(data, ib->ib_buf + ib->ib_len, len);
+	ib->ib_len += len;
+}
+
+static void
+go_ibuf_free(go_ibuf_t *ib)
+{
+	if (ib->ib_buf != NULL)
+		mdb_free(ib->ib_buf, ib->ib_alloc);
+	bzero(ib, sizeof (*ib));
+}
+
+static int
+go_idxpc_cmp(const void *l, const void *r)
+{
+	const go_idxpc_t *lp = l, *rp = r;
+
+	return (lp->ip_off < rp->ip_off ? -1 : lp->ip_off > rp->ip_off);
+}
+
+static int
+go_idxstr_cmp(const void *l, const void *r)
+{
+	const go_idxstr_t *ls = l, *rs = r;
+
+	return (ls->is_key < rs->is_key ? -1 : ls->is_key > rs->is_key);
+}
+
+static int
+go_index_build(void)
+{
+	go_ibuf_t pcs, pcdata, strs, names;
+	go_functbl_t *ftbl;
+	go_idxpc_t *ip, rec;
+	go_idxstr_t *is, srec;
+	go_pctab_t *pt;
+	go_func_t f;
+	const char *str;
+	const void *bufs[GO_INDEX_NSECTS];
+	size_t sizes[GO_INDEX_NSECTS];
+	size_t i, j, n, npcs, nstrs;
+	int rv = -1;
+
+	if ((ftbl = go_ftab_load()) == NULL)
+		return (-1);
+
+	bzero(&pcs, sizeof (pcs));
+	bzero(&pcdata, sizeof (pcdata));
+	bzero(&strs, sizeof (strs));
+	bzero(&names, sizeof (names));
+
+	/*
+	 * Collect the functions' names and tables.  Until the tables are
+	 * decoded, ip_data holds the index of a function using the table and
+	 * ip_n is 1 for a pcfile table.
+	 */
+	for (i = 0; i < ftabsize; i++) {
+		if (go_func_read(ftbl[i].offset, &f) != 0) {
+			mdb_warn("failed to read function %lu", i);
+			goto out;
+		}
+
+		srec.is_key = GO_STR_KEY(GO_STR_FUNC, f.nameoff);
+		srec.is_off = 0;
+		go_ibuf_append(&strs, &srec, sizeof (srec));
+
+		rec.ip_data = i;
+		for (j = 0; j < 3; j++) {
+			rec.ip_off = j == 0 ? f.pcsp : j == 1 ? f.pcfile : f.pcln;
+			rec.ip_n = j == 1;
+			if (rec.ip_off != 0)
+				go_ibuf_append(&pcs, &rec, sizeof (rec));
+		}
+	}
+
+	ip = (go_idxpc_t *)pcs.ib_buf;
+	n = pcs.ib_len / sizeof (go_idxpc_t);
+	qsort(ip, n, sizeof (go_idxpc_t), go_idxpc_cmp);
+
+	for (npcs = 0, i = 0; i < n; i++) {
+		if (npcs != 0 && ip[npcs - 1].ip_off == ip[i].ip_off) {
+			ip[npcs - 1].ip_n |= ip[i].ip_n;
+			continue;
+		}
+		ip[npcs++] = ip[i];
+	}
+
+	for (i = 0, n = npcs, npcs = 0; i < n; i++) {
+		boolean_t isfile = ip[i].ip_n != 0;
+
+		if (go_func_read(ftbl[ip[i].ip_data].offset, &f) != 0 ||
+		    (pt = go_pctab_decode(&f, ip[i].ip_off)) == NULL)
+			continue;
+
+		ip[npcs].ip_off = ip[i].ip_off;
+		ip[npcs].ip_n = pt->pt_n;
+		ip[npcs].ip_data = pcdata.ib_len;
+		npcs++;
+
+		go_ibuf_append(&pcdata, pt->pt_ends, pt->pt_n * sizeof (uint32_t));
+		go_ibuf_append(&pcdata, pt->pt_vals, pt->pt_n * sizeof (int32_t));
+
+		for (j = 0; isfile && j < pt->pt_n; j++) {
+			if (pt->pt_vals[j] < 0 ||
+			    (j > 0 && pt->pt_vals[j] == pt->pt_vals[j - 1]))
+				continue;
+			srec.is_key = GO_STR_KEY(GO_STR_FILE,
+			    f.cuoff + pt->pt_vals[j]);
+			go_ibuf_append(&strs, &srec, sizeof (srec));
+		}
+
+		mdb_free(pt, pt->pt_size);
+	}
+
+	is = (go_idxstr_t *)strs.ib_buf;
+	n = strs.ib_len / sizeof (go_idxstr_t);
+	qsort(is, n, sizeof (go_idxstr_t), go_idxstr_cmp);
+
+	for (nstrs = 0, i = 0; i < n; i++) {
+		if (nstrs != 0 && is[nstrs - 1].is_key == is[i].is_key)
+			continue;
+
+		if ((str = go_str_intern((go_strkind_t)(is[i].is_key >> 32),
+		    (uint32_t)is[i].is_key)) == NULL)
+			continue;
+
+		is[nstrs].is_key = is[i].is_key;
+		is[nstrs].is_off = names.ib_len;
+		nstrs++;
+		go_ibuf_append(&names, str, strlen(str) + 1);
+	}
+
+	bufs[GO_INDEX_FTAB] = ftbl;
+	sizes[GO_INDEX_FTAB] = go_ftab_bytes;
+	bufs[GO_INDEX_BUCKETS] = go_findtab.ft_buckets;
+	sizes[GO_INDEX_BUCKETS] =
+	    go_findtab.ft_nbuckets * sizeof (go_findfuncbucket_t);
+	bufs[GO_INDEX_STRIDX] = is;
+	sizes[GO_INDEX_STRIDX] = nstrs * sizeof (go_idxstr_t);
+	bufs[GO_INDEX_STRS] = names.ib_buf;
+	sizes[GO_INDEX_STRS] = names.ib_len;
+	bufs[GO_INDEX_PCIDX] = ip;
+	sizes[GO_INDEX_PCIDX] = npcs * sizeof (go_idxpc_t);
+	bufs[GO_INDEX_PCDATA] = pcdata.ib_buf;
+	sizes[GO_INDEX_PCDATA] = pcdata.ib_len;
+
+	/*
+	 * Writing the index maps it in place of the old one, which our
+	 * function table may point into.
+	 */
+	rv = go_index_write(bufs, sizes);
+	go_ftab_reset();
+
+	if (rv == 0) {
+		mdb_printf("indexed %lu functions, %lu pc-value tables and "
+		    "%lu names\n", ftabsize, npcs, nstrs);
+	}
+
+out:
+	go_ibuf_free(&pcs);
+	go_ibuf_free(&pcdata);
+	go_ibuf_free(&strs);
+	go_ibuf_free(&names);
+
+	return (rv);
+}
+
+static int
+dcmd_go_index(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	const char *opt_d = NULL;
+	uint_t opt_u = B_FALSE, opt_w = B_FALSE;
+
+	if (mdb_getopts(argc, argv,
+	    'd', MDB_OPT_STR, &opt_d,
+	    'u', MDB_OPT_SETBITS, B_TRUE, &opt_u,
+	    'w', MDB_OPT_SETBITS, B_TRUE, &opt_w, NULL) != argc)
+		return (DCMD_USAGE);
+
+	if (ftabsize == 0) {
+		mdb_warn("no Go pclntab in this target\n");
+		return (DCMD_ERR);
+	}
+
+	if (opt_d != NULL || opt_u) {
+		go_ftab_reset();
+		go_index_close();
+	}
+
+	if (opt_d != NULL) {
+		go_index_setdir(opt_d);
+		if (!opt_u)
+			(void) go_index_open(pclntab, pclntabsz, ftabsize);
+	}
+
+	if (opt_w && go_index_build() != 0)
+		return (DCMD_ERR);
+
+	go_index_report();
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_go_index_help(void)
+{
+	mdb_printf(
+	    "Report on the sidecar index for this target's binary.  The index\n"
+	    "holds the decoded function table, names and pc-value tables, and\n"
+	    "is used in place of reading them from the target whenever a\n"
+	    "matching one exists.  Indexes are kept in $MDB_GO_INDEX_DIR, or\n"
+	    "/var/tmp/mdb_go by default, which must be owned by us and\n"
+	    "writable by no one else.\n\n"
+	    "  -d dir  use indexes in dir\n"
+	    "  -u      stop using the index for this target\n"
+	    "  -w      build and write an index for this target\n");
+}
+
+/*ARGSUSED*/
+static int
+dcmd_go_layout(uintptr_t addr, uint_t flags, int argc, const mdb_arg_t *argv)
+{
+	if ((flags & DCMD_ADDRSPEC) || argc != 0)
+		return (DCMD_USAGE);
+
+	go_layout_report();
+
+	return (DCMD_OK);
+}
+
+static void
+dcmd_go_layout_help(void)
+{
+	mdb_printf(
+	    "Report the runtime structure fields used by the G, M and P dcmds\n"
+	    "and walkers, with their offsets and sizes.  These come from the\n"
+	    "binary's DWARF where it describes the type, or else from the\n"
+	    "layouts built into the dmod.  A field this runtime doesn't have is\n"
+	    "reported as absent.\n");
+}
+
+/*
+ * Read the release from runtime.buildVersion, or return GO_MINOR_UNKNOWN.
+ */
+static int
+go_version_read(void)
+{
+	GElf_Sym sym;
+	uintptr_t str[2];
+	char buf[16];
+	size_t len, i;
+	int minor = 0;
+
+	if (mdb_lookup_by_name("runtime.buildVersion", &sym) != 0 ||
+	    go_vread(str, sizeof (str), sym.st_value) == -1)
+		return (GO_MINOR_UNKNOWN);
+
+	len = str[1] < sizeof (buf) - 1 ? str[1] : sizeof (buf) - 1;
+	if (len < 5 || go_vread(buf, len, str[0]) == -1)
+		return (GO_MINOR_UNKNOWN);
+	buf[len] = '\0';
+
+	if (strncmp(buf, "go1.", 4) != 0 || buf[4] < '0' || buf[4] > '9')
+		return (GO_MINOR_UNKNOWN);
+
+	for (i = 4; buf[i] >= '0' && buf[i] <= '9'; i++)
+		minor = minor * 10 + buf[i] - '0';
+
+	return (minor);
+}
 
 static void
 configure(void)
 {
 	GElf_Sym sym;
-	struct pctabhdr phdr;
-	go_functbl_t ftbl;
+	union {
+		struct pctabhdr h12;
+		go_pctabhdr116_t h116;
+		go_pctabhdr118_t h118;
+	} hdr;
+	struct pctabhdr *phdr = &hdr.h12;
+	const go_pclnfmt_t *fmt;
+
+	/*
+	 * Anything cached from a previous target is stale.
+	 */
+	go_vcache_flush();
+	go_ftab_reset();
+	go_pctab_flush();
+	go_str_flush();
+	go_unwind_flush();
+	go_inl_flush();
+	go_heap_flush();
+	go_index_reset();
+	go_elf_close();
+	go_layout_reset();
+	pclntab = 0;
+	pclntabsz = 0;
+	ftabsize = 0;
+	filetab = 0;
+	go_pclnfmt = NULL;
+	go_minor = GO_MINOR_UNKNOWN;
+	go_inlsz = 0;
+	go_functab = 0;
+	go_funcnametab = 0;
+	go_cutab = 0;
+	go_pctabbase = 0;
+	go_textstart = 0;
+	go_gofunc = 0;
 
 	/*
 	 * Load and check pclntab header.
@@ -790,70 +5503,188 @@ configure(void)
 	}
 
 	pclntab = sym.st_value;
+	pclntabsz = sym.st_size;
 
-	if (mdb_vread(&phdr, sizeof (struct pctabhdr), pclntab) == -1) {
+	(void) go_elf_open(pclntab, pclntabsz);
+	go_layout_load();
+
+	/*
+	 * The largest header is read whole; the format decides how much of it
+	 * there is.
+	 */
+	bzero(&hdr, sizeof (hdr));
+	if (go_vread(&hdr, sizeof (struct pctabhdr), pclntab) == -1) {
 		mdb_warn("Could not load pclntab header\n");
 		return;
 	}
 
-	if (phdr.magic != 0xfffffffb || phdr.zeros != 0 ||
-	    phdr.quantum != GO_PC_QUANTUM ||
-	    phdr.ptrsize != sizeof (uintptr_t *)) {
+	for (fmt = go_pclnfmts; fmt->gpf_magic != 0; fmt++) {
+		if (fmt->gpf_magic == phdr->magic)
+			break;
+	}
+
+	if (fmt->gpf_magic == 0 || phdr->zeros != 0 ||
+	    phdr->quantum != GO_PC_QUANTUM ||
+	    phdr->ptrsize != sizeof (uintptr_t *)) {
 		mdb_warn("invalid pclntab header\n");
 		return;
 	}
 
-	ftabsize = phdr.tabsize;
+	if (fmt->gpf_magic != GO_PCLN_MAGIC_12 &&
+	    go_vread(&hdr, sizeof (hdr), pclntab) == -1) {
+		mdb_warn("Could not load pclntab header\n");
+		return;
+	}
 
-	/*
-	 * The file table is stored in the offset of the final PC.
-	 */
-	if (mdb_vread(&ftbl, sizeof (ftbl), GO_FILETABLE_OFFSET) == -1) {
-		mdb_warn("Could not read pcvalue table offset\n");
+	ftabsize = phdr->tabsize;
+
+	if (fmt->gpf_hdr(phdr) != 0) {
+		ftabsize = 0;
 		return;
 	}
 
-	filetab = GO_PCLNTAB_OFFSET((uint32_t)ftbl.offset);
+	go_pclnfmt = fmt;
+	go_minor = go_version_read();
+	if (fmt->gpf_magic != GO_PCLN_MAGIC_12 || go_minor >= 12)
+		go_inlsz = fmt->gpf_inlsz;
 
-	mdb_printf("Configured Go support\n");
+	(void) go_index_open(pclntab, pclntabsz, ftabsize);
+
+	mdb_printf("Configured Go support (%s pclntab)\n", fmt->gpf_name);
 }
 
 static const mdb_dcmd_t go_mdb_dcmds[] = {
-	{ "gostack", "[-p property]", "print a Go stack trace",
+	{ "gostack", "?[-p property]",
+	    "print a Go stack trace, of the goroutine at addr if given",
 	    dcmd_gostack, NULL },
 	{ "goframe", "[-p property]", "print a Go stack frame",
 	    dcmd_goframe, NULL },
+	{ "gosummary", "[-n count]",
+		"summarize goroutines by status, wait reason and creator",
+		dcmd_gosummary, dcmd_gosummary_help },
+	{ "gostacks", NULL,
+		"print the distinct stacks of all goroutines",
+		dcmd_gostacks, dcmd_gostacks_help },
+	{ "gosym", "?[-r] [pc ...]",
+		"symbolize a batch of PCs", dcmd_gosym, dcmd_gosym_help },
+	{ "gofunc", "[-p] name | -r regex",
+		"look up Go functions by name", dcmd_gofunc,
+		dcmd_gofunc_help },
+	{ "golines", "file:line",
+		"find the PCs of a source line", dcmd_golines,
+		dcmd_golines_help },
 	{ "go_g", "...",
 		"print some stuff about a G", dcmd_go_g },
 	{ "go_p", "...",
 		"print some stuff about a P", dcmd_go_p },
 	{ "go_m", "...",
 		"print some stuff about a M", dcmd_go_m },
+	{ "go_heapstats", "[-a]",
+		"summarize the heap's spans by size class",
+		dcmd_go_heapstats, dcmd_go_heapstats_help },
+	{ "go_whatis", ":[-a]",
+		"find the heap object holding an address",
+		dcmd_go_whatis, dcmd_go_whatis_help },
+	{ "go_retainers", "?[-c] [-n count] [-t threads]",
+		"find what retains the most of the heap",
+		dcmd_go_retainers, dcmd_go_retainers_help },
 	{ "go_timers", "...",
 		"print some stuff about a Timer", dcmd_go_timers },
 	{ "go_sigtab", "...",
 		"print some stuff about the SigTab", dcmd_go_sigtab },
+	{ "go_cache", "[-c] [-P size] [-t bytes] [-v bytes]",
+		"report on decoded-data caches", dcmd_go_cache,
+		dcmd_go_cache_help },
+	{ "go_index", "[-uw] [-d dir]",
+		"report on, write or discard the sidecar index",
+		dcmd_go_index, dcmd_go_index_help },
+	{ "go_layout", NULL,
+		"report runtime structure layouts", dcmd_go_layout,
+		dcmd_go_layout_help },
+#ifdef	MDB_GO_HOST
+	{ "go_findbench", "[-n lookups]",
+		"benchmark PC lookup: binary search vs. bucket index",
+		dcmd_go_findbench },
+#endif
 	{ NULL }
 };
 
 static const mdb_walker_t go_mdb_walkers[] = {
-	{ "goframe", "walk Go stack frames",
-		walk_goframes_init, walk_goframes_step },
+	{ "goframe", "walk Go stack frames of the current thread, or a G",
+		walk_goframes_init, walk_goframes_step, walk_goframes_fini },
 	{ "go_g", "walk all G",
-		walk_go_g_init, walk_go_g_step },
+		walk_go_g_init, go_walk_step, go_walk_fini },
+	{ "go_g_rec", "walk all G, passing a record of the common fields",
+		walk_go_g_rec_init, go_walk_step, go_walk_fini },
 	{ "go_p", "walk all P",
-		walk_go_p_init, walk_go_p_step },
+		walk_go_p_init, go_walk_step, go_walk_fini },
+	{ "go_p_rec", "walk all P, passing a record of the common fields",
+		walk_go_p_rec_init, go_walk_step, go_walk_fini },
 	{ "go_m", "walk all M",
-		walk_go_m_init, walk_go_m_step },
+		walk_go_m_init, go_walk_step, go_walk_fini },
+	{ "go_m_rec", "walk all M, passing a record of the common fields",
+		walk_go_m_rec_init, go_walk_step, go_walk_fini },
+	{ "go_span", "walk all spans of the heap, passing a record of each",
+		walk_go_span_init, go_walk_step, go_walk_fini },
+	{ "go_span_inuse", "walk the in-use spans of the heap",
+		walk_go_span_inuse_init, go_walk_step, go_walk_fini },
+	{ "go_span_class", "walk the in-use spans of the size class at addr",
+		walk_go_span_class_init, go_walk_step, go_walk_fini },
 	{ NULL }
 };
 
 static const mdb_modinfo_t go_mdb =
     { MDB_API_VERSION, go_mdb_dcmds, go_mdb_walkers };
 
+/*
+ * The function table cache belongs to the target it was read from.  If the
+ * target changes underneath us (a new process is attached or created), the
+ * pclntab moves or disappears and we start over.
+ */
+static void *go_stchg_cb;
+
+/*ARGSUSED*/
+static void
+go_stchg(void *arg)
+{
+	GElf_Sym sym;
+
+	/*
+	 * A live target may have run since we last looked at it.
+	 */
+	if (!mdb_prop_postmortem) {
+		go_vcache_flush();
+		go_heap_flush();
+	}
+
+	if (mdb_lookup_by_name("runtime.pclntab", &sym) != 0)
+		sym.st_value = 0;
+
+	if (sym.st_value == pclntab)
+		return;
+
+	configure();
+}
+
 const mdb_modinfo_t *
 _mdb_init(void)
 {
 	configure();
+	go_stchg_cb = mdb_callback_add(MDB_CALLBACK_STCHG, go_stchg, NULL);
 	return (&go_mdb);
 }
+
+void
+_mdb_fini(void)
+{
+	if (go_stchg_cb != NULL)
+		mdb_callback_remove(go_stchg_cb);
+	go_ftab_reset();
+	go_index_reset();
+	go_pctab_flush();
+	go_str_flush();
+	go_inl_flush();
+	go_heap_flush();
+	go_elf_close();
+	go_vcache_flush();
+}
@@ -0,0 +1,340 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+#ifndef	_MDB_GO_H
+#define	_MDB_GO_H
+
+/*
+ * Interfaces shared between the source files of the Go dmod.
+ */
+
+#include <sys/mdb_modapi.h>
+
+/*
+ * Target memory access (mdb_go_vcache.c).  All reads of the target go
+ * through a cache of target pages.
+ */
+extern ssize_t go_vread(void *, size_t, uintptr_t);
+extern ssize_t go_readstr(char *, size_t, uintptr_t);
+extern void go_vcache_flush(void);
+extern void go_vcache_zero(void);
+extern int go_vcache_set(size_t, size_t);
+extern size_t go_vcache_pagesize(void);
+extern size_t go_vcache_limit(void);
+extern void go_vcache_report(void);
+
+/*
+ * Sidecar index files (mdb_go_index.c).
+ */
+#define	GO_INDEX_FTAB		0	/* function table */
+#define	GO_INDEX_BUCKETS	1	/* function table lookup index */
+#define	GO_INDEX_STRIDX		2	/* names, sorted by key */
+#define	GO_INDEX_STRS		3	/* ... and their text */
+#define	GO_INDEX_PCIDX		4	/* pc-value tables, sorted by offset */
+#define	GO_INDEX_PCDATA		5	/* ... and their runs */
+#define	GO_INDEX_NSECTS		6
+
+extern int go_index_open(uintptr_t, size_t, size_t);
+extern void go_index_close(void);
+extern void go_index_reset(void);
+extern const void *go_index_sect(int, size_t *);
+extern int go_index_write(const void *const *, const size_t *);
+extern void go_index_setdir(const char *);
+extern void go_index_report(void);
+
+/*
+ * The pclntab, mapped from the on-disk binary (mdb_go_elf.c).
+ */
+extern int go_elf_object(uintptr_t, uintptr_t *, char *, size_t);
+extern int go_elf_open(uintptr_t, size_t);
+extern void go_elf_close(void);
+extern const void *go_elf_ptr(uintptr_t, size_t *);
+extern const void *go_elf_section(const char *, size_t *);
+extern void go_elf_report(void);
+
+/*
+ * Runtime structure layouts, from the binary's DWARF or built in
+ * (mdb_go_layout.c).
+ */
+typedef enum go_typeid {
+	GO_TYPE_G,
+	GO_TYPE_M,
+	GO_TYPE_P,
+	GO_TYPE_GOBUF,
+	GO_TYPE_MSPAN,
+	GO_TYPE_MHEAP,
+	GO_TYPE_HEAPARENA,
+	GO_TYPE_SPECIAL,
+	GO_TYPE_SPECIALFIN,
+	GO_NTYPES
+} go_typeid_t;
+
+typedef enum go_fieldid {
+	GO_G_GOID,
+	GO_G_STATUS,
+	GO_G_ALLLINK,
+	GO_G_SCHEDLINK,
+	GO_G_SCHED_SP,
+	GO_G_SCHED_PC,
+	GO_G_SCHED_BP,
+	GO_G_STACKLO,
+	GO_G_STACKHI,
+	GO_G_STACKSIZE,
+	GO_G_STACKGUARD,
+	GO_G_SYSCALLSP,
+	GO_G_SYSCALLPC,
+	GO_G_SYSCALLSTACK,
+	GO_G_SYSCALLGUARD,
+	GO_G_M,
+	GO_G_GOPC,
+	GO_G_STARTPC,
+	GO_G_WAITREASON,
+	GO_G_WAITREASON_STR,
+	GO_G_WAITREASON_LEN,
+	GO_G_ISPANIC,
+	GO_G_ISSYSTEM,
+	GO_G_ISBACKGROUND,
+
+	GO_M_ID,
+	GO_M_G0,
+	GO_M_CURG,
+	GO_M_P,
+	GO_M_NEXTP,
+	GO_M_GSIGNAL,
+	GO_M_CAUGHTSIG,
+	GO_M_ALLLINK,
+	GO_M_SCHEDLINK,
+	GO_M_PROCID,
+	GO_M_LIBCALL,
+	GO_M_LIBCALL_FN,
+	GO_M_LIBCALL_N,
+
+	GO_P_ID,
+	GO_P_STATUS,
+	GO_P_LINK,
+	GO_P_M,
+	GO_P_RUNQSIZE,
+	GO_P_RUNQHEAD,
+	GO_P_RUNQTAIL,
+
+	GO_GOBUF_SP,
+	GO_GOBUF_PC,
+	GO_GOBUF_G,
+	GO_GOBUF_BP,
+
+	GO_MSPAN_NEXT,
+	GO_MSPAN_STARTADDR,
+	GO_MSPAN_NPAGES,
+	GO_MSPAN_FREEINDEX,
+	GO_MSPAN_NELEMS,
+	GO_MSPAN_ALLOCBITS,
+	GO_MSPAN_GCMARKBITS,
+	GO_MSPAN_ALLOCCOUNT,
+	GO_MSPAN_SPANCLASS,
+	GO_MSPAN_STATE,
+	GO_MSPAN_ELEMSIZE,
+	GO_MSPAN_LIMIT,
+	GO_MSPAN_SPECIALS,
+
+	GO_MHEAP_ALLSPANS,
+	GO_MHEAP_ARENAS,
+
+	GO_HEAPARENA_SPANS,
+
+	GO_SPECIAL_NEXT,
+	GO_SPECIAL_OFFSET,
+	GO_SPECIAL_KIND,
+
+	GO_SPECIALFIN_FN,
+	GO_NFIELDS
+} go_fieldid_t;
+
+typedef struct go_field {
+	uint32_t gf_off;
+	uint32_t gf_size;		/* 0 if the runtime has no such field */
+} go_field_t;
+
+extern go_field_t go_fields[GO_NFIELDS];
+
+#define	GO_FIELD_PRESENT(id)	(go_fields[(id)].gf_size != 0)
+#define	GO_FIELD_ADDR(addr, id)	((addr) + go_fields[(id)].gf_off)
+
+extern void go_layout_load(void);
+extern void go_layout_reset(void);
+#define	GO_FIELDS_MAXSPAN	4096
+
+extern int go_field_read(uintptr_t, go_fieldid_t, uint64_t *);
+extern int go_fields_read(uintptr_t, const go_fieldid_t *, size_t,
+    uint64_t *);
+extern size_t go_type_size(go_typeid_t);
+extern void go_layout_report(void);
+
+/*
+ * The commonly used fields of a G, which the go_g_rec walker hands to its
+ * callbacks.
+ */
+typedef struct go_grec {
+	int64_t gr_goid;
+	uint32_t gr_status;
+	uintptr_t gr_sp;
+	uintptr_t gr_pc;
+	uintptr_t gr_bp;
+	uintptr_t gr_stacklo;
+	uintptr_t gr_stackhi;
+	uintptr_t gr_syscallsp;
+	uintptr_t gr_syscallpc;
+	uintptr_t gr_m;
+	uintptr_t gr_gopc;
+	uintptr_t gr_startpc;
+	uint64_t gr_waitreason;		/* a string, or later an enum */
+	uint64_t gr_waitlen;		/* if the string is a Go string */
+	uint64_t gr_stacksize;
+} go_grec_t;
+
+/*
+ * While the garbage collector scans a G's stack, it sets GO_GSCAN in the
+ * G's status alongside the status the G already had.  GO_GSTATUS() gives
+ * that underlying status, which is what says where the G's registers are.
+ */
+#define	GO_GSCAN		0x1000
+#define	GO_GSTATUS(status)	((status) & ~GO_GSCAN)
+
+/*
+ * The Go heap, from Go 1.11 on: memory is in arenas of GO_ARENA_BYTES, each
+ * divided into pages of GO_PAGE_BYTES, runs of which make up spans.  The
+ * go_span walkers hand one of these records to their callbacks.
+ */
+#define	GO_PAGE_BYTES		8192
+#define	GO_ARENA_BYTES		(64ULL * 1024 * 1024)
+#define	GO_ARENA_PAGES		(GO_ARENA_BYTES / GO_PAGE_BYTES)
+
+#define	GO_MSPAN_DEAD		0
+#define	GO_MSPAN_INUSE		1	/* holds heap objects */
+#define	GO_MSPAN_MANUAL		2	/* stacks and the like */
+
+#define	GO_SPECIAL_FINALIZER	1	/* a runtime.specialfinalizer */
+
+typedef struct go_srec {
+	uintptr_t sr_start;
+	uintptr_t sr_npages;
+	uintptr_t sr_freeindex;
+	uintptr_t sr_nelems;
+	uintptr_t sr_allocbits;
+	uintptr_t sr_gcmarkbits;
+	uintptr_t sr_elemsize;
+	uintptr_t sr_limit;
+	uintptr_t sr_specials;		/* finalizers and the like */
+	uint32_t sr_alloccount;
+	uint8_t sr_sizeclass;		/* 0 for a large object */
+	uint8_t sr_noscan;		/* objects hold no pointers */
+	uint8_t sr_state;
+} go_srec_t;
+
+/*
+ * The index from heap page to span (mdb_go_heap.c).
+ */
+typedef struct go_hspan {
+	uintptr_t hs_addr;		/* of the runtime.mspan */
+	go_srec_t hs_rec;
+} go_hspan_t;
+
+typedef struct go_hobj {
+	uintptr_t ho_base;
+	uintptr_t ho_size;
+	uintptr_t ho_index;		/* of the object in its span */
+	boolean_t ho_alloc;
+	const go_hspan_t *ho_span;
+} go_hobj_t;
+
+extern int go_heap_load(void);
+extern void go_heap_flush(void);
+extern const go_hspan_t *go_heap_span(uintptr_t);
+extern int go_heap_object(uintptr_t, go_hobj_t *);
+extern void go_heap_report(void);
+
+/*
+ * The heap's reference graph, its dominator tree and the bytes each object
+ * retains (mdb_go_heap.c).
+ */
+#define	GO_ROOT_STACK		0	/* a goroutine's stack */
+#define	GO_ROOT_DATA		1	/* data or bss */
+#define	GO_ROOT_FINALIZER	2	/* a finalizer's object, or its fn */
+
+typedef struct go_groot {
+	uint32_t gr_node;
+	uint32_t gr_kind;
+	uintptr_t gr_addr;		/* of the pointer, or the object */
+	int64_t gr_goid;		/* for a stack */
+} go_groot_t;
+
+typedef struct go_retainer {
+	uintptr_t rt_addr;
+	uintptr_t rt_size;
+	uint64_t rt_retained;		/* bytes */
+	uint64_t rt_objects;
+	uint8_t rt_sizeclass;
+	uint8_t rt_noscan;
+	uintptr_t rt_holder;		/* immediate dominator, or 0 */
+	const go_groot_t *rt_root;	/* a root referring to it, if any */
+} go_retainer_t;
+
+/*
+ * Objects of each span class: the objects reachable, their bytes, and the
+ * bytes retained by those not dominated by another object of their class.
+ */
+#define	GO_NSPANCLASS		256
+
+typedef struct go_retclass {
+	uint64_t rc_objects;
+	uint64_t rc_bytes;
+	uint64_t rc_retained;
+	uintptr_t rc_elemsize;
+} go_retclass_t;
+
+typedef struct go_graphstats {
+	uint64_t gs_nodes;		/* object slots */
+	uint64_t gs_objects;		/* ... allocated */
+	uint64_t gs_reachable;
+	uint64_t gs_bytes;		/* reachable */
+	uint64_t gs_edges;
+	uint64_t gs_roots;
+	uint64_t gs_badreads;
+	uint_t gs_nthreads;
+} go_graphstats_t;
+
+extern int go_graph_load(uint_t);
+extern void go_graph_flush(void);
+extern void go_graph_stats(go_graphstats_t *);
+extern ssize_t go_graph_top(uintptr_t, go_retainer_t **, size_t);
+extern const go_retclass_t *go_graph_classes(void);
+
+#ifdef	MDB_GO_HOST
+/*
+ * Lookups exposed to the host benchmarks (host/mdb_go_bench.c).
+ */
+extern uintptr_t findfunc(uintptr_t);
+extern int32_t go_host_pcln(uintptr_t);
+#endif
+
+#endif	/* _MDB_GO_H */
@@ -0,0 +1,415 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * The pclntab is read-only data that the linker wrote into the binary, so
+ * rather than reading it out of the target a page at a time we map the
+ * section that holds it straight out of the on-disk binary.  The function
+ * table, names and pc-value tables are then used in place, and reads of the
+ * pclntab never touch the target at all.
+ *
+ * The binary is the one the target says it loaded the pclntab from.  It may
+ * since have been replaced or removed, or (for a core) may never have been
+ * on this system, so we only use it if the bytes at each end of the pclntab
+ * match the target's; otherwise everything is read from the target as
+ * before.
+ *
+ * Having established that the binary is the target's, we also hand out its
+ * other sections (the DWARF, say) on request, inflating those the linker
+ * compressed.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "mdb_go.h"
+
+#define	GO_ELF_CHECKSZ	4096	/* bytes compared at each end */
+#define	GO_ELF_MAXSECT	(1024 * 1024 * 1024)
+
+static const uchar_t *go_elf_map;
+static size_t go_elf_mapsz;
+static const Elf64_Ehdr *go_elf_ehdr;
+static char go_elf_path[1024];
+
+/*
+ * Sections we have inflated, freed when the binary is closed.
+ */
+typedef struct go_elf_buf {
+	struct go_elf_buf *geb_next;
+	char geb_name[32];
+	void *geb_data;
+	size_t geb_size;
+} go_elf_buf_t;
+
+static go_elf_buf_t *go_elf_bufs;
+
+/*
+ * The target range we serve, and where it is in the mapping.
+ */
+static uintptr_t go_elf_addr;
+static uintptr_t go_elf_end;
+static const uchar_t *go_elf_data;
+
+typedef struct go_elf_obj {
+	uintptr_t geo_addr;
+	uintptr_t geo_base;
+	char *geo_path;
+	size_t geo_pathlen;
+	boolean_t geo_found;
+} go_elf_obj_t;
+
+static int
+go_elf_obj_cb(mdb_object_t *obj, void *arg)
+{
+	go_elf_obj_t *geo = arg;
+
+	if (geo->geo_addr < obj->obj_base ||
+	    geo->geo_addr >= obj->obj_base + obj->obj_size)
+		return (0);
+
+	geo->geo_base = obj->obj_base;
+	if (geo->geo_path != NULL) {
+		(void) strncpy(geo->geo_path, obj->obj_fullname != NULL ?
+		    obj->obj_fullname : "", geo->geo_pathlen);
+		geo->geo_path[geo->geo_pathlen - 1] = '\0';
+	}
+	geo->geo_found = B_TRUE;
+
+	return (1);
+}
+
+/*
+ * Find the load object containing addr, returning its base address and (if
+ * path is non-NULL) the path it was loaded from.
+ */
+int
+go_elf_object(uintptr_t addr, uintptr_t *basep, char *path, size_t pathlen)
+{
+	go_elf_obj_t geo;
+
+	bzero(&geo, sizeof (geo));
+	geo.geo_addr = addr;
+	geo.geo_path = pathlen != 0 ? path : NULL;
+	geo.geo_pathlen = pathlen;
+	(void) mdb_object_iter(go_elf_obj_cb, &geo);
+
+	if (!geo.geo_found)
+		return (-1);
+
+	*basep = geo.geo_base;
+	return (0);
+}
+
+/*
+ * Compare len bytes of the target at addr with the mapping.  A target that
+ * can't be read at all (a core without its read-only data, say) has nothing
+ * to contradict the file with.
+ */
+static boolean_t
+go_elf_matches(const uchar_t *data, uintptr_t addr, size_t len)
+{
+	uchar_t buf[GO_ELF_CHECKSZ];
+
+	if (go_vread(buf, len, addr) != (ssize_t)len)
+		return (B_TRUE);
+
+	return (bcmp(buf, data, len) == 0);
+}
+
+void
+go_elf_close(void)
+{
+	go_elf_buf_t *geb;
+
+	while ((geb = go_elf_bufs) != NULL) {
+		go_elf_bufs = geb->geb_next;
+		if (geb->geb_data != NULL)
+			mdb_free(geb->geb_data, geb->geb_size);
+		mdb_free(geb, sizeof (*geb));
+	}
+
+	if (go_elf_map != NULL)
+		(void) munmap((void *)go_elf_map, go_elf_mapsz);
+
+	go_elf_map = NULL;
+	go_elf_mapsz = 0;
+	go_elf_ehdr = NULL;
+	go_elf_addr = 0;
+	go_elf_end = 0;
+	go_elf_data = NULL;
+	go_elf_path[0] = '\0';
+}
+
+/*
+ * Map the section of the on-disk binary holding the pclntab, which is size
+ * bytes at addr in the target (size may be 0 if the symbol doesn't say).
+ */
+int
+go_elf_open(uintptr_t addr, size_t size)
+{
+	const Elf64_Ehdr *ehdr;
+	const Elf64_Phdr *phdr;
+	const Elf64_Shdr *shdr;
+	uintptr_t base, minva = (uintptr_t)-1, bias, vaddr;
+	struct stat st;
+	const uchar_t *data;
+	void *map;
+	size_t i, len;
+	int fd;
+
+	go_elf_close();
+
+	if (go_elf_object(addr, &base, go_elf_path,
+	    sizeof (go_elf_path)) != 0 || go_elf_path[0] != '/')
+		goto fail;
+
+	if ((fd = open(go_elf_path, O_RDONLY)) == -1)
+		goto fail;
+
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof (Elf64_Ehdr) ||
+	    (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) ==
+	    MAP_FAILED) {
+		(void) close(fd);
+		goto fail;
+	}
+
+	(void) close(fd);
+	go_elf_map = map;
+	go_elf_mapsz = st.st_size;
+
+	ehdr = map;
+	if (bcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+	    ehdr->e_phentsize != sizeof (Elf64_Phdr) ||
+	    ehdr->e_shentsize != sizeof (Elf64_Shdr) ||
+	    ehdr->e_phoff + ehdr->e_phnum * sizeof (Elf64_Phdr) >
+	    go_elf_mapsz ||
+	    ehdr->e_shoff + ehdr->e_shnum * sizeof (Elf64_Shdr) >
+	    go_elf_mapsz)
+		goto fail;
+
+	phdr = (const Elf64_Phdr *)(go_elf_map + ehdr->e_phoff);
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr[i].p_type == PT_LOAD && phdr[i].p_vaddr < minva)
+			minva = phdr[i].p_vaddr;
+	}
+
+	bias = ehdr->e_type == ET_DYN ? base - (minva & ~(uintptr_t)0xfff) : 0;
+	vaddr = addr - bias;
+
+	/*
+	 * This is .gopclntab in any binary with section headers, but we
+	 * needn't care what the section is called.
+	 */
+	shdr = (const Elf64_Shdr *)(go_elf_map + ehdr->e_shoff);
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		if (shdr[i].sh_type != SHT_NOBITS &&
+		    (shdr[i].sh_flags & SHF_ALLOC) &&
+		    vaddr >= shdr[i].sh_addr &&
+		    vaddr < shdr[i].sh_addr + shdr[i].sh_size &&
+		    shdr[i].sh_offset + shdr[i].sh_size <= go_elf_mapsz)
+			break;
+	}
+
+	if (i == ehdr->e_shnum)
+		goto fail;
+
+	data = go_elf_map + shdr[i].sh_offset + (vaddr - shdr[i].sh_addr);
+	len = shdr[i].sh_addr + shdr[i].sh_size - vaddr;
+	if (size > len)
+		goto fail;
+	if (size == 0)
+		size = len;
+
+	if (!go_elf_matches(data, addr,
+	    size < GO_ELF_CHECKSZ ? size : GO_ELF_CHECKSZ) ||
+	    (size > GO_ELF_CHECKSZ && !go_elf_matches(data + size -
+	    GO_ELF_CHECKSZ, addr + size - GO_ELF_CHECKSZ, GO_ELF_CHECKSZ)))
+		goto fail;
+
+	go_elf_addr = shdr[i].sh_addr + bias;
+	go_elf_end = go_elf_addr + shdr[i].sh_size;
+	go_elf_data = go_elf_map + shdr[i].sh_offset;
+	go_elf_ehdr = ehdr;
+
+	return (0);
+
+fail:
+	go_elf_close();
+	return (-1);
+}
+
+/*
+ * If addr is in the mapped range, return a pointer to it and the number of
+ * bytes that follow it in the range.
+ */
+const void *
+go_elf_ptr(uintptr_t addr, size_t *lenp)
+{
+	if (addr < go_elf_addr || addr >= go_elf_end)
+		return (NULL);
+
+	*lenp = go_elf_end - addr;
+	return (go_elf_data + (addr - go_elf_addr));
+}
+
+/*
+ * Inflate a section: either SHF_COMPRESSED, with an ELF compression header,
+ * or (as Go 1.11 to 1.15 write them) a .zdebug section starting "ZLIB" and
+ * the big-endian inflated size.
+ */
+static void *
+go_elf_inflate(const uchar_t *data, size_t size, boolean_t gnu,
+    size_t *sizep)
+{
+	const Elf64_Chdr *chdr;
+	uLongf len;
+	size_t hdrsz, i;
+	void *buf;
+
+	if (gnu) {
+		if (size < 12 || bcmp(data, "ZLIB", 4) != 0)
+			return (NULL);
+		for (len = 0, i = 4; i < 12; i++)
+			len = (len << 8) | data[i];
+		hdrsz = 12;
+	} else {
+		if (size < sizeof (Elf64_Chdr))
+			return (NULL);
+		chdr = (const Elf64_Chdr *)data;
+		if (chdr->ch_type != ELFCOMPRESS_ZLIB)
+			return (NULL);
+		len = chdr->ch_size;
+		hdrsz = sizeof (Elf64_Chdr);
+	}
+
+	if (len == 0 || len > GO_ELF_MAXSECT)
+		return (NULL);
+
+	*sizep = len;
+	buf = mdb_alloc(len, UM_SLEEP);
+	if (uncompress(buf, &len, data + hdrsz, size - hdrsz) != Z_OK ||
+	    len != *sizep) {
+		mdb_free(buf, *sizep);
+		return (NULL);
+	}
+
+	return (buf);
+}
+
+/*
+ * Return the contents of the named section of the binary, inflated if need
+ * be.  They remain valid until the binary is closed.
+ */
+const void *
+go_elf_section(const char *name, size_t *sizep)
+{
+	const Elf64_Shdr *shdr, *sh;
+	const char *strtab;
+	char zname[sizeof (((go_elf_buf_t *)NULL)->geb_name)];
+	go_elf_buf_t *geb;
+	size_t i, strsz;
+	boolean_t gnu;
+
+	if (go_elf_ehdr == NULL || strlen(name) + 2 > sizeof (zname))
+		return (NULL);
+
+	for (geb = go_elf_bufs; geb != NULL; geb = geb->geb_next) {
+		if (strcmp(geb->geb_name, name) == 0) {
+			*sizep = geb->geb_size;
+			return (geb->geb_data);
+		}
+	}
+
+	shdr = (const Elf64_Shdr *)(go_elf_map + go_elf_ehdr->e_shoff);
+	if (go_elf_ehdr->e_shstrndx >= go_elf_ehdr->e_shnum)
+		return (NULL);
+	sh = &shdr[go_elf_ehdr->e_shstrndx];
+	if (sh->sh_offset + sh->sh_size > go_elf_mapsz)
+		return (NULL);
+	strtab = (const char *)go_elf_map + sh->sh_offset;
+	strsz = sh->sh_size;
+
+	/* .debug_info may be .zdebug_info */
+	if (snprintf(zname, sizeof (zname), ".z%s",
+	    name[0] == '.' ? name + 1 : name) >= sizeof (zname))
+		return (NULL);
+
+	for (i = 0; i < go_elf_ehdr->e_shnum; i++) {
+		sh = &shdr[i];
+		if (sh->sh_name >= strsz || sh->sh_type == SHT_NOBITS ||
+		    sh->sh_offset + sh->sh_size > go_elf_mapsz)
+			continue;
+		if (strncmp(strtab + sh->sh_name, name, strsz - sh->sh_name) ==
+		    0) {
+			gnu = B_FALSE;
+			break;
+		}
+		if (strncmp(strtab + sh->sh_name, zname, strsz - sh->sh_name) ==
+		    0) {
+			gnu = B_TRUE;
+			break;
+		}
+	}
+
+	if (i == go_elf_ehdr->e_shnum)
+		return (NULL);
+
+	if (!gnu && !(sh->sh_flags & SHF_COMPRESSED)) {
+		*sizep = sh->sh_size;
+		return (go_elf_map + sh->sh_offset);
+	}
+
+	geb = mdb_zalloc(sizeof (*geb), UM_SLEEP);
+	(void) strcpy(geb->geb_name, name);
+	geb->geb_data = go_elf_inflate(go_elf_map + sh->sh_offset,
+	    sh->sh_size, gnu, &geb->geb_size);
+	if (geb->geb_data == NULL)
+		geb->geb_size = 0;
+	geb->geb_next = go_elf_bufs;
+	go_elf_bufs = geb;
+
+	*sizep = geb->geb_size;
+	return (geb->geb_data);
+}
+
+void
+go_elf_report(void)
+{
+	if (go_elf_data == NULL) {
+		mdb_printf("pclntab read from the target\n");
+		return;
+	}
+
+	mdb_printf("pclntab mapped from %s (%lu bytes at %p)\n", go_elf_path,
+	    (ulong_t)(go_elf_end - go_elf_addr), go_elf_addr);
+}
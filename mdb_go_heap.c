@@ -0,0 +1,1363 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * An index of the Go heap from page to span, so that any address can be
+ * resolved to the span, and so the object, holding it without a search.
+ * The runtime keeps the same map itself, in each arena's heapArena.spans,
+ * but reading it means reading 64KB of span pointers per arena and then
+ * every span they name; instead we walk the spans once (with the go_span
+ * walker, a chunk of span pointers and one read per span) and fill in our
+ * own map.  It is a hash of arenas, each with an array of GO_ARENA_PAGES
+ * span numbers, so a lookup is a hash probe and an array index.  Only live
+ * spans -- in use, or handed out for stacks -- are indexed; dead ones may
+ * overlap them.
+ *
+ * The index is built on the first lookup and kept until the target changes
+ * (or, on a live target, until it runs).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#ifdef	MDB_GO_HOST
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "mdb_go.h"
+#include "mdb_go_types.h"
+
+#define	GO_HEAP_INITHASH	64
+
+typedef struct go_harena {
+	uintptr_t ha_arena;		/* address / GO_ARENA_BYTES */
+	uint32_t ha_span[GO_ARENA_PAGES];	/* 1 + go_heap_spans index */
+} go_harena_t;
+
+static go_hspan_t *go_heap_spans;
+static size_t go_heap_nspans;
+static size_t go_heap_spansalloc;
+static go_harena_t **go_heap_arenas;
+static size_t go_heap_narenas;
+static size_t go_heap_hashsz;
+static go_harena_t *go_heap_last;	/* the arena of the last lookup */
+static boolean_t go_heap_loaded;
+static uint64_t go_heap_hits;
+static uint64_t go_heap_misses;
+
+#define	GO_HEAP_HASH(arena)	\
+	((size_t)(((arena) * 0x9e3779b97f4a7c15ULL) >> 32) & \
+	(go_heap_hashsz - 1))
+
+void
+go_heap_flush(void)
+{
+	size_t i;
+
+	go_graph_flush();
+
+	for (i = 0; i < go_heap_hashsz; i++) {
+		if (go_heap_arenas[i] != NULL)
+			mdb_free(go_heap_arenas[i], sizeof (go_harena_t));
+	}
+
+	if (go_heap_arenas != NULL)
+		mdb_free(go_heap_arenas,
+		    go_heap_hashsz * sizeof (go_harena_t *));
+	if (go_heap_spans != NULL)
+		mdb_free(go_heap_spans,
+		    go_heap_spansalloc * sizeof (go_hspan_t));
+
+	go_heap_spans = NULL;
+	go_heap_nspans = 0;
+	go_heap_spansalloc = 0;
+	go_heap_arenas = NULL;
+	go_heap_narenas = 0;
+	go_heap_hashsz = 0;
+	go_heap_last = NULL;
+	go_heap_loaded = B_FALSE;
+	go_heap_hits = 0;
+	go_heap_misses = 0;
+}
+
+static go_harena_t *
+go_heap_arena(uintptr_t arena)
+{
+	size_t i;
+
+	if (go_heap_hashsz == 0)
+		return (NULL);
+
+	for (i = GO_HEAP_HASH(arena); go_heap_arenas[i] != NULL;
+	    i = (i + 1) & (go_heap_hashsz - 1)) {
+		if (go_heap_arenas[i]->ha_arena == arena)
+			return (go_heap_arenas[i]);
+	}
+
+	return (NULL);
+}
+
+static void
+go_heap_grow(void)
+{
+	go_harena_t **old = go_heap_arenas;
+	size_t oldsz = go_heap_hashsz, i, j;
+
+	go_heap_hashsz = oldsz == 0 ? GO_HEAP_INITHASH : oldsz * 2;
+	go_heap_arenas = mdb_zalloc(go_heap_hashsz * sizeof (go_harena_t *),
+	    UM_SLEEP);
+
+	for (i = 0; i < oldsz; i++) {
+		if (old[i] == NULL)
+			continue;
+		for (j = GO_HEAP_HASH(old[i]->ha_arena);
+		    go_heap_arenas[j] != NULL;
+		    j = (j + 1) & (go_heap_hashsz - 1))
+			continue;
+		go_heap_arenas[j] = old[i];
+	}
+
+	if (old != NULL)
+		mdb_free(old, oldsz * sizeof (go_harena_t *));
+}
+
+static go_harena_t *
+go_heap_arena_add(uintptr_t arena)
+{
+	go_harena_t *ha;
+	size_t i;
+
+	if ((ha = go_heap_arena(arena)) != NULL)
+		return (ha);
+
+	if ((go_heap_narenas + 1) * 2 > go_heap_hashsz)
+		go_heap_grow();
+
+	ha = mdb_zalloc(sizeof (go_harena_t), UM_SLEEP);
+	ha->ha_arena = arena;
+
+	for (i = GO_HEAP_HASH(arena); go_heap_arenas[i] != NULL;
+	    i = (i + 1) & (go_heap_hashsz - 1))
+		continue;
+	go_heap_arenas[i] = ha;
+	go_heap_narenas++;
+
+	return (ha);
+}
+
+static int
+go_heap_span_add(uintptr_t addr, const void *rec, void *arg)
+{
+	const go_srec_t *sr = rec;
+	go_harena_t *ha = NULL;
+	uintptr_t page, end;
+	uint32_t ndx;
+
+	if (sr->sr_state != GO_MSPAN_INUSE && sr->sr_state != GO_MSPAN_MANUAL)
+		return (WALK_NEXT);
+
+	if (sr->sr_npages == 0 || sr->sr_start % GO_PAGE_BYTES != 0)
+		return (WALK_NEXT);
+
+	/*
+	 * Everything that finds objects in an in-use span divides by its
+	 * element size, so a span without one is dropped here, once.
+	 */
+	if (sr->sr_state == GO_MSPAN_INUSE && sr->sr_elemsize == 0)
+		return (WALK_NEXT);
+
+	if (go_heap_nspans == go_heap_spansalloc) {
+		size_t nalloc = go_heap_spansalloc == 0 ? 1024 :
+		    go_heap_spansalloc * 2;
+		go_hspan_t *spans = mdb_alloc(nalloc * sizeof (go_hspan_t),
+		    UM_SLEEP);
+
+		if (go_heap_nspans != 0) {
+			bcopy(go_heap_spans, spans,
+			    go_heap_nspans * sizeof (go_hspan_t));
+			mdb_free(go_heap_spans,
+			    go_heap_spansalloc * sizeof (go_hspan_t));
+		}
+		go_heap_spans = spans;
+		go_heap_spansalloc = nalloc;
+	}
+
+	go_heap_spans[go_heap_nspans].hs_addr = addr;
+	go_heap_spans[go_heap_nspans].hs_rec = *sr;
+	ndx = (uint32_t)++go_heap_nspans;
+
+	/*
+	 * A large span may run on past the end of its arena into the next.
+	 */
+	end = sr->sr_start + sr->sr_npages * GO_PAGE_BYTES;
+	for (page = sr->sr_start; page < end; page += GO_PAGE_BYTES) {
+		if (ha == NULL || ha->ha_arena != page / GO_ARENA_BYTES)
+			ha = go_heap_arena_add(page / GO_ARENA_BYTES);
+		ha->ha_span[(page % GO_ARENA_BYTES) / GO_PAGE_BYTES] = ndx;
+	}
+
+	return (WALK_NEXT);
+}
+
+int
+go_heap_load(void)
+{
+	if (go_heap_loaded)
+		return (0);
+
+	go_heap_flush();
+
+	if (mdb_walk("go_span", go_heap_span_add, NULL) == -1) {
+		go_heap_flush();
+		return (-1);
+	}
+
+	go_heap_loaded = B_TRUE;
+	return (0);
+}
+
+/*
+ * Return the live span that holds addr, or NULL.  The index must have been
+ * loaded.
+ */
+const go_hspan_t *
+go_heap_span(uintptr_t addr)
+{
+	uintptr_t arena = addr / GO_ARENA_BYTES;
+	go_harena_t *ha = go_heap_last;
+	uint32_t ndx;
+
+	if (ha == NULL || ha->ha_arena != arena) {
+		if ((ha = go_heap_arena(arena)) == NULL) {
+			go_heap_misses++;
+			return (NULL);
+		}
+		go_heap_last = ha;
+	}
+
+	if ((ndx = ha->ha_span[(addr % GO_ARENA_BYTES) / GO_PAGE_BYTES]) ==
+	    0) {
+		go_heap_misses++;
+		return (NULL);
+	}
+
+	go_heap_hits++;
+	return (&go_heap_spans[ndx - 1]);
+}
+
+/*
+ * Resolve addr to the object slot of an in-use span that holds it.  An
+ * object is allocated if it is below the span's free index, or if its bit
+ * is set in the span's allocation bitmap, which describes the span as of
+ * the last sweep.  Returns -1 if addr is in no object: outside the heap, in
+ * a stack span, or in the tail of a span past its last slot.
+ */
+int
+go_heap_object(uintptr_t addr, go_hobj_t *ho)
+{
+	const go_hspan_t *hs;
+	const go_srec_t *sr;
+	uintptr_t ndx;
+	uint8_t bits;
+
+	bzero(ho, sizeof (go_hobj_t));
+
+	if ((hs = go_heap_span(addr)) == NULL)
+		return (-1);
+
+	ho->ho_span = hs;
+	sr = &hs->hs_rec;
+
+	if (sr->sr_state != GO_MSPAN_INUSE ||
+	    (ndx = (addr - sr->sr_start) / sr->sr_elemsize) >= sr->sr_nelems)
+		return (-1);
+
+	ho->ho_index = ndx;
+	ho->ho_size = sr->sr_elemsize;
+	ho->ho_base = sr->sr_start + ndx * sr->sr_elemsize;
+
+	if (ndx < sr->sr_freeindex) {
+		ho->ho_alloc = B_TRUE;
+	} else if (sr->sr_allocbits != 0 &&
+	    go_vread(&bits, sizeof (bits), sr->sr_allocbits + ndx / 8) != -1) {
+		ho->ho_alloc = (bits & (1 << (ndx % 8))) != 0;
+	}
+
+	return (0);
+}
+
+void
+go_heap_report(void)
+{
+	uint64_t lookups = go_heap_hits + go_heap_misses;
+
+	mdb_printf("%-8s %8lu %10lu %10s %12llu %12llu %10s %3llu%%\n",
+	    "heap", go_heap_nspans, go_heap_nspans * sizeof (go_hspan_t) +
+	    go_heap_narenas * sizeof (go_harena_t), "-", go_heap_hits,
+	    go_heap_misses, "-",
+	    lookups == 0 ? 0 : go_heap_hits * 100 / lookups);
+}
+
+/*
+ * The reference graph of the heap, for finding out what keeps memory alive.
+ * Every slot of every in-use span is a node, numbered from 1 in the order
+ * of the span index, so that a span's slots are consecutive; node 0 stands
+ * for the roots: goroutine stacks, data and bss, and objects that have
+ * finalizers.  References are found conservatively: each aligned word of an
+ * allocated object, in a span whose objects may hold pointers, that points
+ * into an allocated object is taken as one.  That finds every real reference
+ * and some false ones, so the sizes retained are upper bounds.  (The
+ * runtime's own pointer bitmaps changed form in 1.12, 1.20 and 1.22; the
+ * span class at least says which objects hold no pointers at all.)
+ *
+ * The graph is kept in compressed sparse row form -- for each node an
+ * offset into one array of target nodes, all of 32 bits -- and its dominator
+ * tree is found with the semi-NCA algorithm over arrays indexed by
+ * depth-first number, freeing the graph as soon as the tree no longer needs
+ * it, so that a heap of 100M objects needs a few GB.  Only the tree and the
+ * bytes and objects each node retains are kept.
+ *
+ * Reading the objects is most of the work.  In the host build the spans are
+ * cut into chunks, GO_GRAPH_WORKPERTHREAD per thread, that the threads take
+ * in turn, each reading with mdb_vread() (which there is safe to call from
+ * any thread) into its own buffer and recording references in its own
+ * array; the arrays are copied into place once all are done.  mdb itself is
+ * single-threaded, so the dmod works through the chunks alone.
+ */
+#define	GO_GRAPH_NONE		((uint32_t)-1)
+#define	GO_GRAPH_CHUNKBYTES	(256 * 1024)
+#define	GO_GRAPH_ROOTWORDS	512
+#define	GO_GRAPH_MAXTHREADS	64
+#define	GO_GRAPH_WORKPERTHREAD	8
+#define	GO_GRAPH_MAXSPECIALS	65536	/* on one span */
+
+#define	GO_GRAPH_ISALLOC(node)	\
+	((go_graph.g_alloc[(node) / 8] & (1 << ((node) % 8))) != 0)
+
+typedef struct go_gwork {
+	size_t gw_span0;		/* spans [span0, span1) */
+	size_t gw_span1;
+	uint32_t gw_node0;		/* the first node of those spans */
+	uint32_t *gw_edges;
+	size_t gw_nedges;
+	size_t gw_alloc;
+	uint64_t gw_badreads;
+} go_gwork_t;
+
+typedef struct go_graph {
+	boolean_t g_loaded;
+	uint32_t *g_first;		/* first node of each span */
+	uint64_t g_nnodes;		/* including node 0 */
+	uint8_t *g_alloc;		/* a bit for each node */
+	uintptr_t g_minaddr;
+	uintptr_t g_maxaddr;
+	uint32_t *g_off;		/* g_nnodes + 1 of them */
+	uint32_t *g_edges;
+	go_groot_t *g_roots;		/* sorted by node, once all found */
+	size_t g_nroots;
+	size_t g_rootsalloc;
+	go_gwork_t *g_work;
+	size_t g_nwork;
+	size_t g_nextwork;
+	uint32_t g_nreach;		/* including node 0 */
+	uint32_t *g_vertex;		/* the node of each DFS number */
+	uint32_t *g_idom;		/* DFS number of each's dominator */
+	uint64_t *g_retained;
+	uint32_t *g_count;		/* objects retained */
+	go_retclass_t g_classes[GO_NSPANCLASS];
+	go_graphstats_t g_stats;
+} go_graph_t;
+
+static go_graph_t go_graph;
+
+void
+go_graph_flush(void)
+{
+	size_t i;
+
+	if (go_graph.g_first != NULL)
+		mdb_free(go_graph.g_first, go_heap_nspans * sizeof (uint32_t));
+	if (go_graph.g_alloc != NULL)
+		mdb_free(go_graph.g_alloc, (go_graph.g_nnodes + 7) / 8);
+	if (go_graph.g_off != NULL)
+		mdb_free(go_graph.g_off,
+		    (go_graph.g_nnodes + 1) * sizeof (uint32_t));
+	if (go_graph.g_edges != NULL)
+		mdb_free(go_graph.g_edges,
+		    (go_graph.g_stats.gs_edges + 1) * sizeof (uint32_t));
+	if (go_graph.g_roots != NULL)
+		mdb_free(go_graph.g_roots,
+		    go_graph.g_rootsalloc * sizeof (go_groot_t));
+
+	for (i = 0; i < go_graph.g_nwork; i++) {
+		if (go_graph.g_work[i].gw_edges != NULL)
+			mdb_free(go_graph.g_work[i].gw_edges,
+			    go_graph.g_work[i].gw_alloc * sizeof (uint32_t));
+	}
+	if (go_graph.g_work != NULL)
+		mdb_free(go_graph.g_work,
+		    go_graph.g_nwork * sizeof (go_gwork_t));
+
+	if (go_graph.g_vertex != NULL)
+		mdb_free(go_graph.g_vertex,
+		    go_graph.g_nnodes * sizeof (uint32_t));
+	if (go_graph.g_idom != NULL)
+		mdb_free(go_graph.g_idom,
+		    go_graph.g_nnodes * sizeof (uint32_t));
+	if (go_graph.g_retained != NULL)
+		mdb_free(go_graph.g_retained,
+		    go_graph.g_nreach * sizeof (uint64_t));
+	if (go_graph.g_count != NULL)
+		mdb_free(go_graph.g_count,
+		    go_graph.g_nreach * sizeof (uint32_t));
+
+	bzero(&go_graph, sizeof (go_graph));
+}
+
+/*
+ * The node of the allocated object that holds addr, or GO_GRAPH_NONE.  This
+ * only reads the index, so any thread may call it.
+ */
+static uint32_t
+go_graph_node(uintptr_t addr)
+{
+	const go_srec_t *sr;
+	go_harena_t *ha;
+	uintptr_t slot;
+	uint32_t ndx, node;
+
+	if (addr < go_graph.g_minaddr || addr >= go_graph.g_maxaddr ||
+	    (ha = go_heap_arena(addr / GO_ARENA_BYTES)) == NULL ||
+	    (ndx = ha->ha_span[(addr % GO_ARENA_BYTES) / GO_PAGE_BYTES]) == 0)
+		return (GO_GRAPH_NONE);
+
+	sr = &go_heap_spans[ndx - 1].hs_rec;
+	if (sr->sr_state != GO_MSPAN_INUSE ||
+	    (slot = (addr - sr->sr_start) / sr->sr_elemsize) >= sr->sr_nelems)
+		return (GO_GRAPH_NONE);
+
+	node = go_graph.g_first[ndx - 1] + (uint32_t)slot;
+	return (GO_GRAPH_ISALLOC(node) ? node : GO_GRAPH_NONE);
+}
+
+/*
+ * Find the span, and so the address and size, of a node.  Spans that hold
+ * no nodes have the first node of the next span that does, so the last
+ * span whose first node is no greater than this one is its span.
+ */
+static const go_srec_t *
+go_graph_nodespan(uint32_t node, uintptr_t *addrp)
+{
+	const go_srec_t *sr;
+	size_t lo = 0, hi = go_heap_nspans, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (go_graph.g_first[mid] <= node)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return (NULL);
+
+	sr = &go_heap_spans[lo - 1].hs_rec;
+	*addrp = sr->sr_start +
+	    (uintptr_t)(node - go_graph.g_first[lo - 1]) * sr->sr_elemsize;
+	return (sr);
+}
+
+/*
+ * Number the slots of the in-use spans, and note which are allocated.
+ */
+static int
+go_graph_nodes(void)
+{
+	const go_srec_t *sr;
+	uint8_t bits[GO_PAGE_BYTES / 8];
+	uint64_t n = 1;
+	uintptr_t j, nbytes;
+	size_t i;
+
+	go_graph.g_first = mdb_alloc(go_heap_nspans * sizeof (uint32_t),
+	    UM_SLEEP);
+	go_graph.g_minaddr = (uintptr_t)-1;
+
+	for (i = 0; i < go_heap_nspans; i++) {
+		sr = &go_heap_spans[i].hs_rec;
+		go_graph.g_first[i] = (uint32_t)n;
+
+		if (sr->sr_state != GO_MSPAN_INUSE)
+			continue;
+
+		if ((n += sr->sr_nelems) >= GO_GRAPH_NONE) {
+			mdb_warn("too many objects in the heap to graph\n");
+			return (-1);
+		}
+
+		if (sr->sr_start < go_graph.g_minaddr)
+			go_graph.g_minaddr = sr->sr_start;
+		if (sr->sr_start + sr->sr_npages * GO_PAGE_BYTES >
+		    go_graph.g_maxaddr)
+			go_graph.g_maxaddr = sr->sr_start +
+			    sr->sr_npages * GO_PAGE_BYTES;
+	}
+
+	go_graph.g_nnodes = n;
+	go_graph.g_alloc = mdb_zalloc((n + 7) / 8, UM_SLEEP);
+
+	for (i = 0; i < go_heap_nspans; i++) {
+		sr = &go_heap_spans[i].hs_rec;
+		if (sr->sr_state != GO_MSPAN_INUSE)
+			continue;
+
+		nbytes = (sr->sr_nelems + 7) / 8;
+		if (nbytes > sizeof (bits) || sr->sr_allocbits == 0 ||
+		    go_vread(bits, nbytes, sr->sr_allocbits) !=
+		    (ssize_t)nbytes) {
+			go_graph.g_stats.gs_badreads++;
+			nbytes = 0;
+		}
+
+		for (j = 0; j < sr->sr_nelems; j++) {
+			if (j >= sr->sr_freeindex && (j / 8 >= nbytes ||
+			    (bits[j / 8] & (1 << (j % 8))) == 0))
+				continue;
+			n = go_graph.g_first[i] + j;
+			go_graph.g_alloc[n / 8] |= 1 << (n % 8);
+			go_graph.g_stats.gs_objects++;
+		}
+	}
+
+	go_graph.g_stats.gs_nodes = go_graph.g_nnodes - 1;
+	return (0);
+}
+
+static void
+go_graph_root(uint32_t node, uint32_t kind, uintptr_t addr, int64_t goid)
+{
+	go_groot_t *roots;
+	size_t nalloc;
+
+	if (go_graph.g_nroots == go_graph.g_rootsalloc) {
+		nalloc = go_graph.g_rootsalloc == 0 ? 1024 :
+		    go_graph.g_rootsalloc * 2;
+		roots = mdb_alloc(nalloc * sizeof (go_groot_t), UM_SLEEP);
+		if (go_graph.g_nroots != 0) {
+			bcopy(go_graph.g_roots, roots,
+			    go_graph.g_nroots * sizeof (go_groot_t));
+			mdb_free(go_graph.g_roots,
+			    go_graph.g_rootsalloc * sizeof (go_groot_t));
+		}
+		go_graph.g_roots = roots;
+		go_graph.g_rootsalloc = nalloc;
+	}
+
+	roots = &go_graph.g_roots[go_graph.g_nroots++];
+	roots->gr_node = node;
+	roots->gr_kind = kind;
+	roots->gr_addr = addr;
+	roots->gr_goid = goid;
+}
+
+static void
+go_graph_scanroots(uintptr_t addr, uintptr_t end, uint32_t kind,
+    int64_t goid)
+{
+	uintptr_t buf[GO_GRAPH_ROOTWORDS];
+	size_t len, i;
+	uint32_t node;
+
+	addr = (addr + sizeof (uintptr_t) - 1) & ~(sizeof (uintptr_t) - 1);
+
+	for (; addr < end; addr += len) {
+		len = end - addr < sizeof (buf) ? end - addr : sizeof (buf);
+		if ((len &= ~(sizeof (uintptr_t) - 1)) == 0)
+			break;
+
+		if (mdb_vread(buf, len, addr) != (ssize_t)len) {
+			go_graph.g_stats.gs_badreads++;
+			continue;
+		}
+
+		for (i = 0; i < len / sizeof (uintptr_t); i++) {
+			if ((node = go_graph_node(buf[i])) != GO_GRAPH_NONE)
+				go_graph_root(node, kind,
+				    addr + i * sizeof (uintptr_t), goid);
+		}
+	}
+}
+
+/*
+ * A goroutine's stack is live from its saved stack pointer up.  A running
+ * goroutine's saved one is stale, so take all of its stack.
+ */
+/*ARGSUSED*/
+static int
+go_graph_stack(uintptr_t addr, const void *rec, void *arg)
+{
+	const go_grec_t *gr = rec;
+	uint32_t status = GO_GSTATUS(gr->gr_status);
+	uintptr_t sp;
+
+	if (status == GS_Gdead || status == GS_Gidle ||
+	    gr->gr_stackhi <= gr->gr_stacklo)
+		return (WALK_NEXT);
+
+	if (status == GS_Gsyscall && gr->gr_syscallsp != 0)
+		sp = gr->gr_syscallsp;
+	else if (status != GS_Grunning)
+		sp = gr->gr_sp;
+	else
+		sp = gr->gr_stacklo;
+
+	if (sp < gr->gr_stacklo || sp >= gr->gr_stackhi)
+		sp = gr->gr_stacklo;
+
+	go_graph_scanroots(sp, gr->gr_stackhi, GO_ROOT_STACK, gr->gr_goid);
+	return (WALK_NEXT);
+}
+
+/*
+ * An object with a finalizer is kept until the finalizer has run, and so is
+ * the finalizer's closure.
+ */
+static void
+go_graph_specials(const go_srec_t *sr)
+{
+	uint64_t kind, off, fn, next;
+	uintptr_t sp = sr->sr_specials;
+	uint32_t node;
+	int n;
+
+	for (n = 0; sp != 0 && n < GO_GRAPH_MAXSPECIALS; n++, sp = next) {
+		if (go_field_read(sp, GO_SPECIAL_KIND, &kind) != 0 ||
+		    go_field_read(sp, GO_SPECIAL_OFFSET, &off) != 0 ||
+		    go_field_read(sp, GO_SPECIAL_NEXT, &next) != 0) {
+			go_graph.g_stats.gs_badreads++;
+			return;
+		}
+
+		if (kind != GO_SPECIAL_FINALIZER)
+			continue;
+
+		if ((node = go_graph_node(sr->sr_start + off)) != GO_GRAPH_NONE)
+			go_graph_root(node, GO_ROOT_FINALIZER,
+			    sr->sr_start + off, 0);
+
+		if (go_field_read(sp, GO_SPECIALFIN_FN, &fn) == 0 &&
+		    (node = go_graph_node((uintptr_t)fn)) != GO_GRAPH_NONE)
+			go_graph_root(node, GO_ROOT_FINALIZER,
+			    sr->sr_start + off, 0);
+	}
+}
+
+static int
+go_graph_rootcmp(const void *l, const void *r)
+{
+	const go_groot_t *lr = l;
+	const go_groot_t *rr = r;
+
+	if (lr->gr_node != rr->gr_node)
+		return (lr->gr_node < rr->gr_node ? -1 : 1);
+	if (lr->gr_addr != rr->gr_addr)
+		return (lr->gr_addr < rr->gr_addr ? -1 : 1);
+	return (0);
+}
+
+static int
+go_graph_roots(void)
+{
+	static const char *datasyms[][2] = {
+		{ "runtime.data", "runtime.edata" },
+		{ "runtime.bss", "runtime.ebss" }
+	};
+	GElf_Sym start, end;
+	size_t i;
+
+	if (mdb_walk("go_g_rec", go_graph_stack, NULL) == -1) {
+		mdb_warn("failed to walk goroutines");
+		return (-1);
+	}
+
+	for (i = 0; i < sizeof (datasyms) / sizeof (datasyms[0]); i++) {
+		if (mdb_lookup_by_name(datasyms[i][0], &start) != 0 ||
+		    mdb_lookup_by_name(datasyms[i][1], &end) != 0) {
+			mdb_warn("couldn't find %s; not scanning it\n",
+			    datasyms[i][0]);
+			continue;
+		}
+		go_graph_scanroots((uintptr_t)start.st_value,
+		    (uintptr_t)end.st_value, GO_ROOT_DATA, 0);
+	}
+
+	if (GO_FIELD_PRESENT(GO_MSPAN_SPECIALS) &&
+	    GO_FIELD_PRESENT(GO_SPECIAL_KIND)) {
+		for (i = 0; i < go_heap_nspans; i++) {
+			if (go_heap_spans[i].hs_rec.sr_state ==
+			    GO_MSPAN_INUSE &&
+			    go_heap_spans[i].hs_rec.sr_specials != 0)
+				go_graph_specials(&go_heap_spans[i].hs_rec);
+		}
+	}
+
+	if (go_graph.g_nroots != 0)
+		qsort(go_graph.g_roots, go_graph.g_nroots, sizeof (go_groot_t),
+		    go_graph_rootcmp);
+	go_graph.g_stats.gs_roots = go_graph.g_nroots;
+
+	return (0);
+}
+
+static void
+go_graph_edge(go_gwork_t *gw, uint32_t node)
+{
+	uint32_t *edges;
+	size_t nalloc;
+
+	if (gw->gw_nedges == gw->gw_alloc) {
+		nalloc = gw->gw_alloc == 0 ? 4096 : gw->gw_alloc * 2;
+		edges = mdb_alloc(nalloc * sizeof (uint32_t), UM_SLEEP);
+		if (gw->gw_nedges != 0) {
+			bcopy(gw->gw_edges, edges,
+			    gw->gw_nedges * sizeof (uint32_t));
+			mdb_free(gw->gw_edges,
+			    gw->gw_alloc * sizeof (uint32_t));
+		}
+		gw->gw_edges = edges;
+		gw->gw_alloc = nalloc;
+	}
+
+	gw->gw_edges[gw->gw_nedges++] = node;
+}
+
+/*
+ * Record the references in some words of an object.  *lastp is the last
+ * node referred to, so that runs of pointers into one object (a slice's
+ * elements, say) make one edge.
+ */
+static void
+go_graph_scanwords(go_gwork_t *gw, uint32_t node, const uintptr_t *words,
+    size_t nwords, uint32_t *lastp)
+{
+	uint32_t t;
+	size_t i;
+
+	for (i = 0; i < nwords; i++) {
+		if (words[i] < go_graph.g_minaddr ||
+		    words[i] >= go_graph.g_maxaddr ||
+		    (t = go_graph_node(words[i])) == GO_GRAPH_NONE ||
+		    t == node || t == *lastp)
+			continue;
+
+		go_graph_edge(gw, t);
+		go_graph.g_off[node + 1]++;
+		*lastp = t;
+	}
+}
+
+static void
+go_graph_scanspan(go_gwork_t *gw, const go_srec_t *sr, uint32_t first,
+    uintptr_t *buf)
+{
+	uintptr_t size = sr->sr_elemsize, per, n, i, j, off, len;
+	uint32_t node, last;
+
+	if (size <= GO_GRAPH_CHUNKBYTES) {
+		per = GO_GRAPH_CHUNKBYTES / size;
+
+		for (i = 0; i < sr->sr_nelems; i += per) {
+			n = sr->sr_nelems - i < per ? sr->sr_nelems - i : per;
+
+			if (mdb_vread(buf, n * size, sr->sr_start + i * size) !=
+			    (ssize_t)(n * size)) {
+				gw->gw_badreads++;
+				continue;
+			}
+
+			for (j = 0; j < n; j++) {
+				node = first + (uint32_t)(i + j);
+				if (!GO_GRAPH_ISALLOC(node))
+					continue;
+				last = GO_GRAPH_NONE;
+				go_graph_scanwords(gw, node,
+				    buf + j * (size / sizeof (uintptr_t)),
+				    size / sizeof (uintptr_t), &last);
+			}
+		}
+
+		return;
+	}
+
+	for (j = 0; j < sr->sr_nelems; j++) {
+		node = first + (uint32_t)j;
+		if (!GO_GRAPH_ISALLOC(node))
+			continue;
+
+		last = GO_GRAPH_NONE;
+		for (off = 0; off < size; off += len) {
+			len = size - off < GO_GRAPH_CHUNKBYTES ? size - off :
+			    GO_GRAPH_CHUNKBYTES;
+			if (mdb_vread(buf, len, sr->sr_start + j * size +
+			    off) != (ssize_t)len) {
+				gw->gw_badreads++;
+				continue;
+			}
+			go_graph_scanwords(gw, node, buf,
+			    len / sizeof (uintptr_t), &last);
+		}
+	}
+}
+
+/*ARGSUSED*/
+static void *
+go_graph_worker(void *arg)
+{
+	uintptr_t *buf = mdb_alloc(GO_GRAPH_CHUNKBYTES, UM_SLEEP);
+	const go_srec_t *sr;
+	go_gwork_t *gw;
+	size_t w, i;
+
+	for (;;) {
+#ifdef	MDB_GO_HOST
+		w = __sync_fetch_and_add(&go_graph.g_nextwork, 1);
+#else
+		w = go_graph.g_nextwork++;
+#endif
+		if (w >= go_graph.g_nwork)
+			break;
+
+		gw = &go_graph.g_work[w];
+		for (i = gw->gw_span0; i < gw->gw_span1; i++) {
+			sr = &go_heap_spans[i].hs_rec;
+			if (sr->sr_state == GO_MSPAN_INUSE && !sr->sr_noscan)
+				go_graph_scanspan(gw, sr, go_graph.g_first[i],
+				    buf);
+		}
+	}
+
+	mdb_free(buf, GO_GRAPH_CHUNKBYTES);
+	return (NULL);
+}
+
+/*
+ * Cut the spans that may hold pointers into chunks of about the same
+ * number of bytes, scan them, and lay out the edges: node 0's, to each
+ * object the roots refer to, and then each chunk's in turn.
+ */
+static int
+go_graph_scan(uint_t nthreads)
+{
+	const go_srec_t *sr;
+	go_gwork_t *gw;
+	uint64_t total = 0, chunk, bytes, nedges;
+	uint32_t *edges;
+	size_t i, nwork;
+#ifdef	MDB_GO_HOST
+	pthread_t tids[GO_GRAPH_MAXTHREADS];
+	uint_t t;
+#endif
+
+	for (i = 0; i < go_heap_nspans; i++) {
+		sr = &go_heap_spans[i].hs_rec;
+		if (sr->sr_state == GO_MSPAN_INUSE && !sr->sr_noscan)
+			total += sr->sr_npages * GO_PAGE_BYTES;
+	}
+
+	nwork = nthreads * GO_GRAPH_WORKPERTHREAD;
+	chunk = total / nwork + 1;
+	go_graph.g_work = mdb_zalloc((nwork + 1) * sizeof (go_gwork_t),
+	    UM_SLEEP);
+	go_graph.g_off = mdb_zalloc((go_graph.g_nnodes + 1) *
+	    sizeof (uint32_t), UM_SLEEP);
+
+	gw = go_graph.g_work;
+	gw->gw_node0 = go_graph.g_first[0];
+	for (i = 0, bytes = 0; i < go_heap_nspans; i++) {
+		sr = &go_heap_spans[i].hs_rec;
+		if (sr->sr_state == GO_MSPAN_INUSE && !sr->sr_noscan)
+			bytes += sr->sr_npages * GO_PAGE_BYTES;
+
+		if (bytes >= chunk && gw < &go_graph.g_work[nwork]) {
+			gw->gw_span1 = i + 1;
+			gw++;
+			gw->gw_span0 = i + 1;
+			gw->gw_node0 = i + 1 < go_heap_nspans ?
+			    go_graph.g_first[i + 1] : 0;
+			bytes = 0;
+		}
+	}
+	gw->gw_span1 = go_heap_nspans;
+	go_graph.g_nwork = nwork + 1;
+	go_graph.g_nextwork = 0;
+
+#ifdef	MDB_GO_HOST
+	for (t = 1; t < nthreads; t++) {
+		if (pthread_create(&tids[t], NULL, go_graph_worker, NULL) != 0)
+			break;
+	}
+	(void) go_graph_worker(NULL);
+	nthreads = t;
+	for (t = 1; t < nthreads; t++)
+		(void) pthread_join(tids[t], NULL);
+#else
+	(void) go_graph_worker(NULL);
+	nthreads = 1;
+#endif
+	go_graph.g_stats.gs_nthreads = nthreads;
+
+	/*
+	 * Node 0 refers to each object any root refers to, once.
+	 */
+	for (i = 0; i < go_graph.g_nroots; i++) {
+		if (i == 0 || go_graph.g_roots[i].gr_node !=
+		    go_graph.g_roots[i - 1].gr_node)
+			go_graph.g_off[1]++;
+	}
+
+	nedges = go_graph.g_off[1];
+	for (i = 0; i < go_graph.g_nwork; i++) {
+		nedges += go_graph.g_work[i].gw_nedges;
+		go_graph.g_stats.gs_badreads += go_graph.g_work[i].gw_badreads;
+	}
+
+	if (nedges >= GO_GRAPH_NONE) {
+		mdb_warn("too many references in the heap to graph\n");
+		return (-1);
+	}
+
+	for (i = 1; i <= go_graph.g_nnodes; i++)
+		go_graph.g_off[i] += go_graph.g_off[i - 1];
+
+	edges = go_graph.g_edges = mdb_alloc((nedges + 1) * sizeof (uint32_t),
+	    UM_SLEEP);
+	go_graph.g_stats.gs_edges = nedges;
+
+	for (i = 0; i < go_graph.g_nroots; i++) {
+		if (i == 0 || go_graph.g_roots[i].gr_node !=
+		    go_graph.g_roots[i - 1].gr_node)
+			*edges++ = go_graph.g_roots[i].gr_node;
+	}
+
+	for (i = 0; i < go_graph.g_nwork; i++) {
+		gw = &go_graph.g_work[i];
+		if (gw->gw_nedges == 0)
+			continue;
+		bcopy(gw->gw_edges, &go_graph.g_edges[go_graph.g_off[
+		    gw->gw_node0]], gw->gw_nedges * sizeof (uint32_t));
+		mdb_free(gw->gw_edges, gw->gw_alloc * sizeof (uint32_t));
+		gw->gw_edges = NULL;
+	}
+
+	return (0);
+}
+
+/*
+ * Find the vertex with the least semidominator on the path from v up to,
+ * but not including, the root of its tree in the forest built so far,
+ * compressing the path as we go.
+ */
+static uint32_t
+go_graph_eval(uint32_t v, uint32_t *ancestor, uint32_t *label,
+    const uint32_t *semi, uint32_t *stack)
+{
+	uint32_t u, a;
+	size_t n = 0;
+
+	if (ancestor[v] == GO_GRAPH_NONE)
+		return (v);
+
+	for (u = v; ancestor[ancestor[u]] != GO_GRAPH_NONE; u = ancestor[u])
+		stack[n++] = u;
+
+	while (n > 0) {
+		u = stack[--n];
+		a = ancestor[u];
+		if (semi[label[a]] < semi[label[u]])
+			label[u] = label[a];
+		ancestor[u] = ancestor[a];
+	}
+
+	return (label[v]);
+}
+
+/*
+ * Number the nodes reachable from the roots depth first, find each one's
+ * semidominator and then its immediate dominator (semi-NCA), and sum what
+ * each retains up the tree.
+ */
+static void
+go_graph_dominators(void)
+{
+	uint64_t nnodes = go_graph.g_nnodes;
+	uint32_t *dfs, *vertex, *parent, *semi, *label, *ancestor, *stack;
+	uint32_t *poff, *pred, *coff, *kids;
+	uint32_t depth[GO_NSPANCLASS];
+	uint32_t nreach, npred, cur, v, w, t, e, s;
+	const go_srec_t *sr;
+	go_retclass_t *rc;
+	uintptr_t j;
+	size_t i;
+
+	dfs = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+	(void) memset(dfs, 0xff, nnodes * sizeof (uint32_t));
+	vertex = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+	parent = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+	semi = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+
+	/*
+	 * The path from the root to the vertex being visited is the DFS
+	 * stack; semi[] holds each vertex's place in its edges until the
+	 * search is done.
+	 */
+	dfs[0] = 0;
+	vertex[0] = 0;
+	parent[0] = GO_GRAPH_NONE;
+	semi[0] = go_graph.g_off[0];
+	nreach = 1;
+
+	for (cur = 0; cur != GO_GRAPH_NONE; ) {
+		v = vertex[cur];
+		if (semi[cur] == go_graph.g_off[v + 1]) {
+			cur = parent[cur];
+			continue;
+		}
+
+		t = go_graph.g_edges[semi[cur]++];
+		if (dfs[t] != GO_GRAPH_NONE)
+			continue;
+
+		dfs[t] = nreach;
+		vertex[nreach] = t;
+		parent[nreach] = cur;
+		semi[nreach] = go_graph.g_off[t];
+		cur = nreach++;
+	}
+
+	/*
+	 * The predecessors of each reachable vertex; after this, the graph
+	 * itself is no longer needed.
+	 */
+	poff = mdb_zalloc((nreach + 1) * sizeof (uint32_t), UM_SLEEP);
+	label = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+
+	for (v = 0; v < nreach; v++) {
+		for (e = go_graph.g_off[vertex[v]];
+		    e < go_graph.g_off[vertex[v] + 1]; e++)
+			poff[dfs[go_graph.g_edges[e]] + 1]++;
+	}
+
+	for (v = 1; v <= nreach; v++) {
+		label[v - 1] = poff[v - 1];
+		poff[v] += poff[v - 1];
+	}
+
+	npred = poff[nreach];
+	pred = mdb_alloc((npred + 1) * sizeof (uint32_t), UM_SLEEP);
+	for (v = 0; v < nreach; v++) {
+		for (e = go_graph.g_off[vertex[v]];
+		    e < go_graph.g_off[vertex[v] + 1]; e++) {
+			w = dfs[go_graph.g_edges[e]];
+			pred[label[w]++] = v;
+		}
+	}
+
+	mdb_free(go_graph.g_edges,
+	    (go_graph.g_stats.gs_edges + 1) * sizeof (uint32_t));
+	mdb_free(go_graph.g_off, (nnodes + 1) * sizeof (uint32_t));
+	go_graph.g_edges = NULL;
+	go_graph.g_off = NULL;
+
+	ancestor = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+	stack = mdb_alloc(nnodes * sizeof (uint32_t), UM_SLEEP);
+
+	for (v = 0; v < nreach; v++) {
+		semi[v] = v;
+		label[v] = v;
+		ancestor[v] = GO_GRAPH_NONE;
+	}
+
+	for (w = nreach - 1; w > 0; w--) {
+		for (e = poff[w]; e < poff[w + 1]; e++) {
+			v = pred[e];
+			s = v <= w ? v : semi[go_graph_eval(v, ancestor, label,
+			    semi, stack)];
+			if (s < semi[w])
+				semi[w] = s;
+		}
+		ancestor[w] = parent[w];
+	}
+
+	/*
+	 * A vertex's immediate dominator is the nearest ancestor in the DFS
+	 * tree that is no deeper than its semidominator; the tree is turned
+	 * into the dominator tree in place.
+	 */
+	for (w = 1; w < nreach; w++) {
+		for (v = parent[w]; v > semi[w]; v = parent[v])
+			continue;
+		parent[w] = v;
+	}
+
+	mdb_free(poff, (nreach + 1) * sizeof (uint32_t));
+	mdb_free(pred, (npred + 1) * sizeof (uint32_t));
+	mdb_free(semi, nnodes * sizeof (uint32_t));
+	mdb_free(ancestor, nnodes * sizeof (uint32_t));
+	mdb_free(stack, nnodes * sizeof (uint32_t));
+
+	go_graph.g_nreach = nreach;
+	go_graph.g_vertex = vertex;
+	go_graph.g_idom = parent;
+	go_graph.g_retained = mdb_zalloc(nreach * sizeof (uint64_t), UM_SLEEP);
+	go_graph.g_count = mdb_zalloc(nreach * sizeof (uint32_t), UM_SLEEP);
+
+	/*
+	 * label[] now holds each vertex's span class.
+	 */
+	for (i = 0; i < go_heap_nspans; i++) {
+		sr = &go_heap_spans[i].hs_rec;
+		if (sr->sr_state != GO_MSPAN_INUSE)
+			continue;
+
+		for (j = 0; j < sr->sr_nelems; j++) {
+			if ((v = dfs[go_graph.g_first[i] + j]) ==
+			    GO_GRAPH_NONE)
+				continue;
+			go_graph.g_retained[v] = sr->sr_elemsize;
+			go_graph.g_count[v] = 1;
+			label[v] = (sr->sr_sizeclass << 1) | sr->sr_noscan;
+
+			rc = &go_graph.g_classes[label[v] % GO_NSPANCLASS];
+			rc->rc_objects++;
+			rc->rc_bytes += sr->sr_elemsize;
+			if (sr->sr_elemsize > rc->rc_elemsize)
+				rc->rc_elemsize = sr->sr_elemsize;
+		}
+	}
+	label[0] = GO_GRAPH_NONE;
+
+	for (w = nreach - 1; w > 0; w--) {
+		go_graph.g_retained[parent[w]] += go_graph.g_retained[w];
+		go_graph.g_count[parent[w]] += go_graph.g_count[w];
+	}
+
+	/*
+	 * What a class retains is what its objects retain that no other
+	 * object of the class does: walk the dominator tree in preorder,
+	 * counting the objects of each class on the path from the root, and
+	 * add only those that have none of their class above them.  dfs[]
+	 * now holds each vertex's place in its children.
+	 */
+	coff = mdb_zalloc((nreach + 1) * sizeof (uint32_t), UM_SLEEP);
+	kids = mdb_alloc(nreach * sizeof (uint32_t), UM_SLEEP);
+	stack = mdb_alloc(nreach * sizeof (uint32_t), UM_SLEEP);
+
+	for (w = 1; w < nreach; w++)
+		coff[parent[w] + 1]++;
+	for (v = 1; v <= nreach; v++)
+		coff[v] += coff[v - 1];
+	for (v = 0; v < nreach; v++)
+		dfs[v] = coff[v];
+	for (w = 1; w < nreach; w++)
+		kids[dfs[parent[w]]++] = w;
+	for (v = 0; v < nreach; v++)
+		dfs[v] = coff[v];
+
+	bzero(depth, sizeof (depth));
+	stack[0] = 0;
+	for (t = 1; t > 0; ) {
+		v = stack[t - 1];
+		if (dfs[v] == coff[v + 1]) {
+			if (v != 0)
+				depth[label[v] % GO_NSPANCLASS]--;
+			t--;
+			continue;
+		}
+
+		w = kids[dfs[v]++];
+		if (depth[label[w] % GO_NSPANCLASS]++ == 0)
+			go_graph.g_classes[label[w] % GO_NSPANCLASS].
+			    rc_retained += go_graph.g_retained[w];
+		stack[t++] = w;
+	}
+
+	mdb_free(coff, (nreach + 1) * sizeof (uint32_t));
+	mdb_free(kids, nreach * sizeof (uint32_t));
+	mdb_free(stack, nreach * sizeof (uint32_t));
+	mdb_free(dfs, nnodes * sizeof (uint32_t));
+	mdb_free(label, nnodes * sizeof (uint32_t));
+
+	go_graph.g_stats.gs_reachable = nreach - 1;
+	go_graph.g_stats.gs_bytes = go_graph.g_retained[0];
+}
+
+/*
+ * Build the graph and its dominator tree, if we haven't already, with the
+ * given number of threads (0 for one per CPU) where we may use threads.
+ */
+int
+go_graph_load(uint_t nthreads)
+{
+	if (go_graph.g_loaded)
+		return (0);
+
+	if (go_heap_load() != 0)
+		return (-1);
+
+	go_graph_flush();
+
+#ifdef	MDB_GO_HOST
+	if (nthreads == 0) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 0 ? (uint_t)ncpu : 1;
+	}
+	if (nthreads > GO_GRAPH_MAXTHREADS)
+		nthreads = GO_GRAPH_MAXTHREADS;
+#else
+	nthreads = 1;
+#endif
+
+	if (go_heap_nspans == 0 || go_graph_nodes() != 0 ||
+	    go_graph_roots() != 0 || go_graph_scan(nthreads) != 0) {
+		go_graph_flush();
+		return (-1);
+	}
+
+	go_graph_dominators();
+	go_graph.g_loaded = B_TRUE;
+
+	return (0);
+}
+
+void
+go_graph_stats(go_graphstats_t *gs)
+{
+	*gs = go_graph.g_stats;
+}
+
+const go_retclass_t *
+go_graph_classes(void)
+{
+	return (go_graph.g_classes);
+}
+
+static const go_groot_t *
+go_graph_findroot(uint32_t node)
+{
+	size_t lo = 0, hi = go_graph.g_nroots, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (go_graph.g_roots[mid].gr_node < node)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo < go_graph.g_nroots && go_graph.g_roots[lo].gr_node ==
+	    node ? &go_graph.g_roots[lo] : NULL);
+}
+
+static int
+go_graph_retcmp(const void *l, const void *r)
+{
+	uint32_t lw = *(const uint32_t *)l, rw = *(const uint32_t *)r;
+	uint64_t lr = go_graph.g_retained[lw], rr = go_graph.g_retained[rw];
+
+	if (lr != rr)
+		return (lr > rr ? -1 : 1);
+	return (lw < rw ? -1 : lw > rw);
+}
+
+/*
+ * Allocate and fill in up to max (or, for 0, all) of the objects that the
+ * object at addr (or, for 0, the roots) immediately dominates, those
+ * retaining the most first; the caller frees the returned number of them.
+ * Returns -1 if addr is not in a reachable object.
+ */
+ssize_t
+go_graph_top(uintptr_t addr, go_retainer_t **rtp, size_t max)
+{
+	const go_srec_t *sr;
+	go_retainer_t *rt;
+	uint32_t *kids, node, dom, w;
+	size_t nkids = 0, n, i;
+
+	*rtp = NULL;
+
+	if (addr == 0) {
+		dom = 0;
+	} else {
+		if ((node = go_graph_node(addr)) == GO_GRAPH_NONE)
+			return (-1);
+		for (dom = 1; dom < go_graph.g_nreach &&
+		    go_graph.g_vertex[dom] != node; dom++)
+			continue;
+		if (dom == go_graph.g_nreach)
+			return (-1);
+	}
+
+	for (w = 1; w < go_graph.g_nreach; w++) {
+		if (go_graph.g_idom[w] == dom)
+			nkids++;
+	}
+
+	if (nkids == 0)
+		return (0);
+
+	kids = mdb_alloc(nkids * sizeof (uint32_t), UM_SLEEP);
+	for (i = 0, w = 1; w < go_graph.g_nreach; w++) {
+		if (go_graph.g_idom[w] == dom)
+			kids[i++] = w;
+	}
+	qsort(kids, nkids, sizeof (uint32_t), go_graph_retcmp);
+
+	n = max == 0 || max > nkids ? nkids : max;
+	rt = mdb_zalloc(n * sizeof (go_retainer_t), UM_SLEEP);
+
+	for (i = 0; i < n; i++) {
+		w = kids[i];
+		rt[i].rt_retained = go_graph.g_retained[w];
+		rt[i].rt_objects = go_graph.g_count[w];
+
+		if ((sr = go_graph_nodespan(go_graph.g_vertex[w],
+		    &rt[i].rt_addr)) != NULL) {
+			rt[i].rt_size = sr->sr_elemsize;
+			rt[i].rt_sizeclass = sr->sr_sizeclass;
+			rt[i].rt_noscan = sr->sr_noscan;
+		}
+
+		if (dom == 0)
+			rt[i].rt_root = go_graph_findroot(go_graph.g_vertex[w]);
+		else
+			(void) go_graph_nodespan(go_graph.g_vertex[dom],
+			    &rt[i].rt_holder);
+	}
+
+	mdb_free(kids, nkids * sizeof (uint32_t));
+	*rtp = rt;
+	return ((ssize_t)n);
+}
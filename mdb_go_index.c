@@ -0,0 +1,538 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * Sidecar index files.  Everything we decode from a binary's pclntab -- the
+ * function table and its lookup index, function and file names, and the
+ * pc-value tables -- depends only on the binary, so it can be saved once and
+ * reused by every later debugging session on that binary or its cores.  The
+ * index is a single file of native-endian sections that is mapped read-only
+ * and used in place.
+ *
+ * An index is named for, and checked against, the binary's build ID (from
+ * the Go or GNU build ID note) and a hash of the start and end of the
+ * pclntab, plus the pclntab's address and the number of functions.  Indexes
+ * live in $MDB_GO_INDEX_DIR, or /var/tmp/mdb_go by default.  They are only
+ * written on request (::go_index -w), and are written to a temporary file
+ * and renamed into place so that a reader never sees a partial index.
+ *
+ * /var/tmp is shared, so the directory is created private to its user, and
+ * an index is neither read from nor written to a directory that isn't a
+ * real directory, owned by us and writable by no one else.
+ *
+ * This file knows only the container: mdb_go.c decides what goes in each
+ * section.
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "mdb_go.h"
+
+#define	GO_INDEX_MAGIC		"MDBGOIDX"
+#define	GO_INDEX_VERSION	1
+#define	GO_INDEX_DEFDIR		"/var/tmp/mdb_go"
+#define	GO_INDEX_MAXBUILDID	128
+#define	GO_INDEX_HASHSZ		4096	/* bytes hashed at each end */
+
+typedef struct go_index_sect {
+	uint64_t gis_off;
+	uint64_t gis_size;
+} go_index_sect_t;
+
+typedef struct go_index_hdr {
+	char gih_magic[8];
+	uint32_t gih_version;
+	uint32_t gih_ptrsize;
+	uint64_t gih_size;		/* size of the whole file */
+	uint64_t gih_pclntab;		/* target address of the pclntab */
+	uint64_t gih_hash;		/* go_index_hash() of the pclntab */
+	uint64_t gih_nfunc;
+	uint32_t gih_buildidlen;
+	uint8_t gih_buildid[GO_INDEX_MAXBUILDID];
+	uint32_t gih_pad;
+	go_index_sect_t gih_sects[GO_INDEX_NSECTS];
+} go_index_hdr_t;
+
+/*
+ * The key of the current target, and its index if we have one mapped.
+ */
+static uintptr_t go_index_pclntab;
+static uint64_t go_index_nfunc;
+static uint64_t go_index_hashval;
+static uint8_t go_index_buildid[GO_INDEX_MAXBUILDID];
+static uint32_t go_index_buildidlen;
+static boolean_t go_index_keyed;
+
+static char go_index_dirbuf[1024];
+static char go_index_pathbuf[1200];
+static const go_index_hdr_t *go_index_map;
+static size_t go_index_mapsz;
+
+static const char *
+go_index_dir(void)
+{
+	const char *dir;
+
+	if (go_index_dirbuf[0] != '\0')
+		return (go_index_dirbuf);
+
+	if ((dir = getenv("MDB_GO_INDEX_DIR")) != NULL && *dir != '\0')
+		return (dir);
+
+	return (GO_INDEX_DEFDIR);
+}
+
+/*
+ * Check that the index directory is safe to use, creating it if asked to.
+ * Returns -1 without a warning if it doesn't exist and wasn't to be made.
+ */
+static int
+go_index_dircheck(boolean_t create)
+{
+	const char *dir = go_index_dir();
+	struct stat st;
+
+	if (create && mkdir(dir, 0700) != 0 && errno != EEXIST) {
+		mdb_warn("failed to create %s", dir);
+		return (-1);
+	}
+
+	if (lstat(dir, &st) != 0) {
+		if (create || errno != ENOENT)
+			mdb_warn("failed to stat %s", dir);
+		return (-1);
+	}
+
+	if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+	    (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		mdb_warn("not using index directory %s: it must be a "
+		    "directory owned by us and writable only by us\n", dir);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * FNV-1a.
+ */
+static uint64_t
+go_index_fnv(uint64_t h, const uchar_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ buf[i]) * 0x100000001b3ULL;
+
+	return (h);
+}
+
+static uint64_t
+go_index_hash(uintptr_t addr, size_t size)
+{
+	uchar_t buf[GO_INDEX_HASHSZ];
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t len;
+
+	len = size != 0 && size < sizeof (buf) ? size : sizeof (buf);
+	if (go_vread(buf, len, addr) == (ssize_t)len)
+		h = go_index_fnv(h, buf, len);
+
+	if (size > 2 * sizeof (buf) &&
+	    go_vread(buf, sizeof (buf), addr + size - sizeof (buf)) ==
+	    (ssize_t)sizeof (buf))
+		h = go_index_fnv(h, buf, sizeof (buf));
+
+	return (h);
+}
+
+/*
+ * Find the build ID of the object containing the pclntab, from the notes in
+ * its mapped image.  A Go build ID note is preferred to a GNU one.
+ */
+static void
+go_index_buildid_read(uintptr_t pclntab)
+{
+	Elf64_Ehdr ehdr;
+	Elf64_Phdr phdr;
+	Elf64_Nhdr nhdr;
+	uintptr_t base, minva = (uintptr_t)-1, bias, addr, end;
+	uint8_t desc[GO_INDEX_MAXBUILDID];
+	char name[8];
+	boolean_t havego = B_FALSE;
+	int i, pass;
+
+	go_index_buildidlen = 0;
+
+	if (go_elf_object(pclntab, &base, NULL, 0) != 0 ||
+	    go_vread(&ehdr, sizeof (ehdr), base) != (ssize_t)sizeof (ehdr) ||
+	    bcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+	    ehdr.e_ident[EI_CLASS] != ELFCLASS64 ||
+	    ehdr.e_phentsize != sizeof (Elf64_Phdr))
+		return;
+
+	/*
+	 * The first pass finds the load bias; the second reads the notes.
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < ehdr.e_phnum; i++) {
+			if (go_vread(&phdr, sizeof (phdr), base +
+			    ehdr.e_phoff + i * sizeof (phdr)) !=
+			    (ssize_t)sizeof (phdr))
+				return;
+
+			if (pass == 0) {
+				if (phdr.p_type == PT_LOAD && phdr.p_vaddr < minva)
+					minva = phdr.p_vaddr;
+				continue;
+			}
+
+			if (phdr.p_type != PT_NOTE)
+				continue;
+
+			bias = ehdr.e_type == ET_DYN ?
+			    base - (minva & ~(uintptr_t)0xfff) : 0;
+
+			for (addr = phdr.p_vaddr + bias,
+			    end = addr + phdr.p_filesz; addr + sizeof (nhdr) <= end;
+			    addr += sizeof (nhdr) + ((nhdr.n_namesz + 3) & ~3) +
+			    ((nhdr.n_descsz + 3) & ~3)) {
+				if (go_vread(&nhdr, sizeof (nhdr), addr) !=
+				    (ssize_t)sizeof (nhdr))
+					break;
+
+				if (nhdr.n_namesz > sizeof (name) ||
+				    nhdr.n_descsz == 0 ||
+				    nhdr.n_descsz > sizeof (desc))
+					continue;
+
+				if (go_vread(name, nhdr.n_namesz,
+				    addr + sizeof (nhdr)) !=
+				    (ssize_t)nhdr.n_namesz ||
+				    go_vread(desc, nhdr.n_descsz, addr +
+				    sizeof (nhdr) + ((nhdr.n_namesz + 3) & ~3)) !=
+				    (ssize_t)nhdr.n_descsz)
+					continue;
+
+				if (nhdr.n_namesz == 3 && nhdr.n_type == 4 &&
+				    bcmp(name, "Go", 3) == 0) {
+					havego = B_TRUE;
+				} else if (havego || nhdr.n_namesz != 4 ||
+				    nhdr.n_type != 3 ||
+				    bcmp(name, "GNU", 4) != 0) {
+					continue;
+				}
+
+				bcopy(desc, go_index_buildid, nhdr.n_descsz);
+				go_index_buildidlen = nhdr.n_descsz;
+			}
+		}
+	}
+}
+
+static void
+go_index_mkpath(void)
+{
+	char id[2 * GO_INDEX_MAXBUILDID + 1];
+	uint32_t i;
+
+	if (go_index_buildidlen == 0)
+		(void) strcpy(id, "nobuildid");
+
+	for (i = 0; i < go_index_buildidlen; i++) {
+		(void) mdb_snprintf(id + 2 * i, 3, "%02x",
+		    go_index_buildid[i]);
+	}
+
+	(void) mdb_snprintf(go_index_pathbuf, sizeof (go_index_pathbuf),
+	    "%s/%s-%016llx.idx", go_index_dir(), id, go_index_hashval);
+}
+
+void
+go_index_close(void)
+{
+	if (go_index_map != NULL)
+		(void) munmap((void *)go_index_map, go_index_mapsz);
+
+	go_index_map = NULL;
+	go_index_mapsz = 0;
+}
+
+/*
+ * Check a mapped index against its own size and against the current key.
+ */
+static int
+go_index_valid(const go_index_hdr_t *hdr, size_t size)
+{
+	int i;
+
+	if (size < sizeof (*hdr) ||
+	    bcmp(hdr->gih_magic, GO_INDEX_MAGIC, sizeof (hdr->gih_magic)) != 0 ||
+	    hdr->gih_version != GO_INDEX_VERSION ||
+	    hdr->gih_ptrsize != sizeof (uintptr_t) ||
+	    hdr->gih_size != size)
+		return (-1);
+
+	if (hdr->gih_pclntab != go_index_pclntab ||
+	    hdr->gih_hash != go_index_hashval ||
+	    hdr->gih_nfunc != go_index_nfunc ||
+	    hdr->gih_buildidlen != go_index_buildidlen ||
+	    bcmp(hdr->gih_buildid, go_index_buildid, go_index_buildidlen) != 0)
+		return (-1);
+
+	for (i = 0; i < GO_INDEX_NSECTS; i++) {
+		const go_index_sect_t *gis = &hdr->gih_sects[i];
+
+		if (gis->gis_off % sizeof (uint64_t) != 0 ||
+		    gis->gis_off > size || gis->gis_size > size - gis->gis_off)
+			return (-1);
+	}
+
+	return (0);
+}
+
+static int
+go_index_load(void)
+{
+	struct stat st;
+	void *addr;
+	int fd;
+
+	go_index_close();
+
+	if (go_index_dircheck(B_FALSE) != 0 ||
+	    (fd = open(go_index_pathbuf, O_RDONLY | O_NOFOLLOW)) == -1)
+		return (-1);
+
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof (go_index_hdr_t)) {
+		(void) close(fd);
+		return (-1);
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+
+	if (addr == MAP_FAILED)
+		return (-1);
+
+	if (go_index_valid(addr, st.st_size) != 0) {
+		mdb_warn("ignoring stale or corrupt index %s\n",
+		    go_index_pathbuf);
+		(void) munmap(addr, st.st_size);
+		return (-1);
+	}
+
+	go_index_map = addr;
+	go_index_mapsz = st.st_size;
+
+	return (0);
+}
+
+/*
+ * Compute the key for the target's pclntab and map its index, if there is
+ * one.  Returns 0 if an index was mapped.
+ */
+int
+go_index_open(uintptr_t pclntab, size_t size, size_t nfunc)
+{
+	go_index_close();
+
+	go_index_pclntab = pclntab;
+	go_index_nfunc = nfunc;
+	go_index_hashval = go_index_hash(pclntab, size);
+	go_index_buildid_read(pclntab);
+	go_index_keyed = B_TRUE;
+	go_index_mkpath();
+
+	return (go_index_load());
+}
+
+/*
+ * Forget the current target: called when the target changes.
+ */
+void
+go_index_reset(void)
+{
+	go_index_close();
+	go_index_keyed = B_FALSE;
+}
+
+/*
+ * Returns a section of the mapped index, or NULL if no index is mapped.
+ */
+const void *
+go_index_sect(int sect, size_t *sizep)
+{
+	const go_index_sect_t *gis;
+
+	if (go_index_map == NULL)
+		return (NULL);
+
+	gis = &go_index_map->gih_sects[sect];
+	*sizep = gis->gis_size;
+
+	return ((const char *)go_index_map + gis->gis_off);
+}
+
+static int
+go_index_writeall(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t rv;
+
+	while (len > 0) {
+		if ((rv = write(fd, p, len)) <= 0) {
+			if (rv == -1 && errno == EINTR)
+				continue;
+			return (-1);
+		}
+		p += rv;
+		len -= rv;
+	}
+
+	return (0);
+}
+
+/*
+ * Write an index for the current target from the given sections, and map
+ * it in place of any index already mapped.
+ */
+int
+go_index_write(const void *const *bufs, const size_t *sizes)
+{
+	static const uint64_t zero = 0;
+	char tmp[sizeof (go_index_pathbuf) + 32];
+	go_index_hdr_t hdr;
+	uint64_t off;
+	size_t pad;
+	int fd, i;
+
+	if (!go_index_keyed) {
+		mdb_warn("no Go target to index\n");
+		return (-1);
+	}
+
+	bzero(&hdr, sizeof (hdr));
+	bcopy(GO_INDEX_MAGIC, hdr.gih_magic, sizeof (hdr.gih_magic));
+	hdr.gih_version = GO_INDEX_VERSION;
+	hdr.gih_ptrsize = sizeof (uintptr_t);
+	hdr.gih_pclntab = go_index_pclntab;
+	hdr.gih_hash = go_index_hashval;
+	hdr.gih_nfunc = go_index_nfunc;
+	hdr.gih_buildidlen = go_index_buildidlen;
+	bcopy(go_index_buildid, hdr.gih_buildid, go_index_buildidlen);
+
+	off = sizeof (hdr);
+	for (i = 0; i < GO_INDEX_NSECTS; i++) {
+		off = (off + sizeof (uint64_t) - 1) & ~(sizeof (uint64_t) - 1);
+		hdr.gih_sects[i].gis_off = off;
+		hdr.gih_sects[i].gis_size = sizes[i];
+		off += sizes[i];
+	}
+	hdr.gih_size = off;
+
+	if (go_index_dircheck(B_TRUE) != 0)
+		return (-1);
+
+	go_index_mkpath();
+	(void) mdb_snprintf(tmp, sizeof (tmp), "%s.XXXXXX", go_index_pathbuf);
+
+	if ((fd = mkstemp(tmp)) == -1) {
+		mdb_warn("failed to create %s", tmp);
+		return (-1);
+	}
+
+	off = 0;
+	if (go_index_writeall(fd, &hdr, sizeof (hdr)) != 0)
+		goto err;
+	off += sizeof (hdr);
+
+	for (i = 0; i < GO_INDEX_NSECTS; i++) {
+		pad = hdr.gih_sects[i].gis_off - off;
+		if (go_index_writeall(fd, &zero, pad) != 0 ||
+		    go_index_writeall(fd, bufs[i], sizes[i]) != 0)
+			goto err;
+		off += pad + sizes[i];
+	}
+
+	if (close(fd) != 0) {
+		fd = -1;
+		goto err;
+	}
+
+	if (rename(tmp, go_index_pathbuf) != 0) {
+		mdb_warn("failed to rename %s to %s", tmp, go_index_pathbuf);
+		(void) unlink(tmp);
+		return (-1);
+	}
+
+	return (go_index_load());
+
+err:
+	mdb_warn("failed to write %s", tmp);
+	if (fd != -1)
+		(void) close(fd);
+	(void) unlink(tmp);
+	return (-1);
+}
+
+/*
+ * Set the directory indexes are kept in; NULL restores the default.
+ */
+void
+go_index_setdir(const char *dir)
+{
+	if (dir == NULL)
+		go_index_dirbuf[0] = '\0';
+	else
+		(void) mdb_snprintf(go_index_dirbuf, sizeof (go_index_dirbuf),
+		    "%s", dir);
+
+	if (go_index_keyed)
+		go_index_mkpath();
+}
+
+void
+go_index_report(void)
+{
+	if (!go_index_keyed) {
+		mdb_printf("no Go target\n");
+		return;
+	}
+
+	mdb_printf("index %s: %s", go_index_pathbuf,
+	    go_index_map != NULL ? "mapped" : "not present");
+	if (go_index_map != NULL)
+		mdb_printf(" (%lu bytes)", (ulong_t)go_index_mapsz);
+	mdb_printf("\n");
+}
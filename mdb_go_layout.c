@@ -0,0 +1,1116 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * Runtime structure layouts.  The G, M and P (and the structures inside
+ * them) change shape from one Go release to the next, so rather than
+ * compiling in one release's layout we look the fields we use up in the
+ * DWARF of the binary being debugged, once per target, and keep just their
+ * offsets and sizes in go_fields[].  A field can be looked for under more
+ * than one name, for fields that have been renamed, and a dotted name
+ * reaches into an embedded structure.  Where the binary has no DWARF (it
+ * was stripped, or isn't here), or doesn't describe a type, that type's
+ * fields fall back to the layouts in mdb_go_types.h.
+ *
+ * A field that the runtime being debugged doesn't have is left with size 0;
+ * callers check GO_FIELD_PRESENT() before relying on such fields.
+ */
+
+#include <sys/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+#include "mdb_go.h"
+#include "mdb_go_types.h"
+
+typedef struct go_typedef {
+	const char *gtd_name;
+	uint32_t gtd_size;		/* in mdb_go_types.h */
+} go_typedef_t;
+
+static const go_typedef_t go_typedefs[GO_NTYPES] = {
+	{ "runtime.g", sizeof (G) },
+	{ "runtime.m", sizeof (M) },
+	{ "runtime.p", sizeof (P) },
+	{ "runtime.gobuf", sizeof (Gobuf) },
+	{ "runtime.mspan", 0 },
+	{ "runtime.mheap", 0 },
+	{ "runtime.heapArena", 0 },
+	{ "runtime.special", 0 },
+	{ "runtime.specialfinalizer", 0 }
+};
+
+#define	GO_FIELD_MAXNAMES	3
+
+typedef struct go_fielddef {
+	go_typeid_t gfd_type;
+	const char *gfd_names[GO_FIELD_MAXNAMES];	/* newest first */
+	uint32_t gfd_off;		/* in mdb_go_types.h ... */
+	uint32_t gfd_size;		/* ... or 0 if it isn't there */
+} go_fielddef_t;
+
+#define	GO_BUILTIN(type, member)	\
+	offsetof(type, member), sizeof (((type *)0)->member)
+#define	GO_NOBUILTIN	0, 0
+
+/*
+ * In go_fieldid_t order.
+ */
+static const go_fielddef_t go_fielddefs[GO_NFIELDS] = {
+	{ GO_TYPE_G, { "goid" }, GO_BUILTIN(G, goid) },
+	{ GO_TYPE_G, { "atomicstatus", "status" }, GO_BUILTIN(G, status) },
+	{ GO_TYPE_G, { "alllink" }, GO_BUILTIN(G, alllink) },
+	{ GO_TYPE_G, { "schedlink" }, GO_BUILTIN(G, schedlink) },
+	{ GO_TYPE_G, { "sched.sp" }, GO_BUILTIN(G, sched.sp) },
+	{ GO_TYPE_G, { "sched.pc" }, GO_BUILTIN(G, sched.pc) },
+	{ GO_TYPE_G, { "sched.bp" }, GO_NOBUILTIN },
+	{ GO_TYPE_G, { "stack.lo", "stack0" }, GO_BUILTIN(G, stack0) },
+	{ GO_TYPE_G, { "stack.hi", "stackbase" }, GO_BUILTIN(G, stackbase) },
+	{ GO_TYPE_G, { "stacksize" }, GO_BUILTIN(G, stacksize) },
+	{ GO_TYPE_G, { "stackguard", "stackguard0" },
+	    GO_BUILTIN(G, stackguard) },
+	{ GO_TYPE_G, { "syscallsp" }, GO_BUILTIN(G, syscallsp) },
+	{ GO_TYPE_G, { "syscallpc" }, GO_BUILTIN(G, syscallpc) },
+	{ GO_TYPE_G, { "syscallstack" }, GO_BUILTIN(G, syscallstack) },
+	{ GO_TYPE_G, { "syscallguard" }, GO_BUILTIN(G, syscallguard) },
+	{ GO_TYPE_G, { "m" }, GO_BUILTIN(G, m) },
+	{ GO_TYPE_G, { "gopc" }, GO_BUILTIN(G, gopc) },
+	{ GO_TYPE_G, { "startpc" }, GO_NOBUILTIN },
+	{ GO_TYPE_G, { "waitreason" }, GO_BUILTIN(G, waitreason) },
+	/* from Go 1.4 to 1.10, the wait reason is a Go string */
+	{ GO_TYPE_G, { "waitreason.str" }, GO_NOBUILTIN },
+	{ GO_TYPE_G, { "waitreason.len" }, GO_NOBUILTIN },
+	{ GO_TYPE_G, { "ispanic" }, GO_BUILTIN(G, ispanic) },
+	{ GO_TYPE_G, { "issystem" }, GO_BUILTIN(G, issystem) },
+	{ GO_TYPE_G, { "isbackground" }, GO_BUILTIN(G, isbackground) },
+
+	{ GO_TYPE_M, { "id" }, GO_BUILTIN(M, id) },
+	{ GO_TYPE_M, { "g0" }, GO_BUILTIN(M, g0) },
+	{ GO_TYPE_M, { "curg" }, GO_BUILTIN(M, curg) },
+	{ GO_TYPE_M, { "p" }, GO_BUILTIN(M, p) },
+	{ GO_TYPE_M, { "nextp" }, GO_BUILTIN(M, nextp) },
+	{ GO_TYPE_M, { "gsignal" }, GO_BUILTIN(M, gsignal) },
+	{ GO_TYPE_M, { "caughtsig" }, GO_BUILTIN(M, caughtsig) },
+	{ GO_TYPE_M, { "alllink" }, GO_BUILTIN(M, alllink) },
+	{ GO_TYPE_M, { "schedlink" }, GO_BUILTIN(M, schedlink) },
+	{ GO_TYPE_M, { "procid" }, GO_BUILTIN(M, procid) },
+	{ GO_TYPE_M, { "libcall" }, GO_BUILTIN(M, libcall) },
+	{ GO_TYPE_M, { "libcall.fn" }, GO_BUILTIN(M, libcall.fn) },
+	{ GO_TYPE_M, { "libcall.n" }, GO_BUILTIN(M, libcall.n) },
+
+	{ GO_TYPE_P, { "id" }, GO_BUILTIN(P, id) },
+	{ GO_TYPE_P, { "status" }, GO_BUILTIN(P, status) },
+	{ GO_TYPE_P, { "link" }, GO_BUILTIN(P, link) },
+	{ GO_TYPE_P, { "m" }, GO_BUILTIN(P, m) },
+	{ GO_TYPE_P, { "runqsize" }, GO_BUILTIN(P, runqsize) },
+	{ GO_TYPE_P, { "runqhead" }, GO_BUILTIN(P, runqhead) },
+	{ GO_TYPE_P, { "runqtail" }, GO_BUILTIN(P, runqtail) },
+
+	{ GO_TYPE_GOBUF, { "sp" }, GO_BUILTIN(Gobuf, sp) },
+	{ GO_TYPE_GOBUF, { "pc" }, GO_BUILTIN(Gobuf, pc) },
+	{ GO_TYPE_GOBUF, { "g" }, GO_BUILTIN(Gobuf, g) },
+	{ GO_TYPE_GOBUF, { "bp" }, GO_NOBUILTIN },
+
+	/*
+	 * The heap has changed too much, too often, to build in a layout;
+	 * without DWARF there's no heap.
+	 */
+	{ GO_TYPE_MSPAN, { "next" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "startAddr" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "npages" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "freeindex" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "nelems" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "allocBits" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "gcmarkBits" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "allocCount" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "spanclass" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "state.s", "state" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "elemsize" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "limit" }, GO_NOBUILTIN },
+	{ GO_TYPE_MSPAN, { "specials" }, GO_NOBUILTIN },
+
+	{ GO_TYPE_MHEAP, { "allspans" }, GO_NOBUILTIN },
+	{ GO_TYPE_MHEAP, { "arenas" }, GO_NOBUILTIN },
+
+	{ GO_TYPE_HEAPARENA, { "spans" }, GO_NOBUILTIN },
+
+	{ GO_TYPE_SPECIAL, { "next" }, GO_NOBUILTIN },
+	{ GO_TYPE_SPECIAL, { "offset" }, GO_NOBUILTIN },
+	{ GO_TYPE_SPECIAL, { "kind" }, GO_NOBUILTIN },
+
+	{ GO_TYPE_SPECIALFIN, { "fn" }, GO_NOBUILTIN }
+};
+
+go_field_t go_fields[GO_NFIELDS];
+static uint32_t go_type_sizes[GO_NTYPES];
+static boolean_t go_type_dwarf[GO_NTYPES];
+
+/*
+ * A minimal DWARF (versions 2 to 5) reader: enough to find a named
+ * structure type among the top-level DIEs of .debug_info, and the offsets
+ * and sizes of its members.
+ */
+#define	DW_TAG_array_type		0x01
+#define	DW_TAG_member			0x0d
+#define	DW_TAG_pointer_type		0x0f
+#define	DW_TAG_structure_type		0x13
+#define	DW_TAG_typedef			0x16
+#define	DW_TAG_subrange_type		0x21
+#define	DW_TAG_const_type		0x26
+#define	DW_TAG_volatile_type		0x35
+
+#define	DW_AT_name			0x03
+#define	DW_AT_byte_size			0x0b
+#define	DW_AT_upper_bound		0x2f
+#define	DW_AT_count			0x37
+#define	DW_AT_data_member_location	0x38
+#define	DW_AT_type			0x49
+
+#define	DW_FORM_addr			0x01
+#define	DW_FORM_block2			0x03
+#define	DW_FORM_block4			0x04
+#define	DW_FORM_data2			0x05
+#define	DW_FORM_data4			0x06
+#define	DW_FORM_data8			0x07
+#define	DW_FORM_string			0x08
+#define	DW_FORM_block			0x09
+#define	DW_FORM_block1			0x0a
+#define	DW_FORM_data1			0x0b
+#define	DW_FORM_flag			0x0c
+#define	DW_FORM_sdata			0x0d
+#define	DW_FORM_strp			0x0e
+#define	DW_FORM_udata			0x0f
+#define	DW_FORM_ref_addr		0x10
+#define	DW_FORM_ref1			0x11
+#define	DW_FORM_ref2			0x12
+#define	DW_FORM_ref4			0x13
+#define	DW_FORM_ref8			0x14
+#define	DW_FORM_ref_udata		0x15
+#define	DW_FORM_indirect		0x16
+#define	DW_FORM_sec_offset		0x17
+#define	DW_FORM_exprloc			0x18
+#define	DW_FORM_flag_present		0x19
+#define	DW_FORM_strx			0x1a
+#define	DW_FORM_ref_sup4		0x1c
+#define	DW_FORM_strp_sup		0x1d
+#define	DW_FORM_data16			0x1e
+#define	DW_FORM_line_strp		0x1f
+#define	DW_FORM_ref_sig8		0x20
+#define	DW_FORM_implicit_const		0x21
+#define	DW_FORM_loclistx		0x22
+#define	DW_FORM_rnglistx		0x23
+#define	DW_FORM_strx1			0x25
+#define	DW_FORM_strx2			0x26
+#define	DW_FORM_strx3			0x27
+#define	DW_FORM_strx4			0x28
+#define	DW_FORM_addrx1			0x29
+#define	DW_FORM_addrx2			0x2a
+#define	DW_FORM_addrx3			0x2b
+#define	DW_FORM_addrx4			0x2c
+
+#define	DW_OP_plus_uconst		0x23
+
+#define	GO_DW_MAXCODE		65536
+#define	GO_DW_MAXDEPTH		16
+
+typedef struct go_dwbuf {
+	const uchar_t *db_p;
+	const uchar_t *db_end;
+	boolean_t db_err;
+} go_dwbuf_t;
+
+/*
+ * A compilation unit, and its abbreviations indexed by code: each points
+ * at the abbreviation's tag in .debug_abbrev.
+ */
+typedef struct go_dwcu {
+	size_t dc_start;		/* of the header */
+	size_t dc_end;
+	size_t dc_die;			/* of the first DIE */
+	uint_t dc_version;
+	uint_t dc_addrsz;
+	uint64_t dc_abbrevoff;
+} go_dwcu_t;
+
+typedef struct go_dw {
+	const uchar_t *dw_info;
+	size_t dw_infosz;
+	const uchar_t *dw_abbrev;
+	size_t dw_abbrevsz;
+	const uchar_t *dw_str;
+	size_t dw_strsz;
+	go_dwcu_t *dw_cus;
+	size_t dw_ncus;
+	size_t dw_cualloc;
+	uint64_t dw_abbrevoff;		/* of the table in dw_codes */
+	const uchar_t **dw_codes;
+	size_t dw_ncodes;
+} go_dw_t;
+
+/*
+ * The attributes of a DIE that we care about.
+ */
+typedef struct go_dwdie {
+	size_t dd_off;
+	size_t dd_next;			/* offset of the following DIE */
+	uint64_t dd_tag;
+	boolean_t dd_children;
+	const char *dd_name;
+	uint64_t dd_type;		/* .debug_info offset, or 0 */
+	uint64_t dd_bytesize;
+	boolean_t dd_hasbytesize;
+	uint64_t dd_memberloc;
+	uint64_t dd_count;
+	boolean_t dd_hascount;
+} go_dwdie_t;
+
+static uint64_t
+go_dw_u(go_dwbuf_t *b, size_t n)
+{
+	uint64_t v = 0;
+	size_t i;
+
+	if (b->db_end - b->db_p < n) {
+		b->db_err = B_TRUE;
+		b->db_p = b->db_end;
+		return (0);
+	}
+
+	for (i = 0; i < n; i++)
+		v |= (uint64_t)b->db_p[i] << (8 * i);
+	b->db_p += n;
+
+	return (v);
+}
+
+static uint64_t
+go_dw_uleb(go_dwbuf_t *b)
+{
+	uint64_t v = 0;
+	uint_t shift = 0;
+	uchar_t c;
+
+	do {
+		if (b->db_p >= b->db_end) {
+			b->db_err = B_TRUE;
+			return (0);
+		}
+		c = *b->db_p++;
+		if (shift < 64)
+			v |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return (v);
+}
+
+static int64_t
+go_dw_sleb(go_dwbuf_t *b)
+{
+	int64_t v = 0;
+	uint_t shift = 0;
+	uchar_t c;
+
+	do {
+		if (b->db_p >= b->db_end) {
+			b->db_err = B_TRUE;
+			return (0);
+		}
+		c = *b->db_p++;
+		if (shift < 64)
+			v |= (int64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	if (shift < 64 && (c & 0x40))
+		v |= -((int64_t)1 << shift);
+
+	return (v);
+}
+
+static void
+go_dw_skip(go_dwbuf_t *b, uint64_t n)
+{
+	if (b->db_end - b->db_p < n) {
+		b->db_err = B_TRUE;
+		b->db_p = b->db_end;
+		return;
+	}
+
+	b->db_p += n;
+}
+
+static const char *
+go_dw_cstr(go_dwbuf_t *b)
+{
+	const char *s = (const char *)b->db_p;
+	const uchar_t *nul;
+
+	if ((nul = memchr(b->db_p, '\0', b->db_end - b->db_p)) == NULL) {
+		b->db_err = B_TRUE;
+		b->db_p = b->db_end;
+		return (NULL);
+	}
+
+	b->db_p = nul + 1;
+	return (s);
+}
+
+/*
+ * Index the abbreviation table at off by code.
+ */
+static int
+go_dw_abbrevs(go_dw_t *dw, uint64_t off)
+{
+	go_dwbuf_t b;
+	uint64_t code, name, form;
+	const uchar_t *tag;
+	size_t n;
+
+	if (dw->dw_codes != NULL && dw->dw_abbrevoff == off)
+		return (0);
+
+	if (off >= dw->dw_abbrevsz)
+		return (-1);
+
+	if (dw->dw_codes == NULL) {
+		dw->dw_ncodes = 256;
+		dw->dw_codes = mdb_zalloc(dw->dw_ncodes * sizeof (uchar_t *),
+		    UM_SLEEP);
+	} else {
+		bzero(dw->dw_codes, dw->dw_ncodes * sizeof (uchar_t *));
+	}
+
+	b.db_p = dw->dw_abbrev + off;
+	b.db_end = dw->dw_abbrev + dw->dw_abbrevsz;
+	b.db_err = B_FALSE;
+
+	while ((code = go_dw_uleb(&b)) != 0 && !b.db_err) {
+		if (code >= GO_DW_MAXCODE)
+			return (-1);
+
+		if (code >= dw->dw_ncodes) {
+			const uchar_t **ncodes;
+
+			for (n = dw->dw_ncodes; n <= code; n *= 2)
+				continue;
+			ncodes = mdb_zalloc(n * sizeof (uchar_t *), UM_SLEEP);
+			bcopy(dw->dw_codes, ncodes,
+			    dw->dw_ncodes * sizeof (uchar_t *));
+			mdb_free(dw->dw_codes, dw->dw_ncodes * sizeof (uchar_t *));
+			dw->dw_codes = ncodes;
+			dw->dw_ncodes = n;
+		}
+
+		tag = b.db_p;
+		dw->dw_codes[code] = tag;
+
+		(void) go_dw_uleb(&b);		/* tag */
+		go_dw_skip(&b, 1);		/* has children */
+		do {
+			name = go_dw_uleb(&b);
+			form = go_dw_uleb(&b);
+			if (form == DW_FORM_implicit_const)
+				(void) go_dw_sleb(&b);
+		} while ((name != 0 || form != 0) && !b.db_err);
+	}
+
+	if (b.db_err)
+		return (-1);
+
+	dw->dw_abbrevoff = off;
+	return (0);
+}
+
+/*
+ * Read the attribute value of the given form; references are returned as
+ * offsets in .debug_info.
+ */
+static int
+go_dw_value(go_dw_t *dw, const go_dwcu_t *cu, go_dwbuf_t *b, uint64_t form,
+    int64_t implicit, uint64_t *valp, const char **strp)
+{
+	uint64_t v = 0, len;
+	const uchar_t *blk;
+
+	*strp = NULL;
+
+	switch (form) {
+	case DW_FORM_addr:
+		v = go_dw_u(b, cu->dc_addrsz);
+		break;
+	case DW_FORM_data1:
+	case DW_FORM_flag:
+	case DW_FORM_strx1:
+	case DW_FORM_addrx1:
+		v = go_dw_u(b, 1);
+		break;
+	case DW_FORM_data2:
+	case DW_FORM_strx2:
+	case DW_FORM_addrx2:
+		v = go_dw_u(b, 2);
+		break;
+	case DW_FORM_strx3:
+	case DW_FORM_addrx3:
+		v = go_dw_u(b, 3);
+		break;
+	case DW_FORM_data4:
+	case DW_FORM_sec_offset:
+	case DW_FORM_strx4:
+	case DW_FORM_addrx4:
+	case DW_FORM_ref_sup4:
+	case DW_FORM_strp_sup:
+	case DW_FORM_line_strp:
+		v = go_dw_u(b, 4);
+		break;
+	case DW_FORM_data8:
+	case DW_FORM_ref_sig8:
+		v = go_dw_u(b, 8);
+		break;
+	case DW_FORM_data16:
+		go_dw_skip(b, 16);
+		break;
+	case DW_FORM_sdata:
+		v = (uint64_t)go_dw_sleb(b);
+		break;
+	case DW_FORM_udata:
+	case DW_FORM_strx:
+	case DW_FORM_loclistx:
+	case DW_FORM_rnglistx:
+		v = go_dw_uleb(b);
+		break;
+	case DW_FORM_string:
+		*strp = go_dw_cstr(b);
+		break;
+	case DW_FORM_strp:
+		v = go_dw_u(b, 4);
+		if (v < dw->dw_strsz &&
+		    memchr(dw->dw_str + v, '\0', dw->dw_strsz - v) != NULL)
+			*strp = (const char *)dw->dw_str + v;
+		break;
+	case DW_FORM_ref_addr:
+		v = go_dw_u(b, cu->dc_version <= 2 ? cu->dc_addrsz : 4);
+		break;
+	case DW_FORM_ref1:
+		v = cu->dc_start + go_dw_u(b, 1);
+		break;
+	case DW_FORM_ref2:
+		v = cu->dc_start + go_dw_u(b, 2);
+		break;
+	case DW_FORM_ref4:
+		v = cu->dc_start + go_dw_u(b, 4);
+		break;
+	case DW_FORM_ref8:
+		v = cu->dc_start + go_dw_u(b, 8);
+		break;
+	case DW_FORM_ref_udata:
+		v = cu->dc_start + go_dw_uleb(b);
+		break;
+	case DW_FORM_flag_present:
+		v = 1;
+		break;
+	case DW_FORM_implicit_const:
+		v = (uint64_t)implicit;
+		break;
+	case DW_FORM_exprloc:
+	case DW_FORM_block:
+	case DW_FORM_block1:
+	case DW_FORM_block2:
+	case DW_FORM_block4:
+		len = form == DW_FORM_block1 ? go_dw_u(b, 1) :
+		    form == DW_FORM_block2 ? go_dw_u(b, 2) :
+		    form == DW_FORM_block4 ? go_dw_u(b, 4) : go_dw_uleb(b);
+		blk = b->db_p;
+		go_dw_skip(b, len);
+		/* a member location of the form DW_OP_plus_uconst n */
+		if (!b->db_err && len > 1 && blk[0] == DW_OP_plus_uconst) {
+			go_dwbuf_t eb;
+
+			eb.db_p = blk + 1;
+			eb.db_end = blk + len;
+			eb.db_err = B_FALSE;
+			v = go_dw_uleb(&eb);
+		}
+		break;
+	case DW_FORM_indirect:
+		form = go_dw_uleb(b);
+		if (form == DW_FORM_indirect || b->db_err)
+			return (-1);
+		return (go_dw_value(dw, cu, b, form, implicit, valp, strp));
+	default:
+		return (-1);
+	}
+
+	if (b->db_err)
+		return (-1);
+
+	*valp = v;
+	return (0);
+}
+
+/*
+ * Decode the DIE at off in cu.  A null entry (the end of a list of
+ * children) has a tag of 0.
+ */
+static int
+go_dw_die(go_dw_t *dw, const go_dwcu_t *cu, size_t off, go_dwdie_t *die)
+{
+	go_dwbuf_t b, ab;
+	uint64_t code, name, form, val;
+	int64_t implicit;
+	const char *str;
+
+	bzero(die, sizeof (*die));
+	die->dd_off = off;
+
+	if (off < cu->dc_die || off >= cu->dc_end ||
+	    go_dw_abbrevs(dw, cu->dc_abbrevoff) != 0)
+		return (-1);
+
+	b.db_p = dw->dw_info + off;
+	b.db_end = dw->dw_info + cu->dc_end;
+	b.db_err = B_FALSE;
+
+	if ((code = go_dw_uleb(&b)) == 0) {
+		die->dd_next = b.db_p - dw->dw_info;
+		return (b.db_err ? -1 : 0);
+	}
+
+	if (code >= dw->dw_ncodes || dw->dw_codes[code] == NULL)
+		return (-1);
+
+	ab.db_p = dw->dw_codes[code];
+	ab.db_end = dw->dw_abbrev + dw->dw_abbrevsz;
+	ab.db_err = B_FALSE;
+
+	die->dd_tag = go_dw_uleb(&ab);
+	die->dd_children = go_dw_u(&ab, 1) != 0;
+
+	for (;;) {
+		name = go_dw_uleb(&ab);
+		form = go_dw_uleb(&ab);
+		implicit = form == DW_FORM_implicit_const ? go_dw_sleb(&ab) : 0;
+		if (ab.db_err)
+			return (-1);
+		if (name == 0 && form == 0)
+			break;
+
+		if (go_dw_value(dw, cu, &b, form, implicit, &val, &str) != 0)
+			return (-1);
+
+		switch (name) {
+		case DW_AT_name:
+			die->dd_name = str;
+			break;
+		case DW_AT_type:
+			die->dd_type = val;
+			break;
+		case DW_AT_byte_size:
+			die->dd_bytesize = val;
+			die->dd_hasbytesize = B_TRUE;
+			break;
+		case DW_AT_data_member_location:
+			die->dd_memberloc = val;
+			break;
+		case DW_AT_count:
+			die->dd_count = val;
+			die->dd_hascount = B_TRUE;
+			break;
+		case DW_AT_upper_bound:
+			if (!die->dd_hascount) {
+				die->dd_count = val + 1;
+				die->dd_hascount = B_TRUE;
+			}
+			break;
+		}
+	}
+
+	die->dd_next = b.db_p - dw->dw_info;
+	return (0);
+}
+
+/*
+ * Read the unit headers.
+ */
+static int
+go_dw_units(go_dw_t *dw)
+{
+	go_dwbuf_t b;
+	go_dwcu_t cu, *ncus;
+	uint64_t len;
+	uint_t type;
+
+	b.db_p = dw->dw_info;
+	b.db_end = dw->dw_info + dw->dw_infosz;
+	b.db_err = B_FALSE;
+
+	while (b.db_p < b.db_end) {
+		bzero(&cu, sizeof (cu));
+		cu.dc_start = b.db_p - dw->dw_info;
+
+		/* we don't handle 64-bit DWARF, which Go doesn't write */
+		if ((len = go_dw_u(&b, 4)) >= 0xfffffff0 ||
+		    len > b.db_end - b.db_p)
+			return (-1);
+		cu.dc_end = (b.db_p - dw->dw_info) + len;
+		cu.dc_version = go_dw_u(&b, 2);
+
+		if (cu.dc_version >= 5) {
+			type = go_dw_u(&b, 1);
+			cu.dc_addrsz = go_dw_u(&b, 1);
+			cu.dc_abbrevoff = go_dw_u(&b, 4);
+			/* skeleton and type units carry an id, and more */
+			if (type == 2 || type == 6)
+				go_dw_skip(&b, 12);
+			else if (type == 4 || type == 5)
+				go_dw_skip(&b, 8);
+		} else {
+			cu.dc_abbrevoff = go_dw_u(&b, 4);
+			cu.dc_addrsz = go_dw_u(&b, 1);
+		}
+
+		if (b.db_err || cu.dc_version < 2 || cu.dc_version > 5)
+			return (-1);
+
+		cu.dc_die = b.db_p - dw->dw_info;
+		b.db_p = dw->dw_info + cu.dc_end;
+
+		if (dw->dw_ncus == dw->dw_cualloc) {
+			size_t n = dw->dw_cualloc == 0 ? 64 : dw->dw_cualloc * 2;
+
+			ncus = mdb_alloc(n * sizeof (go_dwcu_t), UM_SLEEP);
+			if (dw->dw_cus != NULL) {
+				bcopy(dw->dw_cus, ncus,
+				    dw->dw_ncus * sizeof (go_dwcu_t));
+				mdb_free(dw->dw_cus,
+				    dw->dw_cualloc * sizeof (go_dwcu_t));
+			}
+			dw->dw_cus = ncus;
+			dw->dw_cualloc = n;
+		}
+		dw->dw_cus[dw->dw_ncus++] = cu;
+	}
+
+	return (0);
+}
+
+static const go_dwcu_t *
+go_dw_unit(const go_dw_t *dw, uint64_t off)
+{
+	size_t lo = 0, hi = dw->dw_ncus, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (off < dw->dw_cus[mid].dc_start)
+			hi = mid;
+		else if (off >= dw->dw_cus[mid].dc_end)
+			lo = mid + 1;
+		else
+			return (&dw->dw_cus[mid]);
+	}
+
+	return (NULL);
+}
+
+static int
+go_dw_lookup(go_dw_t *dw, uint64_t off, go_dwdie_t *die)
+{
+	const go_dwcu_t *cu;
+
+	if ((cu = go_dw_unit(dw, off)) == NULL)
+		return (-1);
+
+	return (go_dw_die(dw, cu, off, die));
+}
+
+/*
+ * The size of the type whose DIE is at off.
+ */
+static uint64_t
+go_dw_typesize(go_dw_t *dw, uint64_t off, int depth)
+{
+	go_dwdie_t die, sub;
+	const go_dwcu_t *cu;
+
+	if (depth > GO_DW_MAXDEPTH || (cu = go_dw_unit(dw, off)) == NULL ||
+	    go_dw_die(dw, cu, off, &die) != 0)
+		return (0);
+
+	if (die.dd_hasbytesize)
+		return (die.dd_bytesize);
+
+	switch (die.dd_tag) {
+	case DW_TAG_pointer_type:
+		return (cu->dc_addrsz);
+
+	case DW_TAG_typedef:
+	case DW_TAG_const_type:
+	case DW_TAG_volatile_type:
+		return (die.dd_type == 0 ? 0 :
+		    go_dw_typesize(dw, die.dd_type, depth + 1));
+
+	case DW_TAG_array_type:
+		if (!die.dd_children || die.dd_type == 0 ||
+		    go_dw_die(dw, cu, die.dd_next, &sub) != 0 ||
+		    sub.dd_tag != DW_TAG_subrange_type || !sub.dd_hascount)
+			return (0);
+		return (sub.dd_count *
+		    go_dw_typesize(dw, die.dd_type, depth + 1));
+	}
+
+	return (0);
+}
+
+/*
+ * Find the member of the structure at off named by the first len bytes of
+ * name, returning its DIE.
+ */
+static int
+go_dw_member(go_dw_t *dw, uint64_t off, const char *name, size_t len,
+    go_dwdie_t *member)
+{
+	go_dwdie_t die;
+	const go_dwcu_t *cu;
+	size_t next;
+	int depth, i;
+
+	/* look through typedefs to the structure */
+	for (i = 0; ; i++) {
+		if (i > GO_DW_MAXDEPTH || (cu = go_dw_unit(dw, off)) == NULL ||
+		    go_dw_die(dw, cu, off, &die) != 0)
+			return (-1);
+		if (die.dd_tag == DW_TAG_structure_type)
+			break;
+		if (die.dd_tag != DW_TAG_typedef || die.dd_type == 0)
+			return (-1);
+		off = die.dd_type;
+	}
+
+	if (!die.dd_children)
+		return (-1);
+
+	for (next = die.dd_next, depth = 1; depth > 0; next = die.dd_next) {
+		if (go_dw_die(dw, cu, next, &die) != 0)
+			return (-1);
+
+		if (die.dd_tag == 0) {
+			depth--;
+			continue;
+		}
+
+		if (depth == 1 && die.dd_tag == DW_TAG_member &&
+		    die.dd_name != NULL && strncmp(die.dd_name, name, len) == 0 &&
+		    die.dd_name[len] == '\0') {
+			*member = die;
+			return (0);
+		}
+
+		if (die.dd_children)
+			depth++;
+	}
+
+	return (-1);
+}
+
+/*
+ * Resolve a dotted member path in the structure at off.
+ */
+static int
+go_dw_path(go_dw_t *dw, uint64_t off, const char *path, uint32_t *offp,
+    uint32_t *sizep)
+{
+	go_dwdie_t member;
+	const char *dot;
+	uint64_t total = 0, size;
+
+	for (;;) {
+		dot = strchr(path, '.');
+		if (go_dw_member(dw, off, path,
+		    dot != NULL ? dot - path : strlen(path), &member) != 0)
+			return (-1);
+
+		total += member.dd_memberloc;
+		if (dot == NULL)
+			break;
+
+		off = member.dd_type;
+		path = dot + 1;
+	}
+
+	if ((size = go_dw_typesize(dw, member.dd_type, 0)) == 0 ||
+	    total + size > UINT32_MAX)
+		return (-1);
+
+	*offp = (uint32_t)total;
+	*sizep = (uint32_t)size;
+	return (0);
+}
+
+/*
+ * Find the top-level structure types we want, filling in offs[].
+ */
+static int
+go_dw_scan(go_dw_t *dw, uint64_t *offs)
+{
+	go_dwdie_t die;
+	const go_dwcu_t *cu;
+	size_t i, off, nfound = 0;
+	int depth, t;
+
+	for (i = 0; i < dw->dw_ncus && nfound < GO_NTYPES; i++) {
+		cu = &dw->dw_cus[i];
+
+		for (off = cu->dc_die, depth = 0; off < cu->dc_end;
+		    off = die.dd_next) {
+			if (go_dw_die(dw, cu, off, &die) != 0)
+				return (-1);
+
+			if (die.dd_tag == 0) {
+				if (--depth <= 0)
+					break;
+				continue;
+			}
+
+			if (depth == 1 && die.dd_tag == DW_TAG_structure_type &&
+			    die.dd_name != NULL) {
+				for (t = 0; t < GO_NTYPES; t++) {
+					if (offs[t] == 0 && strcmp(die.dd_name,
+					    go_typedefs[t].gtd_name) == 0) {
+						offs[t] = off;
+						nfound++;
+					}
+				}
+			}
+
+			if (die.dd_children)
+				depth++;
+			else if (depth == 0)
+				break;
+		}
+	}
+
+	return (0);
+}
+
+static void
+go_dw_free(go_dw_t *dw)
+{
+	if (dw->dw_cus != NULL)
+		mdb_free(dw->dw_cus, dw->dw_cualloc * sizeof (go_dwcu_t));
+	if (dw->dw_codes != NULL)
+		mdb_free(dw->dw_codes, dw->dw_ncodes * sizeof (uchar_t *));
+}
+
+/*
+ * Use the layouts in mdb_go_types.h.
+ */
+void
+go_layout_reset(void)
+{
+	int i;
+
+	for (i = 0; i < GO_NTYPES; i++) {
+		go_type_sizes[i] = go_typedefs[i].gtd_size;
+		go_type_dwarf[i] = B_FALSE;
+	}
+
+	for (i = 0; i < GO_NFIELDS; i++) {
+		go_fields[i].gf_off = go_fielddefs[i].gfd_off;
+		go_fields[i].gf_size = go_fielddefs[i].gfd_size;
+	}
+}
+
+/*
+ * Look up the layouts in the binary's DWARF, if we have the binary.
+ */
+void
+go_layout_load(void)
+{
+	go_dw_t dw;
+	go_dwdie_t die;
+	uint64_t offs[GO_NTYPES];
+	const go_fielddef_t *fd;
+	int i, j;
+
+	go_layout_reset();
+
+	bzero(&dw, sizeof (dw));
+	bzero(offs, sizeof (offs));
+
+	if ((dw.dw_info = go_elf_section(".debug_info",
+	    &dw.dw_infosz)) == NULL ||
+	    (dw.dw_abbrev = go_elf_section(".debug_abbrev",
+	    &dw.dw_abbrevsz)) == NULL)
+		return;
+	dw.dw_str = go_elf_section(".debug_str", &dw.dw_strsz);
+
+	if (go_dw_units(&dw) != 0 || go_dw_scan(&dw, offs) != 0) {
+		mdb_warn("failed to read runtime types from DWARF; "
+		    "using built-in layouts\n");
+		go_dw_free(&dw);
+		return;
+	}
+
+	for (i = 0; i < GO_NTYPES; i++) {
+		if (offs[i] == 0 || go_dw_lookup(&dw, offs[i], &die) != 0 ||
+		    !die.dd_hasbytesize)
+			continue;
+		go_type_sizes[i] = (uint32_t)die.dd_bytesize;
+		go_type_dwarf[i] = B_TRUE;
+	}
+
+	for (i = 0; i < GO_NFIELDS; i++) {
+		fd = &go_fielddefs[i];
+		if (!go_type_dwarf[fd->gfd_type])
+			continue;
+
+		go_fields[i].gf_off = 0;
+		go_fields[i].gf_size = 0;
+		for (j = 0; j < GO_FIELD_MAXNAMES && fd->gfd_names[j] != NULL;
+		    j++) {
+			if (go_dw_path(&dw, offs[fd->gfd_type],
+			    fd->gfd_names[j], &go_fields[i].gf_off,
+			    &go_fields[i].gf_size) == 0)
+				break;
+		}
+	}
+
+	go_dw_free(&dw);
+}
+
+/*
+ * Read an integer or pointer field of the structure at addr.
+ */
+int
+go_field_read(uintptr_t addr, go_fieldid_t id, uint64_t *valp)
+{
+	const go_field_t *f = &go_fields[id];
+	uchar_t buf[sizeof (uint64_t)];
+	uint64_t v = 0;
+	int i;
+
+	if (f->gf_size == 0 || f->gf_size > sizeof (buf) ||
+	    go_vread(buf, f->gf_size, addr + f->gf_off) != (ssize_t)f->gf_size)
+		return (-1);
+
+	/* little-endian, as are the only targets we support */
+	for (i = f->gf_size - 1; i >= 0; i--)
+		v = (v << 8) | buf[i];
+
+	*valp = v;
+	return (0);
+}
+
+/*
+ * Read several fields of the structure at addr with a single read of the
+ * span that covers them, rather than one read each.  Fields this runtime
+ * lacks read as 0.
+ */
+int
+go_fields_read(uintptr_t addr, const go_fieldid_t *ids, size_t n,
+    uint64_t *vals)
+{
+	static uchar_t buf[GO_FIELDS_MAXSPAN];
+	const go_field_t *f;
+	uint32_t lo = UINT32_MAX, hi = 0;
+	uint64_t v;
+	size_t i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		f = &go_fields[ids[i]];
+		if (f->gf_size == 0 || f->gf_size > sizeof (uint64_t))
+			continue;
+		if (f->gf_off < lo)
+			lo = f->gf_off;
+		if (f->gf_off + f->gf_size > hi)
+			hi = f->gf_off + f->gf_size;
+	}
+
+	if (hi == 0) {
+		bzero(vals, n * sizeof (uint64_t));
+		return (0);
+	}
+
+	/* fields that far apart are better read separately */
+	if (hi - lo > sizeof (buf)) {
+		for (i = 0; i < n; i++) {
+			if (go_field_read(addr, ids[i], &vals[i]) != 0)
+				vals[i] = 0;
+		}
+		return (0);
+	}
+
+	if (go_vread(buf, hi - lo, addr + lo) != (ssize_t)(hi - lo))
+		return (-1);
+
+	for (i = 0; i < n; i++) {
+		f = &go_fields[ids[i]];
+		v = 0;
+		if (f->gf_size != 0 && f->gf_size <= sizeof (uint64_t)) {
+			for (j = f->gf_size - 1; j >= 0; j--)
+				v = (v << 8) | buf[f->gf_off - lo + j];
+		}
+		vals[i] = v;
+	}
+
+	return (0);
+}
+
+size_t
+go_type_size(go_typeid_t type)
+{
+	return (go_type_sizes[type]);
+}
+
+void
+go_layout_report(void)
+{
+	const go_fielddef_t *fd;
+	int i;
+
+	mdb_printf("%-14s %-14s %8s %6s %s\n", "TYPE", "FIELD", "OFFSET",
+	    "SIZE", "SOURCE");
+
+	for (i = 0; i < GO_NTYPES; i++) {
+		mdb_printf("%-14s %-14s %8s %6u %s\n", go_typedefs[i].gtd_name,
+		    "-", "-", go_type_sizes[i],
+		    go_type_dwarf[i] ? "DWARF" : "built-in");
+	}
+
+	for (i = 0; i < GO_NFIELDS; i++) {
+		fd = &go_fielddefs[i];
+		if (go_fields[i].gf_size == 0) {
+			mdb_printf("%-14s %-14s %8s %6s %s\n",
+			    go_typedefs[fd->gfd_type].gtd_name,
+			    fd->gfd_names[0], "-", "-", "absent");
+			continue;
+		}
+		mdb_printf("%-14s %-14s %8x %6u %s\n",
+		    go_typedefs[fd->gfd_type].gtd_name, fd->gfd_names[0],
+		    go_fields[i].gf_off, go_fields[i].gf_size,
+		    go_type_dwarf[fd->gfd_type] ? "DWARF" : "built-in");
+	}
+}
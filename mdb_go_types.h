@@ -26,6 +26,9 @@ enum {
         GS_Gwaiting,
         GS_Gmoribund_unused,
         GS_Gdead,
+        GS_Genqueue_unused,
+        GS_Gcopystack,
+        GS_Gpreempted,
 };
 
 enum {
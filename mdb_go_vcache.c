@@ -0,0 +1,397 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright (c) 2013, Joyent, Inc. All rights reserved.
+ */
+
+/*
+ * Read-through cache of target memory.  The walkers and dcmds make many
+ * small, scattered reads -- a G here, a stack word there -- and every
+ * mdb_vread() has a fixed cost on both core files and live processes.  We
+ * instead read whole aligned pages of the target and satisfy small reads
+ * from them, evicting least-recently-used pages once the cache reaches its
+ * limit.  Reads larger than GO_VCACHE_BYPASS pages go straight to the
+ * target, as do reads of pages that cannot be read in full (for instance,
+ * a page that straddles the end of a mapping).
+ *
+ * Pages that can't be read in full are remembered too, without their data,
+ * so that a walk through a corrupt list doesn't pay for a failed page read
+ * every time it comes back to one.  Such a page is probed at both ends when
+ * it first fails: if neither end can be read, the page is taken to be
+ * unreadable and reads of it fail at once; otherwise reads of it go straight
+ * to the target.
+ *
+ * On a live target the cache is flushed whenever the target's state
+ * changes, since it may have run in the meantime.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "mdb_go.h"
+
+#define	GO_VCACHE_DEFPGSZ	4096
+#define	GO_VCACHE_MINPGSZ	512
+#define	GO_VCACHE_MAXPGSZ	(1024 * 1024)
+#define	GO_VCACHE_DEFMAX	(16 * 1024 * 1024)
+#define	GO_VCACHE_BYPASS	4
+
+typedef struct go_vpage {
+	struct go_vpage *vp_hnext;	/* hash chain */
+	struct go_vpage *vp_prev;	/* LRU list, toward most recent */
+	struct go_vpage *vp_next;	/* LRU list, toward least recent */
+	uintptr_t vp_addr;
+	uchar_t *vp_data;		/* NULL if it can't be read in full */
+	boolean_t vp_bad;		/* none of it can be read */
+} go_vpage_t;
+
+static size_t go_vcache_pgsz = GO_VCACHE_DEFPGSZ;
+static size_t go_vcache_max = GO_VCACHE_DEFMAX;
+static go_vpage_t **go_vcache_hash;
+static size_t go_vcache_hashsz;
+static go_vpage_t *go_vcache_mru;
+static go_vpage_t *go_vcache_lru;
+static size_t go_vcache_npages;
+static size_t go_vcache_nfailed;	/* pages without data */
+static uint64_t go_vcache_hits;
+static uint64_t go_vcache_misses;
+static uint64_t go_vcache_evictions;
+static uint64_t go_vcache_reads;	/* mdb_vread() calls made */
+static uint64_t go_vcache_fetched;	/* bytes those calls returned */
+
+#define	GO_VCACHE_HASH(addr)	\
+	((size_t)((((addr) / go_vcache_pgsz) * 0x9e3779b97f4a7c15ULL) >> 32) & \
+	(go_vcache_hashsz - 1))
+
+static ssize_t
+go_vcache_fetch(void *buf, size_t size, uintptr_t addr)
+{
+	ssize_t rv;
+
+	go_vcache_reads++;
+	if ((rv = mdb_vread(buf, size, addr)) > 0)
+		go_vcache_fetched += rv;
+
+	return (rv);
+}
+
+static void
+go_vcache_unlink(go_vpage_t *vp)
+{
+	go_vpage_t **vpp;
+
+	for (vpp = &go_vcache_hash[GO_VCACHE_HASH(vp->vp_addr)]; *vpp != vp;
+	    vpp = &(*vpp)->vp_hnext)
+		continue;
+	*vpp = vp->vp_hnext;
+
+	if (vp->vp_prev != NULL)
+		vp->vp_prev->vp_next = vp->vp_next;
+	else
+		go_vcache_mru = vp->vp_next;
+
+	if (vp->vp_next != NULL)
+		vp->vp_next->vp_prev = vp->vp_prev;
+	else
+		go_vcache_lru = vp->vp_prev;
+
+	go_vcache_npages--;
+	if (vp->vp_data == NULL)
+		go_vcache_nfailed--;
+}
+
+static void
+go_vcache_free(go_vpage_t *vp)
+{
+	if (vp->vp_data != NULL)
+		mdb_free(vp->vp_data, go_vcache_pgsz);
+	mdb_free(vp, sizeof (go_vpage_t));
+}
+
+static void
+go_vcache_evict(size_t npages)
+{
+	go_vpage_t *vp;
+
+	while (go_vcache_npages > npages && (vp = go_vcache_lru) != NULL) {
+		go_vcache_unlink(vp);
+		go_vcache_free(vp);
+		go_vcache_evictions++;
+	}
+}
+
+void
+go_vcache_flush(void)
+{
+	go_vcache_evict(0);
+
+	if (go_vcache_hash != NULL)
+		mdb_free(go_vcache_hash, go_vcache_hashsz * sizeof (go_vpage_t *));
+
+	go_vcache_hash = NULL;
+	go_vcache_hashsz = 0;
+}
+
+void
+go_vcache_zero(void)
+{
+	go_vcache_hits = 0;
+	go_vcache_misses = 0;
+	go_vcache_evictions = 0;
+	go_vcache_reads = 0;
+	go_vcache_fetched = 0;
+}
+
+/*
+ * Change the page size or the limit on cached bytes.  Either empties the
+ * cache.
+ */
+int
+go_vcache_set(size_t pgsz, size_t max)
+{
+	if (pgsz < GO_VCACHE_MINPGSZ || pgsz > GO_VCACHE_MAXPGSZ ||
+	    (pgsz & (pgsz - 1)) != 0) {
+		mdb_warn("page size must be a power of 2 between %u and %u\n",
+		    GO_VCACHE_MINPGSZ, GO_VCACHE_MAXPGSZ);
+		return (-1);
+	}
+
+	if (pgsz != go_vcache_pgsz || max != go_vcache_max) {
+		go_vcache_flush();
+		go_vcache_pgsz = pgsz;
+		go_vcache_max = max;
+	}
+
+	return (0);
+}
+
+/*
+ * Return the cached page at addr, reading it in if need be.  Returns NULL if
+ * the page cannot be read in full or the cache is disabled, and sets *badp
+ * if none of the page can be read.
+ */
+static const uchar_t *
+go_vcache_page(uintptr_t addr, boolean_t *badp)
+{
+	size_t maxpages = go_vcache_max / go_vcache_pgsz;
+	go_vpage_t *vp;
+	uchar_t c;
+	size_t h;
+
+	*badp = B_FALSE;
+
+	if (maxpages == 0)
+		return (NULL);
+
+	if (go_vcache_hash == NULL) {
+		/*
+		 * Size the hash for a full cache, with a power-of-two number
+		 * of buckets.
+		 */
+		for (go_vcache_hashsz = 64; go_vcache_hashsz < maxpages;
+		    go_vcache_hashsz *= 2)
+			continue;
+		go_vcache_hash = mdb_zalloc(go_vcache_hashsz *
+		    sizeof (go_vpage_t *), UM_SLEEP);
+	}
+
+	h = GO_VCACHE_HASH(addr);
+
+	for (vp = go_vcache_hash[h]; vp != NULL; vp = vp->vp_hnext) {
+		if (vp->vp_addr != addr)
+			continue;
+
+		go_vcache_hits++;
+
+		if (vp != go_vcache_mru) {
+			vp->vp_prev->vp_next = vp->vp_next;
+			if (vp->vp_next != NULL)
+				vp->vp_next->vp_prev = vp->vp_prev;
+			else
+				go_vcache_lru = vp->vp_prev;
+
+			vp->vp_prev = NULL;
+			vp->vp_next = go_vcache_mru;
+			go_vcache_mru->vp_prev = vp;
+			go_vcache_mru = vp;
+		}
+
+		*badp = vp->vp_bad;
+		return (vp->vp_data);
+	}
+
+	go_vcache_misses++;
+
+	/*
+	 * Recycle the least recently used page if we're full.
+	 */
+	if (go_vcache_npages >= maxpages) {
+		vp = go_vcache_lru;
+		go_vcache_unlink(vp);
+		go_vcache_evictions++;
+	} else {
+		vp = mdb_zalloc(sizeof (go_vpage_t), UM_SLEEP);
+	}
+
+	if (vp->vp_data == NULL)
+		vp->vp_data = mdb_alloc(go_vcache_pgsz, UM_SLEEP);
+
+	vp->vp_bad = B_FALSE;
+	if (go_vcache_fetch(vp->vp_data, go_vcache_pgsz, addr) !=
+	    (ssize_t)go_vcache_pgsz) {
+		mdb_free(vp->vp_data, go_vcache_pgsz);
+		vp->vp_data = NULL;
+		vp->vp_bad = go_vcache_fetch(&c, 1, addr) != 1 &&
+		    go_vcache_fetch(&c, 1, addr + go_vcache_pgsz - 1) != 1;
+		go_vcache_nfailed++;
+		*badp = vp->vp_bad;
+	}
+
+	vp->vp_addr = addr;
+	vp->vp_hnext = go_vcache_hash[h];
+	go_vcache_hash[h] = vp;
+	vp->vp_prev = NULL;
+	vp->vp_next = go_vcache_mru;
+	if (go_vcache_mru != NULL)
+		go_vcache_mru->vp_prev = vp;
+	else
+		go_vcache_lru = vp;
+	go_vcache_mru = vp;
+	go_vcache_npages++;
+
+	return (vp->vp_data);
+}
+
+/*
+ * mdb_vread() through the cache.  Reads of the pclntab are served from the
+ * binary if we have it mapped.
+ */
+ssize_t
+go_vread(void *buf, size_t size, uintptr_t addr)
+{
+	uintptr_t pgaddr, off;
+	const uchar_t *data;
+	size_t done, len;
+	boolean_t bad;
+
+	if ((data = go_elf_ptr(addr, &len)) != NULL && len >= size) {
+		bcopy(data, buf, size);
+		return (size);
+	}
+
+	if (size > GO_VCACHE_BYPASS * go_vcache_pgsz)
+		return (go_vcache_fetch(buf, size, addr));
+
+	for (done = 0; done < size; done += len) {
+		pgaddr = (addr + done) & ~(go_vcache_pgsz - 1);
+		off = addr + done - pgaddr;
+		len = go_vcache_pgsz - off;
+		if (len > size - done)
+			len = size - done;
+
+		if ((data = go_vcache_page(pgaddr, &bad)) == NULL) {
+			/*
+			 * This page can't be cached; read what's left of the
+			 * request directly, unless we know it can't be read.
+			 */
+			if (bad || go_vcache_fetch((char *)buf + done,
+			    size - done, addr + done) != (ssize_t)(size - done))
+				return (-1);
+			return (size);
+		}
+
+		bcopy(data + off, (char *)buf + done, len);
+	}
+
+	return (size);
+}
+
+/*
+ * mdb_readstr() through the cache: returns the length of the string, which is
+ * truncated (and terminated) if it does not fit in buf.
+ */
+ssize_t
+go_readstr(char *buf, size_t size, uintptr_t addr)
+{
+	uintptr_t pgaddr, off;
+	const uchar_t *data;
+	const char *nul;
+	size_t done, len;
+	boolean_t bad;
+
+	if (size == 0)
+		return (0);
+
+	for (done = 0; done < size - 1; done += len) {
+		pgaddr = (addr + done) & ~(go_vcache_pgsz - 1);
+		off = addr + done - pgaddr;
+		len = go_vcache_pgsz - off;
+		if (len > size - 1 - done)
+			len = size - 1 - done;
+
+		if ((data = go_vcache_page(pgaddr, &bad)) == NULL)
+			return (bad ? -1 : mdb_readstr(buf, size, addr));
+
+		if ((nul = memchr(data + off, '\0', len)) != NULL) {
+			len = nul - (const char *)(data + off);
+			bcopy(data + off, buf + done, len);
+			buf[done + len] = '\0';
+			return (done + len);
+		}
+
+		bcopy(data + off, buf + done, len);
+	}
+
+	buf[done] = '\0';
+	return (done);
+}
+
+size_t
+go_vcache_pagesize(void)
+{
+	return (go_vcache_pgsz);
+}
+
+size_t
+go_vcache_limit(void)
+{
+	return (go_vcache_max);
+}
+
+void
+go_vcache_report(void)
+{
+	uint64_t lookups = go_vcache_hits + go_vcache_misses;
+
+	mdb_printf("%-8s %8lu %10lu %10lu %12llu %12llu %10llu %3llu%%\n",
+	    "pages", go_vcache_npages,
+	    (go_vcache_npages - go_vcache_nfailed) * go_vcache_pgsz,
+	    go_vcache_max, go_vcache_hits, go_vcache_misses,
+	    go_vcache_evictions,
+	    lookups == 0 ? 0 : go_vcache_hits * 100 / lookups);
+	mdb_printf("\npage size %lu; %llu reads of the target fetched "
+	    "%llu bytes\n", go_vcache_pgsz, go_vcache_reads,
+	    go_vcache_fetched);
+	if (go_vcache_nfailed != 0) {
+		mdb_printf("%lu of the cached pages can't be read in full\n",
+		    go_vcache_nfailed);
+	}
+}